@@ -25,9 +25,15 @@
 
 #include "brilliantrussian.h"
 #include "xor.h"
+#include "dispatch.h"
 #include "graycode.h"
 #include "echelonform.h"
 #include "ple_russian.h"
+#include "profile.h"
+
+#if __M4RI_HAVE_OPENMP
+#include <omp.h>
+#endif
 
 /**
  * \brief Perform Gaussian reduction to reduced row echelon form on a
@@ -43,6 +49,11 @@
  * \param k Maximal dimension of identity matrix to produce.
  * \param end_row Maximal row index (exclusive) for rows to consider
  * for inclusion.
+ *
+ * \note This runs serially. Each pivot depends on the row additions
+ * made while finding the previous ones, so there is no independent
+ * work to hand out. It does k pivot searches, which is little next to
+ * the table construction and row updates that run in parallel.
  */
 
 static inline int _mzd_gauss_submatrix_full(mzd_t *A, rci_t r, rci_t c, rci_t end_row, int k) {
@@ -163,8 +174,8 @@ static inline void _mzd_copy_back_rows(mzd_t *A, mzd_t const *U, rci_t r, rci_t
   wi_t const startblock = c / m4ri_radix;
   wi_t const width = A->width - startblock;
   for (int i = 0; i < k; ++i) {
-    word const *const src = U->rows[i] + startblock;
-    word *const dst = A->rows[r+i] + startblock;
+    word const *const src = mzd_row(U, i) + startblock;
+    word *const dst = mzd_row(A, r+i) + startblock;
     for (wi_t j = 0; j < width; ++j) {
       dst[j] = src[j];
     }
@@ -172,33 +183,30 @@ static inline void _mzd_copy_back_rows(mzd_t *A, mzd_t const *U, rci_t r, rci_t
   __M4RI_DD_MZD(A);
 }
 
-void mzd_make_table(mzd_t const *M, rci_t r, rci_t c, int k, mzd_t *T, rci_t *L)
+/*
+ * Fill the words startblock, ..., stopblock - 1 of the rows of the
+ * table T, see mzd_make_table().
+ */
+
+static inline void _mzd_make_table_slice(mzd_t const *M, rci_t r, rci_t c, int k, mzd_t *T, wi_t startblock, wi_t stopblock)
 {
   wi_t const homeblock = c / m4ri_radix;
   word const mask_end = __M4RI_LEFT_BITMASK(M->ncols % m4ri_radix);
-  word const pure_mask_begin = __M4RI_RIGHT_BITMASK(m4ri_radix - (c % m4ri_radix));
-  word const mask_begin = (M->width - homeblock != 1) ? pure_mask_begin : pure_mask_begin & mask_end;
-  wi_t const wide = M->width - homeblock;
+  word const mask_begin = __M4RI_RIGHT_BITMASK(m4ri_radix - (c % m4ri_radix));
+  wi_t const wide = stopblock - startblock;
 
   int const twokay = __M4RI_TWOPOW(k);
-  L[0] = 0;
   for (rci_t i = 1; i < twokay; ++i) {
-    word *ti = T->rows[i] + homeblock;
-    word *ti1 = T->rows[i-1] + homeblock;
-
     rci_t const rowneeded = r + m4ri_codebook[k]->inc[i - 1];
-    int const id = m4ri_codebook[k]->ord[i];
-    L[id] = i;
-
     if (rowneeded >= M->nrows)
       continue;
 
-    word *m = M->rows[rowneeded] + homeblock;
-
-    *ti++ = (*m++ ^ *ti1++) & mask_begin;
+    word *ti = mzd_row(T, i) + startblock;
+    word *ti1 = mzd_row(T, i-1) + startblock;
+    word *m = mzd_row(M, rowneeded) + startblock;
 
     wi_t j;
-    for(j = 1; j + 8 <= wide - 1; j += 8) {
+    for(j = 0; j + 8 <= wide; j += 8) {
       *ti++ = *m++ ^ *ti1++;
       *ti++ = *m++ ^ *ti1++;
       *ti++ = *m++ ^ *ti1++;
@@ -209,16 +217,48 @@ void mzd_make_table(mzd_t const *M, rci_t r, rci_t c, int k, mzd_t *T, rci_t *L)
       *ti++ = *m++ ^ *ti1++;
     }
     switch(wide - j) {
-    case 8:  *ti++ = *m++ ^ *ti1++;
     case 7:  *ti++ = *m++ ^ *ti1++;
     case 6:  *ti++ = *m++ ^ *ti1++;
     case 5:  *ti++ = *m++ ^ *ti1++;
     case 4:  *ti++ = *m++ ^ *ti1++;
     case 3:  *ti++ = *m++ ^ *ti1++;
     case 2:  *ti++ = *m++ ^ *ti1++;
-    case 1:  *ti++ = (*m++ ^ *ti1++) & mask_end;
+    case 1:  *ti++ = *m++ ^ *ti1++;
     }
+
+    if (startblock == homeblock)
+      mzd_row(T, i)[homeblock] &= mask_begin;
+    if (stopblock == M->width)
+      mzd_row(T, i)[M->width - 1] &= mask_end;
   }
+}
+
+void mzd_make_table(mzd_t const *M, rci_t r, rci_t c, int k, mzd_t *T, rci_t *L)
+{
+  wi_t const homeblock = c / m4ri_radix;
+
+  int const twokay = __M4RI_TWOPOW(k);
+  L[0] = 0;
+  for (rci_t i = 1; i < twokay; ++i)
+    L[m4ri_codebook[k]->ord[i]] = i;
+
+#if __M4RI_HAVE_OPENMP
+  /*
+   * Each entry of the table depends on the previous one, but the
+   * columns are independent. For wide matrices we thus let every
+   * thread build all entries over a slice of the columns, such that
+   * the table construction does not serialise the elimination.
+   */
+  wi_t const wide = M->width - homeblock;
+  int const nslices = omp_in_parallel() ? 1 : MIN(m4ri_get_num_threads(), wide / __M4RI_MAKE_TABLE_SLICE_WIDTH);
+  if (nslices > 1) {
+#pragma omp parallel for schedule(static) num_threads(m4ri_get_num_threads())
+    for (int s = 0; s < nslices; ++s)
+      _mzd_make_table_slice(M, r, c, k, T, homeblock + (s * wide) / nslices, homeblock + ((s + 1) * wide) / nslices);
+  } else
+#endif
+    _mzd_make_table_slice(M, r, c, k, T, homeblock, M->width);
+
   __M4RI_DD_MZD(T);
   __M4RI_DD_RCI_ARRAY(L, twokay);
 }
@@ -234,12 +274,12 @@ void mzd_process_rows(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol, i
 
     rci_t r;
     for (r = startrow; r + 2 <= stoprow; r += 2) {
-      word const b0 = M->rows[r+0][block] & bm;
-      word const b1 = M->rows[r+1][block] & bm;
+      word const b0 = mzd_row(M, r+0)[block] & bm;
+      word const b1 = mzd_row(M, r+1)[block] & bm;
 
-      word *m0 = M->rows[r+0] + block;
-      word *m1 = M->rows[r+1] + block;
-      word *t = T->rows[1] + block;
+      word *m0 = mzd_row(M, r+0) + block;
+      word *m1 = mzd_row(M, r+1) + block;
+      word *t = mzd_row(T, 1) + block;
 
       wi_t n = count;
       if((b0 & b1)) {
@@ -285,8 +325,8 @@ void mzd_process_rows(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol, i
     for( ; r < stoprow; ++r) {
       rci_t const x0 = L[ mzd_read_bits_int(M, r, startcol, k) ];
 
-      word *m0 = M->rows[r] + block;
-      word *t0 = T->rows[x0] + block;
+      word *m0 = mzd_row(M, r) + block;
+      word *t0 = mzd_row(T, x0) + block;
 
       wi_t n = count;
       switch (entry_point) {
@@ -310,11 +350,11 @@ void mzd_process_rows(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol, i
     rci_t const x0 = L[ mzd_read_bits_int(M, r+0, startcol, k) ];
     rci_t const x1 = L[ mzd_read_bits_int(M, r+1, startcol, k) ];
 
-    word *m0 = M->rows[r+0] + block;
-    word *t0 = T->rows[x0] + block;
+    word *m0 = mzd_row(M, r+0) + block;
+    word *t0 = mzd_row(T, x0) + block;
 
-    word *m1 = M->rows[r+1] + block;
-    word *t1 = T->rows[x1] + block;
+    word *m1 = mzd_row(M, r+1) + block;
+    word *t1 = mzd_row(T, x1) + block;
 
     wi_t n = count;
     switch (entry_point) {
@@ -333,8 +373,8 @@ void mzd_process_rows(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol, i
   for( ; r < stoprow; ++r) {
     rci_t const x0 = L[ mzd_read_bits_int(M, r, startcol, k) ];
 
-    word *m0 = M->rows[r] + block;
-    word *t0 = T->rows[x0] + block;
+    word *m0 = mzd_row(M, r) + block;
+    word *t0 = mzd_row(T, x0) + block;
 
     wi_t n = count;
     switch (entry_point) {
@@ -353,6 +393,33 @@ void mzd_process_rows(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol, i
   __M4RI_DD_MZD(M);
 }
 
+/*
+ * Return the kernel for adding rows of the n tables T to rows of M:
+ * the dispatched wide kernel if there is one, NULL if the inline
+ * kernels of xor.h apply and the generic dispatched kernel if they do
+ * not, because the rows of M and T differ in their 16 byte alignment.
+ * All rows of a matrix share the alignment of its first row, so this
+ * is decided once per call and not once per row.
+ */
+
+static inline m4ri_combine_fn _mzd_combine_kernel(mzd_t const *M, mzd_t const *const *T, int n) {
+  if (m4ri_dispatch.combine_wide)
+    return m4ri_dispatch.combine_wide;
+#if __M4RI_HAVE_SSE2
+  if (M->nrows == 0)
+    return NULL;
+  unsigned long const alignment = __M4RI_ALIGNMENT(mzd_row(M, 0), 16);
+  for (int z = 0; z < n; ++z)
+    if (__M4RI_ALIGNMENT(mzd_row(T[z], 0), 16) != alignment)
+      return m4ri_dispatch.combine;
+#else
+  (void)M;
+  (void)T;
+  (void)n;
+#endif
+  return NULL;
+}
+
 void mzd_process_rows2(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol, int k,
                        mzd_t const *T0, rci_t const *L0, mzd_t const *T1, rci_t const *L1) {
   assert(k <= m4ri_radix);
@@ -367,8 +434,12 @@ void mzd_process_rows2(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
   word const ka_bm = __M4RI_LEFT_BITMASK(ka);
   word const kb_bm = __M4RI_LEFT_BITMASK(kb);
 
+  mzd_t const *T[2] = {T0, T1};
+  m4ri_combine_fn const combine = _mzd_combine_kernel(M, T, 2);
+
 #if __M4RI_HAVE_OPENMP
-#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,512) // MAX((__M4RI_CPU_L1_CACHE >> 3) / wide,
+  int const chunk = m4ri_omp_chunk(stoprow - startrow, wide);
+#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,chunk) if(m4ri_omp_parallel(stoprow - startrow, wide)) num_threads(m4ri_get_num_threads())
 #endif
   for(r = startrow; r < stoprow; ++r) {
     word bits = mzd_read_bits(M, r, startcol, k);
@@ -376,12 +447,15 @@ void mzd_process_rows2(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
     rci_t const x1 = L1[ bits & kb_bm ];
     if((x0 | x1) == 0)	// x0 == 0 && x1 == 0
       continue;
-    word *m0 = M->rows[r] + blocknum;
+    word *m0 = mzd_row(M, r) + blocknum;
     word const *t[2];
-    t[0] = T0->rows[x0] + blocknum;
-    t[1] = T1->rows[x1] + blocknum;
+    t[0] = mzd_row(T0, x0) + blocknum;
+    t[1] = mzd_row(T1, x1) + blocknum;
 
-    _mzd_combine_2( m0, t, wide);
+    if (combine)
+      combine(m0, t, 2, wide);
+    else
+      _mzd_combine_2(m0, t, wide);
   }
 
   __M4RI_DD_MZD(M);
@@ -405,8 +479,12 @@ void mzd_process_rows3(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
   word const kb_bm = __M4RI_LEFT_BITMASK(kb);
   word const kc_bm = __M4RI_LEFT_BITMASK(kc);
 
+  mzd_t const *T[3] = {T0, T1, T2};
+  m4ri_combine_fn const combine = _mzd_combine_kernel(M, T, 3);
+
 #if __M4RI_HAVE_OPENMP
-#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,512) //if(stoprow-startrow > 128)
+  int const chunk = m4ri_omp_chunk(stoprow - startrow, wide);
+#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,chunk) if(m4ri_omp_parallel(stoprow - startrow, wide)) num_threads(m4ri_get_num_threads())
 #endif
   for(r= startrow; r < stoprow; ++r) {
     word bits = mzd_read_bits(M, r, startcol, k);
@@ -416,13 +494,16 @@ void mzd_process_rows3(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
     if((x0 | x1 | x2) == 0) // x0 == 0 && x1 == 0 && x2 == 0
       continue;
 
-    word *m0 = M->rows[r] + blocknum;
+    word *m0 = mzd_row(M, r) + blocknum;
     word const *t[3];
-    t[0] = T0->rows[x0] + blocknum;
-    t[1] = T1->rows[x1] + blocknum;
-    t[2] = T2->rows[x2] + blocknum;
+    t[0] = mzd_row(T0, x0) + blocknum;
+    t[1] = mzd_row(T1, x1) + blocknum;
+    t[2] = mzd_row(T2, x2) + blocknum;
 
-    _mzd_combine_3( m0, t, wide);
+    if (combine)
+      combine(m0, t, 3, wide);
+    else
+      _mzd_combine_3(m0, t, wide);
   }
 
   __M4RI_DD_MZD(M);
@@ -449,8 +530,12 @@ void mzd_process_rows4(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
   word const kc_bm = __M4RI_LEFT_BITMASK(kc);
   word const kd_bm = __M4RI_LEFT_BITMASK(kd);
 
+  mzd_t const *T[4] = {T0, T1, T2, T3};
+  m4ri_combine_fn const combine = _mzd_combine_kernel(M, T, 4);
+
 #if __M4RI_HAVE_OPENMP
-#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,512) //if(stoprow-startrow > 128)
+  int const chunk = m4ri_omp_chunk(stoprow - startrow, wide);
+#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,chunk) if(m4ri_omp_parallel(stoprow - startrow, wide)) num_threads(m4ri_get_num_threads())
 #endif
   for(r = startrow; r < stoprow; ++r) {
     word bits = mzd_read_bits(M, r, startcol, k);
@@ -461,14 +546,17 @@ void mzd_process_rows4(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
     if(((x0 | x1) | (x2 | x3)) == 0) // x0 == 0 && x1 == 0 && x2 == 0 && x3 == 0
       continue;
 
-    word *m0 = M->rows[r] + blocknum;
+    word *m0 = mzd_row(M, r) + blocknum;
     word const *t[4];
-    t[0] = T0->rows[x0] + blocknum;
-    t[1] = T1->rows[x1] + blocknum;
-    t[2] = T2->rows[x2] + blocknum;
-    t[3] = T3->rows[x3] + blocknum;
+    t[0] = mzd_row(T0, x0) + blocknum;
+    t[1] = mzd_row(T1, x1) + blocknum;
+    t[2] = mzd_row(T2, x2) + blocknum;
+    t[3] = mzd_row(T3, x3) + blocknum;
 
-    _mzd_combine_4( m0, t, wide);
+    if (combine)
+      combine(m0, t, 4, wide);
+    else
+      _mzd_combine_4(m0, t, wide);
   }
 
   __M4RI_DD_MZD(M);
@@ -496,8 +584,12 @@ void mzd_process_rows5(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
   word const kd_bm = __M4RI_LEFT_BITMASK(kd);
   word const ke_bm = __M4RI_LEFT_BITMASK(ke);
 
+  mzd_t const *T[5] = {T0, T1, T2, T3, T4};
+  m4ri_combine_fn const combine = _mzd_combine_kernel(M, T, 5);
+
 #if __M4RI_HAVE_OPENMP
-#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,512) //if(stoprow-startrow > 128)
+  int const chunk = m4ri_omp_chunk(stoprow - startrow, wide);
+#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,chunk) if(m4ri_omp_parallel(stoprow - startrow, wide)) num_threads(m4ri_get_num_threads())
 #endif
   for(r = startrow; r < stoprow; ++r) {
     word bits = mzd_read_bits(M, r, startcol, k);
@@ -510,15 +602,18 @@ void mzd_process_rows5(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
     if(((x0 | x1 | x2) | (x3 | x4)) == 0) // x0 == 0 && x1 == 0 && x2 == 0 && x3 == 0 && x4 == 0
       continue;
 
-    word *m0 = M->rows[r] + blocknum;
+    word *m0 = mzd_row(M, r) + blocknum;
     word const *t[5];
-    t[0] = T0->rows[x0] + blocknum;
-    t[1] = T1->rows[x1] + blocknum;
-    t[2] = T2->rows[x2] + blocknum;
-    t[3] = T3->rows[x3] + blocknum;
-    t[4] = T4->rows[x4] + blocknum;
-
-    _mzd_combine_5( m0, t, wide);
+    t[0] = mzd_row(T0, x0) + blocknum;
+    t[1] = mzd_row(T1, x1) + blocknum;
+    t[2] = mzd_row(T2, x2) + blocknum;
+    t[3] = mzd_row(T3, x3) + blocknum;
+    t[4] = mzd_row(T4, x4) + blocknum;
+
+    if (combine)
+      combine(m0, t, 5, wide);
+    else
+      _mzd_combine_5(m0, t, wide);
   }
 
   __M4RI_DD_MZD(M);
@@ -550,8 +645,12 @@ void mzd_process_rows6(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
   word const ke_bm = __M4RI_LEFT_BITMASK(ke);
   word const kf_bm = __M4RI_LEFT_BITMASK(kf);
 
+  mzd_t const *T[6] = {T0, T1, T2, T3, T4, T5};
+  m4ri_combine_fn const combine = _mzd_combine_kernel(M, T, 6);
+
 #if __M4RI_HAVE_OPENMP
-#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,512) //if(stoprow-startrow > 128)
+  int const chunk = m4ri_omp_chunk(stoprow - startrow, wide);
+#pragma omp parallel for private(r) shared(startrow, stoprow) schedule(static,chunk) if(m4ri_omp_parallel(stoprow - startrow, wide)) num_threads(m4ri_get_num_threads())
 #endif
   for(r = startrow; r < stoprow; ++r) {
     word bits = mzd_read_bits(M, r, startcol, k);
@@ -567,22 +666,29 @@ void mzd_process_rows6(mzd_t *M, rci_t startrow, rci_t stoprow, rci_t startcol,
     if(((x0 | x1) | (x2 | x3) | (x4 | x5)) == 0) // x0 == 0 && x1 == 0 && x2 == 0 && x3 == 0 && x4 == 0 && x5 == 0
       continue;
 
-    word *m0 = M->rows[r] + blocknum;
+    word *m0 = mzd_row(M, r) + blocknum;
     word const *t[6];
-    t[0] = T0->rows[x0] + blocknum;
-    t[1] = T1->rows[x1] + blocknum;
-    t[2] = T2->rows[x2] + blocknum;
-    t[3] = T3->rows[x3] + blocknum;
-    t[4] = T4->rows[x4] + blocknum;
-    t[5] = T5->rows[x5] + blocknum;
-
-    _mzd_combine_6( m0, t, wide);
+    t[0] = mzd_row(T0, x0) + blocknum;
+    t[1] = mzd_row(T1, x1) + blocknum;
+    t[2] = mzd_row(T2, x2) + blocknum;
+    t[3] = mzd_row(T3, x3) + blocknum;
+    t[4] = mzd_row(T4, x4) + blocknum;
+    t[5] = mzd_row(T5, x5) + blocknum;
+
+    if (combine)
+      combine(m0, t, 6, wide);
+    else
+      _mzd_combine_6(m0, t, wide);
   }
 
   __M4RI_DD_MZD(M);
 }
 
 rci_t _mzd_echelonize_m4ri(mzd_t *A, int const full, int k, int heuristic, double const threshold) {
+  return _mzd_echelonize_m4ri_ws(A, full, k, heuristic, threshold, NULL);
+}
+
+rci_t _mzd_echelonize_m4ri_ws(mzd_t *A, int const full, int k, int heuristic, double const threshold, m4ri_workspace_t *ws) {
   /**
    * \par General algorithm
    * \li Step 1.Denote the first column to be processed in a given
@@ -621,28 +727,24 @@ rci_t _mzd_echelonize_m4ri(mzd_t *A, int const full, int k, int heuristic, doubl
    */
   rci_t const ncols = A->ncols;
 
+  /* the six tables must cover at most one word */
+  if (k < 0 || k > m4ri_radix / 6)
+    m4ri_die("mzd_echelonize_m4ri: k (%d) must be between 0 and %d.\n", k, m4ri_radix / 6);
+
   if (k == 0) {
-    k = m4ri_opt_k(A->nrows, ncols, 0);
-    if (k >= 7)
-      k = 7;
-    if (0.75 * __M4RI_TWOPOW(k) * ncols > __M4RI_CPU_L3_CACHE / 2.0)
-      k -= 1;
+    /* the rows of the tables shrink from A->width to one word */
+    k = m4ri_opt_k_tables(A->nrows, ncols, (A->width + 1) / 2, 6, m4ri_radix / 6);
   }
   int kk = 6 * k;
 
   mzd_t *U  = mzd_init(kk, ncols);
-  mzd_t *T0 = mzd_init(__M4RI_TWOPOW(k), ncols);
-  mzd_t *T1 = mzd_init(__M4RI_TWOPOW(k), ncols);
-  mzd_t *T2 = mzd_init(__M4RI_TWOPOW(k), ncols);
-  mzd_t *T3 = mzd_init(__M4RI_TWOPOW(k), ncols);
-  mzd_t *T4 = mzd_init(__M4RI_TWOPOW(k), ncols);
-  mzd_t *T5 = mzd_init(__M4RI_TWOPOW(k), ncols);
-  rci_t *L0 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L1 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L2 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L3 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L4 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L5 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
+
+  m4ri_workspace_t *tmp_ws = (ws == NULL) ? m4ri_workspace_init() : NULL;
+  if (ws == NULL)
+    ws = tmp_ws;
+  mzd_t *const *T = m4ri_workspace_tables(ws, k, ncols, 0);
+  mzd_t *T0 = T[0], *T1 = T[1], *T2 = T[2], *T3 = T[3], *T4 = T[4], *T5 = T[5];
+  rci_t *L0 = ws->L[0], *L1 = ws->L[1], *L2 = ws->L[2], *L3 = ws->L[3], *L4 = ws->L[4], *L5 = ws->L[5];
 
   rci_t last_check = 0;
   rci_t r = 0;
@@ -804,18 +906,7 @@ rci_t _mzd_echelonize_m4ri(mzd_t *A, int const full, int k, int heuristic, doubl
     }
   }
 
-  mzd_free(T0);
-  m4ri_mm_free(L0);
-  mzd_free(T1);
-  m4ri_mm_free(L1);
-  mzd_free(T2);
-  m4ri_mm_free(L2);
-  mzd_free(T3);
-  m4ri_mm_free(L3);
-  mzd_free(T4);
-  m4ri_mm_free(L4);
-  mzd_free(T5);
-  m4ri_mm_free(L5);
+  m4ri_workspace_free(tmp_ws);
   mzd_free(U);
 
   __M4RI_DD_MZD(A);
@@ -827,28 +918,21 @@ rci_t _mzd_top_echelonize_m4ri(mzd_t *A, int k, rci_t r, rci_t c, rci_t max_r) {
   rci_t const ncols = A->ncols;
   int kbar = 0;
 
+  /* the six tables must cover at most one word */
+  if (k < 0 || k > m4ri_radix / 6)
+    m4ri_die("mzd_top_echelonize_m4ri: k (%d) must be between 0 and %d.\n", k, m4ri_radix / 6);
+
   if (k == 0) {
-    k = m4ri_opt_k(max_r, A->ncols, 0);
-    if (k >= 7)
-      k = 7;
-    if (0.75 * __M4RI_TWOPOW(k) *A->ncols > __M4RI_CPU_L3_CACHE / 2.0)
-      k -= 1;
+    k = m4ri_opt_k_tables(max_r, A->ncols, (A->width + 1) / 2, 6, m4ri_radix / 6);
   }
   int kk = 6 * k;
 
   mzd_t *U  = mzd_init(kk, A->ncols);
-  mzd_t *T0 = mzd_init(__M4RI_TWOPOW(k), A->ncols);
-  mzd_t *T1 = mzd_init(__M4RI_TWOPOW(k), A->ncols);
-  mzd_t *T2 = mzd_init(__M4RI_TWOPOW(k), A->ncols);
-  mzd_t *T3 = mzd_init(__M4RI_TWOPOW(k), A->ncols);
-  mzd_t *T4 = mzd_init(__M4RI_TWOPOW(k), A->ncols);
-  mzd_t *T5 = mzd_init(__M4RI_TWOPOW(k), A->ncols);
-  rci_t *L0 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L1 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L2 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L3 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L4 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
-  rci_t *L5 = (rci_t*)m4ri_mm_calloc(__M4RI_TWOPOW(k), sizeof(rci_t));
+
+  m4ri_workspace_t *tmp_ws = m4ri_workspace_init();
+  mzd_t *const *T = m4ri_workspace_tables(tmp_ws, k, A->ncols, 0);
+  mzd_t *T0 = T[0], *T1 = T[1], *T2 = T[2], *T3 = T[3], *T4 = T[4], *T5 = T[5];
+  rci_t *L0 = tmp_ws->L[0], *L1 = tmp_ws->L[1], *L2 = tmp_ws->L[2], *L3 = tmp_ws->L[3], *L4 = tmp_ws->L[4], *L5 = tmp_ws->L[5];
 
   while(c < ncols) {
     if(c+kk > A->ncols) {
@@ -931,18 +1015,7 @@ rci_t _mzd_top_echelonize_m4ri(mzd_t *A, int k, rci_t r, rci_t c, rci_t max_r) {
     }
   }
 
-  mzd_free(T0);
-  m4ri_mm_free(L0);
-  mzd_free(T1);
-  m4ri_mm_free(L1);
-  mzd_free(T2);
-  m4ri_mm_free(L2);
-  mzd_free(T3);
-  m4ri_mm_free(L3);
-  mzd_free(T4);
-  m4ri_mm_free(L4);
-  mzd_free(T5);
-  m4ri_mm_free(L5);
+  m4ri_workspace_free(tmp_ws);
   mzd_free(U);
 
   __M4RI_DD_MZD(A);
@@ -990,7 +1063,7 @@ mzd_t *mzd_mul_m4rm(mzd_t *C, mzd_t const *A, mzd_t const *B, int k) {
   if(A->ncols != B->nrows)
     m4ri_die("mzd_mul_m4rm: A ncols (%d) need to match B nrows (%d).\n", A->ncols, B->nrows);
   if (C == NULL) {
-    C = mzd_init(a, c);
+    C = mzd_init_uninitialized(a, c);
   } else {
     if (C->nrows != a || C->ncols != c)
       m4ri_die("mzd_mul_m4rm: C (%d x %d) has wrong dimensions.\n", C->nrows, C->ncols);
@@ -1018,7 +1091,53 @@ mzd_t *mzd_addmul_m4rm(mzd_t *C, mzd_t const *A, mzd_t const *B, int k) {
 
 #define __M4RI_M4RM_NTABLES 8
 
-mzd_t *_mzd_mul_m4rm(mzd_t *C, mzd_t const *A, mzd_t const *B, int k, int clear) {
+#if __M4RI_M4RM_NTABLES > __M4RI_WORKSPACE_NTABLES
+#error "__M4RI_M4RM_NTABLES must not exceed __M4RI_WORKSPACE_NTABLES"
+#endif
+
+/*
+ * Compute m += t[0] + ... + t[n-1] with the inline kernels of xor.h.
+ */
+
+static inline void _mzd_combine_n(word *m, word const *t[], int n, wi_t wide) {
+  switch(n) {
+  case 8: _mzd_combine_8(m, t, wide); break;
+  case 7: _mzd_combine_7(m, t, wide); break;
+  case 6: _mzd_combine_6(m, t, wide); break;
+  case 5: _mzd_combine_5(m, t, wide); break;
+  case 4: _mzd_combine_4(m, t, wide); break;
+  case 3: _mzd_combine_3(m, t, wide); break;
+  case 2: _mzd_combine_2(m, t, wide); break;
+  case 1: _mzd_combine(m, t[0], wide); break;
+  }
+}
+
+/*
+ * Return the M4RM parameter k for the product of an a_nr x a_nc
+ * matrix with an a_nc x b_nc matrix.
+ */
+
+static inline int _mzd_mul_m4rm_k(rci_t a_nr, rci_t a_nc, rci_t b_nc) {
+  /* a tuned k is taken as it is, as long as the kernel supports it */
+  if (m4ri_profile.m4rm_k)
+    return MAX(MIN(m4ri_profile.m4rm_k, MIN(m4ri_radix / __M4RI_M4RM_NTABLES, __M4RI_MAXKAY)), 1);
+
+  /* the tables are rebuilt for each block of rows of A */
+  wi_t const b_width = (b_nc + m4ri_radix - 1) / m4ri_radix;
+  return m4ri_opt_k_tables(MIN(a_nr, m4ri_profile.mul_blocksize), a_nc, b_width,
+                           __M4RI_M4RM_NTABLES, m4ri_radix / __M4RI_M4RM_NTABLES);
+}
+
+/*
+ * The M4RM kernel of _mzd_mul_m4rm(), with the __M4RI_M4RM_NTABLES
+ * tables provided by the caller. Each T[z] must have at least 2^k
+ * rows of at least B->width words and each L[z] at least 2^k
+ * entries. If parallel is FALSE, the rows of C are never distributed
+ * over threads.
+ */
+
+static void _mzd_mul_m4rm_tables(mzd_t *C, mzd_t const *A, mzd_t const *B, int k, int clear,
+                                 mzd_t *const *T, rci_t *const *L, int parallel) {
   /**
    * The algorithm proceeds as follows:
    *
@@ -1036,155 +1155,181 @@ mzd_t *_mzd_mul_m4rm(mzd_t *C, mzd_t const *A, mzd_t const *B, int k, int clear)
    *   calculate \f$C_{jh} = C_{jh} + T_{xh}\f$.
    */
 
-  rci_t        x[__M4RI_M4RM_NTABLES];
-  rci_t       *L[__M4RI_M4RM_NTABLES];
   word  const *t[__M4RI_M4RM_NTABLES];
-  mzd_t       *T[__M4RI_M4RM_NTABLES];
-#ifdef __M4RI_HAVE_SSE2
-  mzd_t  *Talign[__M4RI_M4RM_NTABLES];
-  int c_align = (__M4RI_ALIGNMENT(C->rows[0], 16) == 8);
-#endif
 
   word *c;
 
   rci_t const a_nr = A->nrows;
   rci_t const a_nc = A->ncols;
-  rci_t const b_nc = B->ncols;
-
-  if (b_nc < m4ri_radix-10 || a_nr < 16) {
-    if(clear)
-      return mzd_mul_naive(C, A, B);
-    else
-      return mzd_addmul_naive(C, A, B);
-  }
-
-  /* clear first */
-  if (clear) {
-    mzd_set_ui(C, 0);
-  }
-
-  const int blocksize = __M4RI_MUL_BLOCKSIZE;
-
-  if(k==0) {
-    /* __M4RI_CPU_L2_CACHE == 2^k * B->width * 8 * 8 */
-    k = (int)log2((__M4RI_CPU_L2_CACHE/64)/(double)B->width);
-    if ((__M4RI_CPU_L2_CACHE - 64*__M4RI_TWOPOW(k)*B->width) > (64*__M4RI_TWOPOW(k+1)*B->width - __M4RI_CPU_L2_CACHE))
-      k++;
 
-    rci_t const klog = round(0.75 * log2_floor(MIN(MIN(a_nr,a_nc),b_nc)));
-
-    if(klog < k)
-      k = klog;
-
-    if (k<2)
-      k=2;
-    else if(k>6)
-      k=6;
-  }
+  const int blocksize = m4ri_profile.mul_blocksize;
 
   const wi_t wide = C->width;
   const word bm = __M4RI_TWOPOW(k)-1;
+  m4ri_combine_fn const combine = _mzd_combine_kernel(C, (mzd_t const *const *)T, __M4RI_M4RM_NTABLES);
 
-  rci_t *buffer = (rci_t*)m4ri_mm_malloc(__M4RI_M4RM_NTABLES * __M4RI_TWOPOW(k) * sizeof(rci_t));
-  for(int z=0; z<__M4RI_M4RM_NTABLES; z++) {
-    L[z] = buffer + z*__M4RI_TWOPOW(k);
-#ifdef __M4RI_HAVE_SSE2
-    /* we make sure that T are aligned as C */
-    Talign[z] = mzd_init(__M4RI_TWOPOW(k), b_nc+m4ri_radix);
-    T[z] = mzd_init_window(Talign[z], 0, c_align*m4ri_radix, Talign[z]->nrows, b_nc + c_align*m4ri_radix);
-#else
-    T[z] = mzd_init(__M4RI_TWOPOW(k), b_nc);
-#endif
-  }
-
-  /* process stuff that fits into multiple of k first, but blockwise (babystep-giantstep)*/
+  /*
+   * We process A in steps of kk columns. The last step covers the
+   * remaining a_nc % kk columns with as many tables as it needs,
+   * where the last table may be for fewer than k columns, such that
+   * it runs through the same combined update as all others.
+   */
   int const kk = __M4RI_M4RM_NTABLES * k;
   assert(kk <= m4ri_radix);
   rci_t const end = a_nc / kk;
+  int const rem = a_nc % kk;
+  rci_t const steps = end + (rem ? 1 : 0);
+
+  /* if there is a main loop it clears each row of C right before its first use, see below */
+  if (clear && steps == 0) {
+    mzd_set_ui(C, 0);
+  }
 
   for (rci_t giantstep = 0; giantstep < a_nr; giantstep += blocksize) {
-    for(rci_t i = 0; i < end; ++i) {
-      for(int z=0; z<__M4RI_M4RM_NTABLES; z++) {
-        mzd_make_table( B, kk*i + k*z, 0, k, T[z], L[z]);
+    for(rci_t i = 0; i < steps; ++i) {
+      int const nbits = (i < end) ? kk : rem;
+      int const ntables = (nbits + k - 1) / k;
+
+      for(int z=0; z<ntables; z++) {
+        mzd_make_table( B, kk*i + k*z, 0, MIN(k, nbits - k*z), T[z], L[z]);
       }
 
       const rci_t blockend = MIN(giantstep+blocksize, a_nr);
 #if __M4RI_HAVE_OPENMP
-#pragma omp parallel for schedule(static,512) private(x,t)
+      int const chunk = m4ri_omp_chunk(blockend - giantstep, wide);
+#pragma omp parallel for schedule(static,chunk) private(t,c) if(parallel && m4ri_omp_parallel(blockend - giantstep, wide)) num_threads(m4ri_get_num_threads())
 #endif
       for(rci_t j = giantstep; j < blockend; j++) {
-        const word a = mzd_read_bits(A, j, kk*i, kk);
-
-        switch(__M4RI_M4RM_NTABLES) {
-        case 8: t[7] = T[ 7]->rows[ L[7][ (a >> 7*k) & bm ] ];
-        case 7: t[6] = T[ 6]->rows[ L[6][ (a >> 6*k) & bm ] ];
-        case 6: t[5] = T[ 5]->rows[ L[5][ (a >> 5*k) & bm ] ];
-        case 5: t[4] = T[ 4]->rows[ L[4][ (a >> 4*k) & bm ] ];
-        case 4: t[3] = T[ 3]->rows[ L[3][ (a >> 3*k) & bm ] ];
-        case 3: t[2] = T[ 2]->rows[ L[2][ (a >> 2*k) & bm ] ];
-        case 2: t[1] = T[ 1]->rows[ L[1][ (a >> 1*k) & bm ] ];
-        case 1: t[0] = T[ 0]->rows[ L[0][ (a >> 0*k) & bm ] ];
+        const word a = mzd_read_bits(A, j, kk*i, nbits);
+
+        switch(ntables) {
+        case 8: t[7] = mzd_row(T[ 7], L[7][ (a >> 7*k) & bm ]);
+        case 7: t[6] = mzd_row(T[ 6], L[6][ (a >> 6*k) & bm ]);
+        case 6: t[5] = mzd_row(T[ 5], L[5][ (a >> 5*k) & bm ]);
+        case 5: t[4] = mzd_row(T[ 4], L[4][ (a >> 4*k) & bm ]);
+        case 4: t[3] = mzd_row(T[ 3], L[3][ (a >> 3*k) & bm ]);
+        case 3: t[2] = mzd_row(T[ 2], L[2][ (a >> 2*k) & bm ]);
+        case 2: t[1] = mzd_row(T[ 1], L[1][ (a >> 1*k) & bm ]);
+        case 1: t[0] = mzd_row(T[ 0], L[0][ (a >> 0*k) & bm ]);
           break;
         default:
           m4ri_die("__M4RI_M4RM_NTABLES must be <= 8 but got %d", __M4RI_M4RM_NTABLES);
         }
 
-        c = C->rows[j];
-
-        switch(__M4RI_M4RM_NTABLES) {
-        case 8: _mzd_combine_8(c, t, wide); break;
-        case 7: _mzd_combine_7(c, t, wide); break;
-        case 6: _mzd_combine_6(c, t, wide); break;
-        case 5: _mzd_combine_5(c, t, wide); break;
-        case 4: _mzd_combine_4(c, t, wide); break;
-        case 3: _mzd_combine_3(c, t, wide); break;
-        case 2: _mzd_combine_2(c, t, wide); break;
-        case 1: _mzd_combine(c, t[0], wide);
-          break;
-        default:
-          m4ri_die("__M4RI_M4RM_NTABLES must be <= 8 but got %d", __M4RI_M4RM_NTABLES);
+        c = mzd_row(C, j);
+
+        if (clear && i == 0) {
+          /* the last word may be shared with columns outside of the window C */
+          for(wi_t ii = 0; ii < wide - 1; ++ii)
+            c[ii] = 0;
+          c[wide - 1] &= ~C->high_bitmask;
         }
+
+        if (combine)
+          combine(c, t, ntables, wide);
+        else
+          _mzd_combine_n(c, t, ntables, wide);
       }
     }
   }
 
-  /* handle stuff that doesn't fit into multiple of kk */
-  if (a_nc%kk) {
-    rci_t i;
-    for (i = kk / k * end; i < a_nc / k; ++i) {
-      mzd_make_table( B, k*i, 0, k, T[0], L[0]);
-      for(rci_t j = 0; j < a_nr; ++j) {
-        x[0] = L[0][ mzd_read_bits_int(A, j, k*i, k) ];
-        c = C->rows[j];
-        t[0] = T[0]->rows[x[0]];
-        for(wi_t ii = 0; ii < wide; ++ii) {
-          c[ii] ^= t[0][ii];
-        }
-      }
-    }
-    /* handle stuff that doesn't fit into multiple of k */
-    if (a_nc%k) {
-      mzd_make_table( B, k*(a_nc/k), 0, a_nc%k, T[0], L[0]);
-      for(rci_t j = 0; j < a_nr; ++j) {
-        x[0] = L[0][ mzd_read_bits_int(A, j, k*i, a_nc%k) ];
-        c = C->rows[j];
-        t[0] = T[0]->rows[x[0]];
-        for(wi_t ii = 0; ii < wide; ++ii) {
-          c[ii] ^= t[0][ii];
-        }
-      }
-    }
+  __M4RI_DD_MZD(C);
+}
+
+mzd_t *_mzd_mul_m4rm(mzd_t *C, mzd_t const *A, mzd_t const *B, int k, int clear) {
+  return _mzd_mul_m4rm_ws(C, A, B, k, clear, NULL);
+}
+
+/*
+ * The body of _mzd_mul_m4rm_ws(). If parallel is FALSE, the rows of
+ * C are never distributed over threads, such that it may be called
+ * for many products at once as in mzd_mul_batch().
+ */
+
+static mzd_t *_mzd_mul_m4rm_impl(mzd_t *C, mzd_t const *A, mzd_t const *B, int k, int clear,
+                                 m4ri_workspace_t *ws, int parallel) {
+  rci_t const a_nr = A->nrows;
+  rci_t const a_nc = A->ncols;
+  rci_t const b_nc = B->ncols;
+
+  if (b_nc < m4ri_radix-10 || a_nr < 16) {
+    if(clear)
+      return mzd_mul_naive(C, A, B);
+    else
+      return mzd_addmul_naive(C, A, B);
   }
 
-  for(int j=0; j<__M4RI_M4RM_NTABLES; j++) {
-    mzd_free(T[j]);
+  /*
+   * For wide B we work on panels of columns of B and C, such that the
+   * tables of a panel fit into L2 for a large k, instead of letting
+   * tables spanning all of B push k down.
+   */
+  wi_t const panel = (B->width > 2 * __M4RI_M4RM_PANEL_WIDTH) ? __M4RI_M4RM_PANEL_WIDTH : B->width;
+  rci_t const t_nc = MIN(panel * m4ri_radix, b_nc);
+
+  if(k==0)
+    k = _mzd_mul_m4rm_k(a_nr, a_nc, t_nc);
+
 #ifdef __M4RI_HAVE_SSE2
-    mzd_free(Talign[j]);
+  /* we make sure that T are aligned as C */
+  rci_t const offset = (__M4RI_ALIGNMENT(mzd_row(C, 0), 16) == 8) ? m4ri_radix : 0;
+#else
+  rci_t const offset = 0;
 #endif
+
+  m4ri_workspace_t *tmp_ws = (ws == NULL) ? m4ri_workspace_init() : NULL;
+  if (ws == NULL)
+    ws = tmp_ws;
+  mzd_t *const *T = m4ri_workspace_tables(ws, k, t_nc, offset);
+  rci_t *const *L = ws->L;
+
+  if (panel == B->width) {
+    _mzd_mul_m4rm_tables(C, A, B, k, clear, T, L, parallel);
+  } else {
+    for (rci_t lowc = 0; lowc < b_nc; lowc += t_nc) {
+      rci_t const highc = MIN(lowc + t_nc, b_nc);
+      mzd_t const *Bp = mzd_init_window_const(B, 0, lowc, B->nrows, highc);
+      mzd_t *Cp = mzd_init_window(C, 0, lowc, C->nrows, highc);
+      _mzd_mul_m4rm_tables(Cp, A, Bp, k, clear, T, L, parallel);
+      mzd_free_window(Cp);
+      mzd_free_window((mzd_t*)Bp);
+    }
   }
-  m4ri_mm_free(buffer);
+
+  m4ri_workspace_free(tmp_ws);
 
   __M4RI_DD_MZD(C);
   return C;
 }
 
+mzd_t *_mzd_mul_m4rm_ws(mzd_t *C, mzd_t const *A, mzd_t const *B, int k, int clear, m4ri_workspace_t *ws) {
+  return _mzd_mul_m4rm_impl(C, A, B, k, clear, ws, TRUE);
+}
+
+void mzd_mul_batch(mzd_t **C, mzd_t const *const *A, mzd_t const *const *B, int count, int k) {
+  for (int i = 0; i < count; ++i) {
+    if (A[i]->ncols != B[i]->nrows)
+      m4ri_die("mzd_mul_batch: A[%d] ncols (%d) need to match B[%d] nrows (%d).\n", i, A[i]->ncols, i, B[i]->nrows);
+    if (C[i] != NULL && (C[i]->nrows != A[i]->nrows || C[i]->ncols != B[i]->ncols))
+      m4ri_die("mzd_mul_batch: C[%d] (%d x %d) has wrong dimensions.\n", i, C[i]->nrows, C[i]->ncols);
+  }
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel num_threads(m4ri_get_num_threads()) if(count > 1)
+#endif
+  {
+    /* tables are grown as needed and reused for all products of this thread */
+    m4ri_workspace_t *ws = m4ri_workspace_init();
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp for schedule(dynamic,4)
+#endif
+    for (int i = 0; i < count; ++i) {
+      if (C[i] == NULL)
+        C[i] = mzd_init_uninitialized(A[i]->nrows, B[i]->ncols);
+      _mzd_mul_m4rm_impl(C[i], A[i], B[i], k, TRUE, ws, FALSE);
+    }
+
+    m4ri_workspace_free(ws);
+  }
+}
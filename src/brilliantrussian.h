@@ -40,6 +40,28 @@
 
 #include <m4ri/mzd.h>
 #include <m4ri/mzp.h>
+#include <m4ri/workspace.h>
+
+/**
+ * \brief Minimal number of words each thread handles in mzd_make_table().
+ *
+ * Tables for narrower matrices are built by a single thread.
+ */
+
+#ifndef __M4RI_MAKE_TABLE_SLICE_WIDTH
+#define __M4RI_MAKE_TABLE_SLICE_WIDTH 64
+#endif
+
+/**
+ * \brief Width in words of the panels of B processed at a time by _mzd_mul_m4rm().
+ *
+ * Eight tables with 2^6 rows of this width fill __M4RI_CPU_L2_CACHE.
+ * B of more than twice this width is split into panels.
+ */
+
+#ifndef __M4RI_M4RM_PANEL_WIDTH
+#define __M4RI_M4RM_PANEL_WIDTH MAX(__M4RI_CPU_L2_CACHE / (8 * 64 * (int)sizeof(word)), 8)
+#endif
 
 /**
  * \brief Constructs all possible \f$2^k\f$ row combinations using the gray
@@ -52,6 +74,9 @@
  * \param T prealloced matrix of dimension \f$2^k\f$ x m->ncols
  * \param L prealloced table of length \f$2^k\f$
  *
+ * With OpenMP, the columns of wide tables are split over threads, see
+ * __M4RI_MAKE_TABLE_SLICE_WIDTH.
+ *
  * \wordoffset
  */
 
@@ -216,7 +241,7 @@ void mzd_process_rows6(mzd_t *M, rci_t startrow, rci_t endrow, rci_t startcol, i
  * 
  * \param M Matrix to be reduced.
  * \param full Return the reduced row echelon form, not only upper triangular form.
- * \param k M4RI parameter, may be 0 for auto-choose.
+ * \param k M4RI parameter, at most m4ri_radix / 6, may be 0 for auto-choose.
  *
  * \example testsuite/test_elimination.c
  * \example testsuite/bench_elimination.c
@@ -228,12 +253,33 @@ void mzd_process_rows6(mzd_t *M, rci_t startrow, rci_t endrow, rci_t startcol, i
 
 rci_t _mzd_echelonize_m4ri(mzd_t *A, const int full, int k, int heuristic, const double threshold);
 
+/**
+ * \brief Matrix elimination using the 'Method of the Four Russians'
+ * (M4RI) and the tables of a workspace.
+ *
+ * See _mzd_echelonize_m4ri(), the tables are taken from ws instead of
+ * being allocated by this call.
+ *
+ * \param A Matrix to be reduced.
+ * \param full Return the reduced row echelon form, not only upper triangular form.
+ * \param k M4RI parameter, at most m4ri_radix / 6, may be 0 for auto-choose.
+ * \param heuristic Switch to PLUQ once the density reaches threshold.
+ * \param threshold Density threshold for heuristic.
+ * \param ws Workspace or NULL.
+ *
+ * \wordoffset
+ *
+ * \return Rank of A.
+ */
+
+rci_t _mzd_echelonize_m4ri_ws(mzd_t *A, const int full, int k, int heuristic, const double threshold, m4ri_workspace_t *ws);
+
 /**
  * \brief Given a matrix in upper triangular form compute the reduced row
  * echelon form of that matrix.
  * 
  * \param M Matrix to be reduced.
- * \param k M4RI parameter, may be 0 for auto-choose.
+ * \param k M4RI parameter, at most m4ri_radix / 6, may be 0 for auto-choose.
  *
  * \wordoffset
  *
@@ -247,7 +293,7 @@ void mzd_top_echelonize_m4ri(mzd_t *M, int k);
  * the pivot at (r,c).
  * 
  * \param A Matrix to be reduced.
- * \param k M4RI parameter, may be 0 for auto-choose.
+ * \param k M4RI parameter, at most m4ri_radix / 6, may be 0 for auto-choose.
  * \param r Row index.
  * \param c Column index.
  * \param max_r Only clear top max_r rows.
@@ -320,6 +366,9 @@ mzd_t *mzd_addmul_m4rm(mzd_t *C, mzd_t const *A, mzd_t const *B, int k);
  * William Hart; Efficient Multiplication of Dense Matrices over
  * GF(2); pre-print available at http://arxiv.org/abs/0811.1714
  *
+ * If B is wider than twice __M4RI_M4RM_PANEL_WIDTH, B and C are
+ * processed in panels of columns, such that the tables stay in cache.
+ *
  * \param C Preallocated product matrix.
  * \param A Input matrix A
  * \param B Input matrix B
@@ -337,5 +386,43 @@ mzd_t *mzd_addmul_m4rm(mzd_t *C, mzd_t const *A, mzd_t const *B, int k);
 
 mzd_t *_mzd_mul_m4rm(mzd_t *C, mzd_t const *A, mzd_t const *B, int k, int clear);
 
+/**
+ * \brief Matrix multiplication using Konrod's method and the tables of a workspace.
+ *
+ * See _mzd_mul_m4rm(), the tables are taken from ws instead of being
+ * allocated by this call.
+ *
+ * \param C Preallocated product matrix.
+ * \param A Input matrix A
+ * \param B Input matrix B
+ * \param k M4RI parameter, may be 0 for auto-choose.
+ * \param clear clear the matrix C first
+ * \param ws Workspace or NULL.
+ *
+ * \wordoffset
+ *
+ * \return Pointer to C.
+ */
+
+mzd_t *_mzd_mul_m4rm_ws(mzd_t *C, mzd_t const *A, mzd_t const *B, int k, int clear, m4ri_workspace_t *ws);
+
+/**
+ * \brief Compute C[i] = A[i] B[i] for 0 <= i < count using Konrod's method.
+ *
+ * This is meant for many small products. The products are
+ * distributed over threads and each thread keeps one workspace for
+ * all its products.
+ *
+ * \param C Array of count preallocated product matrices, NULL entries are allocated.
+ * \param A Array of count input matrices A.
+ * \param B Array of count input matrices B.
+ * \param count Number of products.
+ * \param k M4RI parameter, may be 0 for auto-choose per product.
+ *
+ * \wordoffset
+ */
+
+void mzd_mul_batch(mzd_t **C, mzd_t const *const *A, mzd_t const *const *B, int count, int k);
+
 
 #endif // M4RI_BRILLIANTRUSSIAN_H
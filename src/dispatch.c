@@ -0,0 +1,374 @@
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "dispatch.h"
+#include "mzd.h"
+#include "xor.h"
+
+/*
+ * We can only compile kernels for instruction sets beyond the
+ * configured one if the compiler supports per-function target
+ * attributes and __builtin_cpu_supports.
+ */
+
+#if __M4RI_HAVE_SSE2 && (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || __M4RI_GNUC_PREREQ(5,0))
+#define __M4RI_DISPATCH_X86 1
+#include <immintrin.h>
+#else
+#define __M4RI_DISPATCH_X86 0
+#endif
+
+/**
+ * The instruction set the inline kernels in xor.h were compiled for.
+ */
+
+#if __M4RI_HAVE_AVX512F
+#define __M4RI_SIMD_CONFIGURED m4ri_simd_avx512
+#elif __M4RI_HAVE_AVX2
+#define __M4RI_SIMD_CONFIGURED m4ri_simd_avx2
+#elif __M4RI_HAVE_SSE2
+#define __M4RI_SIMD_CONFIGURED m4ri_simd_sse2
+#else
+#define __M4RI_SIMD_CONFIGURED m4ri_simd_none
+#endif
+
+/* defined in mzd.c */
+void _mzd_copy_transpose_64x64_default(word *RESTRICT dst, word const *RESTRICT src, wi_t rowstride_dst, wi_t rowstride_src);
+
+/*
+ * Kernels for the configured instruction set.
+ */
+
+static void _m4ri_combine_default(word *m, word const *t[], int n, wi_t wide) {
+  assert(1 <= n && n <= 8);
+  word const *tt[8];
+  int same_alignment = 1;
+  for(int j = 0; j < n; ++j) {
+    tt[j] = t[j];
+    same_alignment &= (__M4RI_ALIGNMENT(m,16) == __M4RI_ALIGNMENT(t[j],16));
+  }
+
+  if (__M4RI_UNLIKELY(!same_alignment)) {
+    for(wi_t i = 0; i < wide; ++i) {
+      word tmp = m[i];
+      for(int j = 0; j < n; ++j)
+        tmp ^= t[j][i];
+      m[i] = tmp;
+    }
+    return;
+  }
+
+  switch(n) {
+  case 8: _mzd_combine_8(m, tt, wide); break;
+  case 7: _mzd_combine_7(m, tt, wide); break;
+  case 6: _mzd_combine_6(m, tt, wide); break;
+  case 5: _mzd_combine_5(m, tt, wide); break;
+  case 4: _mzd_combine_4(m, tt, wide); break;
+  case 3: _mzd_combine_3(m, tt, wide); break;
+  case 2: _mzd_combine_2(m, tt, wide); break;
+  case 1: _mzd_combine(m, tt[0], wide); break;
+  }
+}
+
+#define MASK(c)    (((uint64_t)(-1)) / (__M4RI_TWOPOW(__M4RI_TWOPOW(c)) + 1))
+#define COUNT(x,c) ((x) & MASK(c)) + (((x) >> (__M4RI_TWOPOW(c))) & MASK(c))
+
+static uint64_t _m4ri_popcount_default(word const *v, wi_t wide) {
+  uint64_t count = 0;
+  for(wi_t i = 0; i < wide; ++i) {
+    uint64_t n = __M4RI_CONVERT_TO_UINT64_T(v[i]);
+    n = COUNT(n, 0);
+    n = COUNT(n, 1);
+    n = COUNT(n, 2);
+    n = COUNT(n, 3);
+    n = COUNT(n, 4);
+    n = COUNT(n, 5);
+    count += n;
+  }
+  return count;
+}
+
+#if __M4RI_DISPATCH_X86
+
+/*
+ * POPCNT
+ */
+
+__attribute__((target("popcnt")))
+static uint64_t _m4ri_popcount_popcnt(word const *v, wi_t wide) {
+  uint64_t count = 0;
+  for(wi_t i = 0; i < wide; ++i)
+    count += __builtin_popcountll(v[i]);
+  return count;
+}
+
+/*
+ * AVX2
+ */
+
+__attribute__((target("avx2")))
+static void _m4ri_combine_avx2(word *m, word const *t[], int n, wi_t wide) {
+  assert(1 <= n && n <= 8);
+  wi_t i = 0;
+  __m256i ymm0, ymm1;
+  for(; i + 4 <= wide; i += 4) {
+    ymm0 = _mm256_loadu_si256((__m256i const*)(m + i));
+    ymm1 = _mm256_setzero_si256();
+    switch(n) {
+    case 8: ymm1 = _mm256_xor_si256(ymm1, _mm256_loadu_si256((__m256i const*)(t[7] + i)));
+    case 7: ymm0 = _mm256_xor_si256(ymm0, _mm256_loadu_si256((__m256i const*)(t[6] + i)));
+    case 6: ymm1 = _mm256_xor_si256(ymm1, _mm256_loadu_si256((__m256i const*)(t[5] + i)));
+    case 5: ymm0 = _mm256_xor_si256(ymm0, _mm256_loadu_si256((__m256i const*)(t[4] + i)));
+    case 4: ymm1 = _mm256_xor_si256(ymm1, _mm256_loadu_si256((__m256i const*)(t[3] + i)));
+    case 3: ymm0 = _mm256_xor_si256(ymm0, _mm256_loadu_si256((__m256i const*)(t[2] + i)));
+    case 2: ymm1 = _mm256_xor_si256(ymm1, _mm256_loadu_si256((__m256i const*)(t[1] + i)));
+    case 1: ymm0 = _mm256_xor_si256(ymm0, _mm256_loadu_si256((__m256i const*)(t[0] + i)));
+    }
+    _mm256_storeu_si256((__m256i*)(m + i), _mm256_xor_si256(ymm0, ymm1));
+  }
+  for(; i < wide; ++i) {
+    word tmp = m[i];
+    for(int j = 0; j < n; ++j)
+      tmp ^= t[j][i];
+    m[i] = tmp;
+  }
+}
+
+/**
+ * One step of the 64 x 64 transpose for rows k and k + j, see _mzd_copy_transpose_64x64.
+ */
+#define __M4RI_TRANSPOSE_STEP(a, b, j, m, SRL, SLL, XOR, AND) \
+  do {                                                          \
+    tmp = AND(XOR(SRL(a, j), b), m);                            \
+    a = XOR(a, SLL(tmp, j));                                    \
+    b = XOR(b, tmp);                                            \
+  } while(0)
+
+__attribute__((target("avx2")))
+static void _m4ri_transpose_64x64_avx2(word *RESTRICT dst, word const *RESTRICT src, wi_t rowstride_dst, wi_t rowstride_src) {
+  /* v[i] holds rows 4i, ..., 4i+3 */
+  __m256i v[16];
+  __m256i tmp;
+  __m256i const gather = _mm256_set_epi64x(3*rowstride_src, 2*rowstride_src, rowstride_src, 0);
+  for(int i = 0; i < 16; ++i)
+    v[i] = _mm256_i64gather_epi64((long long const*)(src + 4*i*rowstride_src), gather, 8);
+
+  /* j = 32, 16, 8, 4 swap across registers */
+  word mw = __M4RI_CONVERT_TO_WORD(0xFFFFFFFF);
+  for(int j = 32; j >= 4; j >>= 1, mw ^= mw << j) {
+    __m256i const m = _mm256_set1_epi64x(mw);
+    int const J = j / 4;
+    for(int i = 0; i < 16; ++i) {
+      if (i & J)
+        continue;
+      switch(j) {
+      case 32: __M4RI_TRANSPOSE_STEP(v[i], v[i+J], 32, m, _mm256_srli_epi64, _mm256_slli_epi64, _mm256_xor_si256, _mm256_and_si256); break;
+      case 16: __M4RI_TRANSPOSE_STEP(v[i], v[i+J], 16, m, _mm256_srli_epi64, _mm256_slli_epi64, _mm256_xor_si256, _mm256_and_si256); break;
+      case  8: __M4RI_TRANSPOSE_STEP(v[i], v[i+J],  8, m, _mm256_srli_epi64, _mm256_slli_epi64, _mm256_xor_si256, _mm256_and_si256); break;
+      case  4: __M4RI_TRANSPOSE_STEP(v[i], v[i+J],  4, m, _mm256_srli_epi64, _mm256_slli_epi64, _mm256_xor_si256, _mm256_and_si256); break;
+      }
+    }
+  }
+
+  /* j = 2, 1 swap within registers: lanes (0,2),(1,3) and then (0,1),(2,3) */
+  __m256i const m2 = _mm256_set_epi64x(0, 0, 0x3333333333333333ULL, 0x3333333333333333ULL);
+  __m256i const m1 = _mm256_set_epi64x(0, 0x5555555555555555ULL, 0, 0x5555555555555555ULL);
+  for(int i = 0; i < 16; ++i) {
+    tmp = _mm256_and_si256(_mm256_xor_si256(_mm256_srli_epi64(v[i], 2), _mm256_permute4x64_epi64(v[i], 0x4E)), m2);
+    v[i] = _mm256_xor_si256(v[i], _mm256_xor_si256(_mm256_slli_epi64(tmp, 2), _mm256_permute4x64_epi64(tmp, 0x4E)));
+    tmp = _mm256_and_si256(_mm256_xor_si256(_mm256_srli_epi64(v[i], 1), _mm256_permute4x64_epi64(v[i], 0xB1)), m1);
+    v[i] = _mm256_xor_si256(v[i], _mm256_xor_si256(_mm256_slli_epi64(tmp, 1), _mm256_permute4x64_epi64(tmp, 0xB1)));
+  }
+
+  word out[4];
+  for(int i = 0; i < 16; ++i) {
+    _mm256_storeu_si256((__m256i*)out, v[i]);
+    dst[(4*i + 0) * rowstride_dst] = out[0];
+    dst[(4*i + 1) * rowstride_dst] = out[1];
+    dst[(4*i + 2) * rowstride_dst] = out[2];
+    dst[(4*i + 3) * rowstride_dst] = out[3];
+  }
+}
+
+/*
+ * AVX-512F
+ */
+
+__attribute__((target("avx512f")))
+static void _m4ri_combine_avx512(word *m, word const *t[], int n, wi_t wide) {
+  assert(1 <= n && n <= 8);
+  wi_t i = 0;
+  __m512i zmm0;
+  __mmask8 mask = 0xFF;
+  /* vpternlogq with immediate 0x96 computes a ^ b ^ c */
+  for(; i < wide; i += 8) {
+    if (wide - i < 8)
+      mask = (__mmask8)((1U << (wide - i)) - 1);
+    zmm0 = _mm512_maskz_loadu_epi64(mask, m + i);
+    switch(n) {
+    case 8: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_maskz_loadu_epi64(mask, t[7] + i), _mm512_maskz_loadu_epi64(mask, t[6] + i), 0x96);
+    case 6: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_maskz_loadu_epi64(mask, t[5] + i), _mm512_maskz_loadu_epi64(mask, t[4] + i), 0x96);
+    case 4: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_maskz_loadu_epi64(mask, t[3] + i), _mm512_maskz_loadu_epi64(mask, t[2] + i), 0x96);
+    case 2: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_maskz_loadu_epi64(mask, t[1] + i), _mm512_maskz_loadu_epi64(mask, t[0] + i), 0x96);
+      break;
+    case 7: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_maskz_loadu_epi64(mask, t[6] + i), _mm512_maskz_loadu_epi64(mask, t[5] + i), 0x96);
+    case 5: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_maskz_loadu_epi64(mask, t[4] + i), _mm512_maskz_loadu_epi64(mask, t[3] + i), 0x96);
+    case 3: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_maskz_loadu_epi64(mask, t[2] + i), _mm512_maskz_loadu_epi64(mask, t[1] + i), 0x96);
+    case 1: zmm0 = _mm512_xor_si512(zmm0, _mm512_maskz_loadu_epi64(mask, t[0] + i));
+    }
+    _mm512_mask_storeu_epi64(m + i, mask, zmm0);
+  }
+}
+
+__attribute__((target("avx512f")))
+static void _m4ri_transpose_64x64_avx512(word *RESTRICT dst, word const *RESTRICT src, wi_t rowstride_dst, wi_t rowstride_src) {
+  /* v[i] holds rows 8i, ..., 8i+7 */
+  __m512i v[8];
+  __m512i tmp;
+  __m512i const src_index = _mm512_set_epi64(7*rowstride_src, 6*rowstride_src, 5*rowstride_src, 4*rowstride_src,
+                                             3*rowstride_src, 2*rowstride_src, 1*rowstride_src, 0);
+  __m512i const dst_index = _mm512_set_epi64(7*rowstride_dst, 6*rowstride_dst, 5*rowstride_dst, 4*rowstride_dst,
+                                             3*rowstride_dst, 2*rowstride_dst, 1*rowstride_dst, 0);
+  for(int i = 0; i < 8; ++i)
+    v[i] = _mm512_i64gather_epi64(src_index, (long long const*)(src + 8*i*rowstride_src), 8);
+
+  /* j = 32, 16, 8 swap across registers */
+  word mw = __M4RI_CONVERT_TO_WORD(0xFFFFFFFF);
+  for(int j = 32; j >= 8; j >>= 1, mw ^= mw << j) {
+    __m512i const m = _mm512_set1_epi64(mw);
+    int const J = j / 8;
+    for(int i = 0; i < 8; ++i) {
+      if (i & J)
+        continue;
+      switch(j) {
+      case 32: __M4RI_TRANSPOSE_STEP(v[i], v[i+J], 32, m, _mm512_srli_epi64, _mm512_slli_epi64, _mm512_xor_si512, _mm512_and_si512); break;
+      case 16: __M4RI_TRANSPOSE_STEP(v[i], v[i+J], 16, m, _mm512_srli_epi64, _mm512_slli_epi64, _mm512_xor_si512, _mm512_and_si512); break;
+      case  8: __M4RI_TRANSPOSE_STEP(v[i], v[i+J],  8, m, _mm512_srli_epi64, _mm512_slli_epi64, _mm512_xor_si512, _mm512_and_si512); break;
+      }
+    }
+  }
+
+  /* j = 4, 2, 1 swap within registers: lane l is paired with lane l ^ j */
+  __m512i const p4 = _mm512_set_epi64(3, 2, 1, 0, 7, 6, 5, 4);
+  __m512i const p2 = _mm512_set_epi64(5, 4, 7, 6, 1, 0, 3, 2);
+  __m512i const p1 = _mm512_set_epi64(6, 7, 4, 5, 2, 3, 0, 1);
+  __m512i const m4 = _mm512_set1_epi64(0x0F0F0F0F0F0F0F0FULL);
+  __m512i const m2 = _mm512_set1_epi64(0x3333333333333333ULL);
+  __m512i const m1 = _mm512_set1_epi64(0x5555555555555555ULL);
+  for(int i = 0; i < 8; ++i) {
+    tmp = _mm512_maskz_and_epi64(0x0F, _mm512_xor_si512(_mm512_srli_epi64(v[i], 4), _mm512_permutexvar_epi64(p4, v[i])), m4);
+    v[i] = _mm512_ternarylogic_epi64(v[i], _mm512_slli_epi64(tmp, 4), _mm512_permutexvar_epi64(p4, tmp), 0x96);
+    tmp = _mm512_maskz_and_epi64(0x33, _mm512_xor_si512(_mm512_srli_epi64(v[i], 2), _mm512_permutexvar_epi64(p2, v[i])), m2);
+    v[i] = _mm512_ternarylogic_epi64(v[i], _mm512_slli_epi64(tmp, 2), _mm512_permutexvar_epi64(p2, tmp), 0x96);
+    tmp = _mm512_maskz_and_epi64(0x55, _mm512_xor_si512(_mm512_srli_epi64(v[i], 1), _mm512_permutexvar_epi64(p1, v[i])), m1);
+    v[i] = _mm512_ternarylogic_epi64(v[i], _mm512_slli_epi64(tmp, 1), _mm512_permutexvar_epi64(p1, tmp), 0x96);
+  }
+
+  for(int i = 0; i < 8; ++i)
+    _mm512_i64scatter_epi64((long long*)(dst + 8*i*rowstride_dst), dst_index, v[i], 8);
+}
+
+#endif // __M4RI_DISPATCH_X86
+
+m4ri_dispatch_t m4ri_dispatch = {
+  __M4RI_SIMD_CONFIGURED,
+  0,
+  _m4ri_combine_default,
+  NULL,
+  _mzd_copy_transpose_64x64_default,
+  _m4ri_popcount_default,
+};
+
+m4ri_simd_t m4ri_cpu_simd(void) {
+#if __M4RI_DISPATCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return m4ri_simd_avx512;
+  if (__builtin_cpu_supports("avx2"))
+    return m4ri_simd_avx2;
+  if (__builtin_cpu_supports("sse2"))
+    return m4ri_simd_sse2;
+  return m4ri_simd_none;
+#else
+  return __M4RI_SIMD_CONFIGURED;
+#endif
+}
+
+m4ri_simd_t m4ri_dispatch_select(m4ri_simd_t simd) {
+  m4ri_simd_t const cpu = m4ri_cpu_simd();
+  if (simd > cpu)
+    simd = cpu;
+
+  m4ri_dispatch.simd = simd;
+  m4ri_dispatch.popcnt = 0;
+  m4ri_dispatch.combine = _m4ri_combine_default;
+  m4ri_dispatch.combine_wide = NULL;
+  m4ri_dispatch.transpose_64x64 = _mzd_copy_transpose_64x64_default;
+  m4ri_dispatch.popcount = _m4ri_popcount_default;
+
+#if __M4RI_DISPATCH_X86
+  if (simd > m4ri_simd_none && __builtin_cpu_supports("popcnt")) {
+    m4ri_dispatch.popcnt = 1;
+    m4ri_dispatch.popcount = _m4ri_popcount_popcnt;
+  }
+
+  /* the inline kernels are at least as good as the generic ones for the configured level */
+  if (simd <= __M4RI_SIMD_CONFIGURED)
+    return simd;
+
+  switch(simd) {
+  case m4ri_simd_avx512:
+    m4ri_dispatch.combine = _m4ri_combine_avx512;
+    m4ri_dispatch.combine_wide = _m4ri_combine_avx512;
+    m4ri_dispatch.transpose_64x64 = _m4ri_transpose_64x64_avx512;
+    break;
+  case m4ri_simd_avx2:
+    m4ri_dispatch.combine = _m4ri_combine_avx2;
+    m4ri_dispatch.combine_wide = _m4ri_combine_avx2;
+    m4ri_dispatch.transpose_64x64 = _m4ri_transpose_64x64_avx2;
+    break;
+  default:
+    break;
+  }
+#endif // __M4RI_DISPATCH_X86
+  return simd;
+}
+
+void m4ri_dispatch_init(void) {
+  m4ri_simd_t const cpu = m4ri_cpu_simd();
+  if (cpu < __M4RI_SIMD_CONFIGURED)
+    m4ri_die("M4RI was configured for %s but this CPU only supports %s.\n",
+             m4ri_simd_name(__M4RI_SIMD_CONFIGURED), m4ri_simd_name(cpu));
+  m4ri_dispatch_select(cpu);
+}
+
+char const *m4ri_simd_name(m4ri_simd_t simd) {
+  switch(simd) {
+  case m4ri_simd_none:   return "none";
+  case m4ri_simd_sse2:   return "SSE2";
+  case m4ri_simd_avx2:   return "AVX2";
+  case m4ri_simd_avx512: return "AVX-512";
+  }
+  return "unknown";
+}
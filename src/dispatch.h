@@ -0,0 +1,157 @@
+/**
+ * \file dispatch.h
+ * \brief Runtime selection of SIMD kernels based on the CPU we are running on.
+ *
+ * The configured instruction set (see m4ri_config.h) fixes what the
+ * inline kernels in xor.h may use. This module additionally detects
+ * AVX2 and AVX-512 at runtime and routes the hottest loops through a
+ * table of function pointers, such that a library built for a
+ * baseline x86-64 CPU still runs at full speed on newer hardware.
+ *
+ * The table is filled by m4ri_init().
+ */
+
+#ifndef M4RI_DISPATCH_H
+#define M4RI_DISPATCH_H
+
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+#include <m4ri/m4ri_config.h>
+#include <m4ri/misc.h>
+
+/**
+ * \brief SIMD instruction set levels, ordered by capability.
+ */
+
+typedef enum {
+  m4ri_simd_none   = 0, /*!< portable C code */
+  m4ri_simd_sse2   = 1, /*!< SSE2 */
+  m4ri_simd_avx2   = 2, /*!< AVX2 */
+  m4ri_simd_avx512 = 3, /*!< AVX-512F */
+} m4ri_simd_t;
+
+/**
+ * \brief Kernel computing m[i] += sum(t[j][i], 0 <= j < n) for 0 <= i < wide.
+ */
+
+typedef void (*m4ri_combine_fn)(word *m, word const *t[], int n, wi_t wide);
+
+/**
+ * \brief Table of kernels selected at runtime.
+ */
+
+typedef struct {
+  /**
+   * Instruction set the kernels below were selected for.
+   */
+  m4ri_simd_t simd;
+
+  /**
+   * Non-zero if the CPU supports the POPCNT instruction.
+   */
+  int popcnt;
+
+  /**
+   * Compute m[i] += sum(t[j][i], 0 <= j < n) for 0 <= i < wide and 1 <= n <= 8.
+   *
+   * In contrast to the inline kernels in xor.h no alignment is
+   * assumed.
+   */
+  m4ri_combine_fn combine;
+
+  /**
+   * combine if it is wider than the inline kernels in xor.h, NULL
+   * otherwise. Hot loops read this once per call and use the inline
+   * kernels directly if it is NULL.
+   */
+  m4ri_combine_fn combine_wide;
+
+  /**
+   * Transpose a 64 x 64 matrix with width 1, see _mzd_copy_transpose_64x64 in mzd.c.
+   */
+  void (*transpose_64x64)(word *RESTRICT dst, word const *RESTRICT src, wi_t rowstride_dst, wi_t rowstride_src);
+
+  /**
+   * Return the number of bits set in v[0], ..., v[wide-1].
+   */
+  uint64_t (*popcount)(word const *v, wi_t wide);
+
+} m4ri_dispatch_t;
+
+/**
+ * \brief The kernels in use.
+ *
+ * Until m4ri_init() is called this holds the kernels matching the
+ * configured instruction set.
+ */
+
+extern m4ri_dispatch_t m4ri_dispatch;
+
+/**
+ * \brief Return the best SIMD instruction set supported by the CPU and this build.
+ */
+
+m4ri_simd_t m4ri_cpu_simd(void);
+
+/**
+ * \brief Fill m4ri_dispatch with the best kernels for the running CPU.
+ *
+ * This is called by m4ri_init().
+ */
+
+void m4ri_dispatch_init(void);
+
+/**
+ * \brief Select the kernels for a given instruction set.
+ *
+ * Levels above what m4ri_cpu_simd() reports are clamped. Selecting a
+ * level below the configured one only affects the dispatched kernels,
+ * the inline kernels in xor.h are fixed at compile time.
+ *
+ * \param simd Requested instruction set.
+ *
+ * \return the instruction set actually selected.
+ */
+
+m4ri_simd_t m4ri_dispatch_select(m4ri_simd_t simd);
+
+/**
+ * \brief Return a human readable name for an instruction set level.
+ *
+ * \param simd Instruction set.
+ */
+
+char const *m4ri_simd_name(m4ri_simd_t simd);
+
+/**
+ * \brief Compute m[i] += sum(t[j][i], 0 <= j < n) for 0 <= i < wide using the dispatched kernel.
+ *
+ * \param m Destination row.
+ * \param t Source rows.
+ * \param n Number of source rows, 1 <= n <= 8.
+ * \param wide Number of words.
+ */
+
+static inline void m4ri_combine(word *m, word const *t[], int n, wi_t wide) {
+  m4ri_dispatch.combine(m, t, n, wide);
+}
+
+#endif // M4RI_DISPATCH_H
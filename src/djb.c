@@ -21,10 +21,12 @@
 #include <stdlib.h>
 
 static inline int mzd_compare_rows_revlex(const mzd_t *A, rci_t a, rci_t b) {
+  word const *ra = mzd_row(A, a);
+  word const *rb = mzd_row(A, b);
   for(wi_t j=A->width-1; j>=0; j--)  {
-    if (A->rows[a][j] < A->rows[b][j])
+    if (ra[j] < rb[j])
       return 0;
-    if (A->rows[a][j] > A->rows[b][j])
+    if (ra[j] > rb[j])
       return 1;
   }
   return 1;
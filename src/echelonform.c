@@ -26,9 +26,10 @@
 #include "brilliantrussian.h"
 #include "ple.h"
 #include "triangular.h"
+#include "profile.h"
 
 rci_t mzd_echelonize(mzd_t *A, int full) {
-  return _mzd_echelonize_m4ri(A, full, 0, 1, __M4RI_ECHELONFORM_CROSSOVER_DENSITY);
+  return _mzd_echelonize_m4ri(A, full, 0, 1, m4ri_profile.echelonform_crossover_density);
 }
 
 rci_t mzd_echelonize_m4ri(mzd_t *A, int full, int k) {
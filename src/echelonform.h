@@ -73,7 +73,7 @@ rci_t mzd_echelonize_pluq(mzd_t *A, int full);
  * 
  * \param A Matrix to be reduced.
  * \param full Return the reduced row echelon form, not only upper triangular form.
- * \param k M4RI parameter, may be 0 for auto-choose.
+ * \param k M4RI parameter, at most m4ri_radix / 6, may be 0 for auto-choose.
  *
  * \wordoffset
  *
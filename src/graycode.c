@@ -80,7 +80,67 @@ void m4ri_destroy_all_codes() {
 
 
 int m4ri_opt_k(int a, int b, int c) {
-  int n = MIN(a, b);
-  int res = MIN(__M4RI_MAXKAY, MAX(1, (int)(0.75 * (1 + log2_floor(n)))) );
-  return res;
+  /* see _mzd_mul_m4rm() and _mzd_echelonize_m4ri() */
+  if (c)
+    return m4ri_opt_k_tables(a, b, (c + m4ri_radix - 1) / m4ri_radix, 8, m4ri_radix / 8);
+  return m4ri_opt_k_tables(a, b, (b + 2 * m4ri_radix - 1) / (2 * m4ri_radix), 6, m4ri_radix / 6);
+}
+
+/*
+ * Relative cost of adding a row of tables of the given total size,
+ * where the fraction of the tables exceeding a cache misses it.
+ */
+
+static double _m4ri_table_cost(double footprint) {
+  double const l1 = MAX(0.0, 1.0 - __M4RI_CPU_L1_CACHE / footprint);
+  double const l2 = MAX(0.0, 1.0 - __M4RI_TABLE_CACHE_SHARE * __M4RI_CPU_L2_CACHE / footprint);
+  double const l3 = MAX(0.0, 1.0 - __M4RI_TABLE_CACHE_SHARE * __M4RI_CPU_L3_CACHE / footprint);
+  /* l1 >= l2 >= l3, each level adds its cost over the one above */
+  return 1.0
+    + (__M4RI_TABLE_COST_L2 - 1.0) * l1
+    + (__M4RI_TABLE_COST_L3 - __M4RI_TABLE_COST_L2) * l2
+    + (__M4RI_TABLE_COST_MEM - __M4RI_TABLE_COST_L3) * l3;
+}
+
+/*
+ * The k of least cost per column for tables of the given width.
+ */
+
+static int _m4ri_opt_k_width(rci_t m, rci_t n, wi_t width, int ntables, int kmax) {
+  int best = 1;
+  double best_cost = 0;
+  for(int k = 1; k <= kmax; ++k) {
+    /* narrow inputs need fewer tables per pass */
+    int const t = MIN(ntables, (n + k - 1) / k);
+    rci_t const cols = MIN(n, t * k);
+    double const footprint = (double)t * __M4RI_TWOPOW(k) * width * sizeof(word);
+    /* per row: one addition from each table plus reading and writing the row itself */
+    double const cost = ((double)t * __M4RI_TWOPOW(k) + (double)m * (t * _m4ri_table_cost(footprint) + 1.0)) / cols;
+    if (k == 1 || cost < best_cost) {
+      best = k;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
+
+int m4ri_opt_k_tables(rci_t m, rci_t n, wi_t width, int ntables, int kmax) {
+  kmax = MIN(kmax, __M4RI_MAXKAY);
+  m = MAX(m, 1);
+  n = MAX(n, 1);
+  width = MAX(width, 1);
+
+  /*
+   * Once the tables spill a cache for every k, the cost model prefers
+   * the k that is best for the next level, which may be larger than
+   * the k chosen for narrower tables that fit. Wider tables never fit
+   * better, so we cap k by the choice for half the width.
+   */
+  int k = kmax;
+  for(;;) {
+    k = MIN(k, _m4ri_opt_k_width(m, n, width, ntables, kmax));
+    if (width == 1)
+      return k;
+    width = (width + 1) / 2;
+  }
 }
@@ -31,13 +31,50 @@
 *
 *                  http://www.gnu.org/licenses/
 ******************************************************************************/
- 
+
+#include <m4ri/misc.h>
+
 /**
  * Maximum allowed value for k.
  */
 
 #define __M4RI_MAXKAY 16
 
+/**
+ * \brief Cost of adding a table row from L2, L3 and memory relative to L1.
+ *
+ * Used by m4ri_opt_k_tables(). The additions stream whole rows with
+ * hardware prefetching, so their cost follows the bandwidth a core
+ * gets from each level rather than its latency. The defaults of 1.1, 2
+ * and 4 are rough ratios of the L1 bandwidth of a single x86 core to
+ * that from L2, L3 and memory.
+ */
+
+#ifndef __M4RI_TABLE_COST_L2
+#define __M4RI_TABLE_COST_L2 1.1
+#endif
+
+#ifndef __M4RI_TABLE_COST_L3
+#define __M4RI_TABLE_COST_L3 2.0
+#endif
+
+#ifndef __M4RI_TABLE_COST_MEM
+#define __M4RI_TABLE_COST_MEM 4.0
+#endif
+
+/**
+ * \brief Share of __M4RI_CPU_L2_CACHE and __M4RI_CPU_L3_CACHE left to the tables.
+ *
+ * The rows being updated pass through the same caches as the tables,
+ * so m4ri_opt_k_tables() only counts on this share of L2 and L3 for
+ * the tables. L1 is counted in full, since the rows only stream
+ * through it.
+ */
+
+#ifndef __M4RI_TABLE_CACHE_SHARE
+#define __M4RI_TABLE_CACHE_SHARE 0.5
+#endif
+
 /**
  * \brief Gray codes.
  *
@@ -151,10 +188,11 @@ static inline int log2_floor(int v) {
 /**
  * \brief Return the optimal var k for the given parameters.
  *
- * If var c != 0 then var k for multiplication is returned, else
- * var k for inversion. The optimal var k here means \f$0.75 log_2(n)\f$
- * where \f$n\f$ is \f$min(a,b)\f$ for inversion and
- * \f$b\f$ for multiplication.
+ * If var c != 0 then var k for multiplication of an a x b by a b x c
+ * matrix is returned, else var k for elimination of an a x b
+ * matrix. Both are chosen by m4ri_opt_k_tables() for the number of
+ * tables used by _mzd_mul_m4rm() and _mzd_echelonize_m4ri()
+ * respectively.
  *
  * \param a Number of rows of (first) matrix
  * \param b Number of columns of (first) matrix
@@ -165,4 +203,30 @@ static inline int log2_floor(int v) {
 
 int m4ri_opt_k(int a,int b,int c);
 
+/**
+ * \brief Return k for ntables Gray code tables applied to m rows.
+ *
+ * A pass of the Method of the Four Russians builds up to ntables
+ * tables of 2^k rows of width words each, covering up to ntables * k
+ * of the n columns, and then adds one row of each table to each of the
+ * m rows. Building the tables costs 2^k row operations per table, which
+ * is amortised over the m rows, while the additions become more
+ * expensive the more of the tables exceed __M4RI_CPU_L1_CACHE and the
+ * share __M4RI_TABLE_CACHE_SHARE of __M4RI_CPU_L2_CACHE and
+ * __M4RI_CPU_L3_CACHE, weighted by __M4RI_TABLE_COST_L2,
+ * __M4RI_TABLE_COST_L3 and __M4RI_TABLE_COST_MEM. The result minimises
+ * the cost per column, but is never larger than for tables of half the
+ * width, so that wider tables never get a larger k.
+ *
+ * \param m Number of rows the tables of a pass are applied to.
+ * \param n Number of columns to process.
+ * \param width Number of words of a row of a table.
+ * \param ntables Maximal number of tables of a pass.
+ * \param kmax Maximal k supported by the caller.
+ *
+ * \return k with 1 <= k <= kmax
+ */
+
+int m4ri_opt_k_tables(rci_t m, rci_t n, wi_t width, int ntables, int kmax);
+
 #endif // M4RI_GRAYFLEX_H
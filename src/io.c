@@ -49,7 +49,7 @@ void mzd_print(mzd_t const *M) {
   char temp[SAFECHAR];
   for (rci_t i = 0; i < M->nrows; ++i) {
     printf("[");
-    word *row = M->rows[i];
+    word *row = mzd_row(M, i);
     for (wi_t j = 0; j < M->width - 1; ++j) {
       m4ri_word_to_str(temp, row[j], 1);
       printf("%s|", temp);
@@ -71,7 +71,7 @@ void mzd_print(mzd_t const *M) {
 void mzd_print_row(mzd_t const *M, const rci_t i) {
   char temp[SAFECHAR];
   printf("[");
-  word *row = M->rows[i];
+  word *row = mzd_row(M, i);
   for (wi_t j = 0; j < M->width - 1; ++j) {
     m4ri_word_to_str(temp, row[j], 1);
     printf("%s|", temp);
@@ -93,6 +93,31 @@ void mzd_print_row(mzd_t const *M, const rci_t i) {
 #if __M4RI_HAVE_LIBPNG
 #define PNGSIGSIZE 8
 
+/*
+ * With png_set_packswap() a 1-bit PNG row stores the leftmost pixel in
+ * the least significant bit of each byte, which is exactly the memory
+ * layout of a row of words on little-endian machines. There rows are
+ * handed to libpng as they are; elsewhere bytes are reordered per word.
+ */
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define __M4RI_PNG_NATIVE_ROWS 1
+#else
+#define __M4RI_PNG_NATIVE_ROWS 0
+
+static inline void mzd_png_bytes_to_words(word *dst, png_byte const *src, wi_t wide) {
+  for(wi_t j = 0; j < wide; j++, src += 8)
+    dst[j] = ((word)src[7])<<56 | ((word)src[6])<<48 | ((word)src[5])<<40 | ((word)src[4])<<32 \
+      |      ((word)src[3])<<24 | ((word)src[2])<<16 | ((word)src[1])<< 8 | ((word)src[0])<< 0;
+}
+
+static inline void mzd_png_words_to_bytes(png_bytep dst, word const *src, wi_t wide) {
+  for(wi_t j = 0; j < wide; j++, dst += 8)
+    for(int b = 0; b < 8; b++)
+      dst[b] = (png_byte)((src[j] >> (8*b)) & 0xff);
+}
+#endif
+
 mzd_t * mzd_from_png(const char *fn, int verbose) {
   int retval = 0;
   mzd_t *A = NULL;
@@ -167,40 +192,38 @@ mzd_t * mzd_from_png(const char *fn, int verbose) {
     goto from_png_destroy_read_struct;
   }
     
-  A = mzd_init(m, n);
-  const word bitmask_end = A->high_bitmask;
-  png_bytep row = m4ri_mm_calloc(sizeof(char),n/8+1);
+  if(bit_depth != 1 || channels != 1) {
+    if (verbose)
+      printf("only 1-bit images are supported.\n");
+    goto from_png_destroy_read_struct;
+  }
 
-  word tmp;
-  wi_t j;
+  A = mzd_init_uninitialized(m, n);
+  const word bitmask_end = A->high_bitmask;
+#if __M4RI_PNG_NATIVE_ROWS
+  png_bytep row = NULL;
+#else
+  png_bytep row = m4ri_mm_calloc(sizeof(word), A->width);
+#endif
 
   png_set_packswap(png_ptr);
   //png_set_invert_mono(png_ptr);
 
   for(rci_t i=0; i<m; i++) {
+    word *dst = mzd_row(A, i);
+#if __M4RI_PNG_NATIVE_ROWS
+    png_read_row(png_ptr, (png_bytep)dst, NULL);
+#else
     png_read_row(png_ptr, row, NULL);
-    for(j=0; j<A->width-1; j++) {
-      tmp = ((word)row[8*j+7])<<56 | ((word)row[8*j+6])<<48 \
-        |   ((word)row[8*j+5])<<40 | ((word)row[8*j+4])<<32 \
-        |   ((word)row[8*j+3])<<24 | ((word)row[8*j+2])<<16 \
-        |   ((word)row[8*j+1])<< 8 | ((word)row[8*j+0])<< 0;
-      A->rows[i][j] = ~tmp;
-    }
-    tmp = 0;
-    switch((n/8 + ((n%8) ? 1 : 0))%8) {
-    case 0: tmp |= ((word)row[8*j+7])<<56;
-    case 7: tmp |= ((word)row[8*j+6])<<48;
-    case 6: tmp |= ((word)row[8*j+5])<<40;
-    case 5: tmp |= ((word)row[8*j+4])<<32;
-    case 4: tmp |= ((word)row[8*j+3])<<24;
-    case 3: tmp |= ((word)row[8*j+2])<<16;
-    case 2: tmp |= ((word)row[8*j+1])<< 8;
-    case 1: tmp |= ((word)row[8*j+0])<< 0;
-    };
-    A->rows[i][j] |= (~tmp & bitmask_end);
+    mzd_png_bytes_to_words(dst, row, A->width);
+#endif
+    for(wi_t j=0; j<A->width; j++)
+      dst[j] = ~dst[j];
+    dst[A->width - 1] &= bitmask_end;
   }
 
-  m4ri_mm_free(row);
+  if (row)
+    m4ri_mm_free(row);
   png_read_end(png_ptr, NULL);
 
  from_png_destroy_read_struct: 
@@ -287,37 +310,30 @@ int mzd_to_png(const mzd_t *A, const char *fn, int compression_level, const char
   png_set_packswap(png_ptr);
   png_set_invert_mono(png_ptr);
   
-  png_bytep row = m4ri_mm_calloc(sizeof(char),A->ncols/8+8);
+  /* a copy is only needed to mask the excess bits of windows or to reorder bytes */
+  word *buf = m4ri_mm_calloc(sizeof(word), A->width + 1);
+#if !__M4RI_PNG_NATIVE_ROWS
+  png_bytep row = m4ri_mm_calloc(sizeof(word), A->width + 1);
+#endif
 
-  wi_t j=0;
-  word tmp = 0;
   for(rci_t i=0; i<A->nrows; i++) {
-    word *rowptr = A->rows[i];
-    for(j=0; j<A->width-1; j++) {
-      tmp = rowptr[j];
-      row[8*j+0] = (png_byte)((tmp>> 0) & 0xff);
-      row[8*j+1] = (png_byte)((tmp>> 8) & 0xff);
-      row[8*j+2] = (png_byte)((tmp>>16) & 0xff);
-      row[8*j+3] = (png_byte)((tmp>>24) & 0xff);
-      row[8*j+4] = (png_byte)((tmp>>32) & 0xff);
-      row[8*j+5] = (png_byte)((tmp>>40) & 0xff);
-      row[8*j+6] = (png_byte)((tmp>>48) & 0xff);
-      row[8*j+7] = (png_byte)((tmp>>56) & 0xff);
+    word const *src = mzd_row(A, i);
+    if (mzd_is_windowed(A)) {
+      memcpy(buf, src, A->width * sizeof(word));
+      buf[A->width - 1] &= A->high_bitmask;
+      src = buf;
     }
-    tmp = rowptr[j];
-    switch( (A->ncols/8 + ((A->ncols%8) ? 1 : 0)) %8 ) {
-    case 0: row[8*j+7] = (png_byte)((tmp>>56) & 0xff);
-    case 7: row[8*j+6] = (png_byte)((tmp>>48) & 0xff);
-    case 6: row[8*j+5] = (png_byte)((tmp>>40) & 0xff); 
-    case 5: row[8*j+4] = (png_byte)((tmp>>32) & 0xff); 
-    case 4: row[8*j+3] = (png_byte)((tmp>>24) & 0xff);
-    case 3: row[8*j+2] = (png_byte)((tmp>>16) & 0xff);
-    case 2: row[8*j+1] = (png_byte)((tmp>> 8) & 0xff);
-    case 1: row[8*j+0] = (png_byte)((tmp>> 0) & 0xff);
-    };
+#if __M4RI_PNG_NATIVE_ROWS
+    png_write_row(png_ptr, (png_bytep)src);
+#else
+    mzd_png_words_to_bytes(row, src, A->width);
     png_write_row(png_ptr, row);
+#endif
   }
+  m4ri_mm_free(buf);
+#if !__M4RI_PNG_NATIVE_ROWS
   m4ri_mm_free(row);
+#endif
 
   png_write_end(png_ptr, info_ptr);
   png_destroy_write_struct(&png_ptr, &info_ptr);
@@ -395,3 +411,141 @@ mzd_t *mzd_from_str(rci_t m, rci_t n, const char *str) {
   }
   return A;
 }
+
+/* FNV-1a over the valid words of each row, the excess bits are masked out. */
+
+#define __M4RI_BIN_CHECKSUM_BASIS 0xcbf29ce484222325ULL
+#define __M4RI_BIN_CHECKSUM_PRIME 0x100000001b3ULL
+
+static inline word mzd_bin_checksum(word h, word const *row, wi_t width, word mask_end) {
+  for(wi_t j = 0; j < width - 1; ++j)
+    h = (h ^ row[j]) * __M4RI_BIN_CHECKSUM_PRIME;
+  return (h ^ (row[width - 1] & mask_end)) * __M4RI_BIN_CHECKSUM_PRIME;
+}
+
+int mzd_write_bin(mzd_t const *A, const char *fn, int checksum, int verbose) {
+  FILE *fh = fopen(fn, "wb");
+
+  if (!fh) {
+    if(verbose)
+      printf("Could not open file '%s' for writing\n",fn);
+    return 1;
+  }
+
+  mzd_file_header_t header;
+  mzd_file_header_init(&header, A->nrows, A->ncols);
+  if (checksum)
+    header.flags |= mzd_file_flag_checksum;
+
+  int retval = 0;
+  word h = __M4RI_BIN_CHECKSUM_BASIS;
+  word const mask_end = A->high_bitmask;
+  wi_t const rowstride = (wi_t)header.rowstride;
+
+  if (fwrite(&header, sizeof(header), 1, fh) != 1) {
+    retval = 1;
+    goto to_bin_close_fh;
+  }
+
+  if (A->nrows == 0 || A->ncols == 0)
+    goto to_bin_close_fh;
+
+  if (!mzd_is_windowed(A)) {
+    /* the blocks hold the rows in the file layout already */
+    if (checksum)
+      for(rci_t i = 0; i < A->nrows; ++i)
+        h = mzd_bin_checksum(h, mzd_row(A, i), A->width, mask_end);
+    for(int n = 0; A->blocks[n].size; ++n) {
+      if (fwrite(A->blocks[n].begin, 1, A->blocks[n].size, fh) != A->blocks[n].size) {
+        retval = 1;
+        goto to_bin_close_fh;
+      }
+    }
+  } else {
+    /* windows share the rowstride of their parent, copy them row by row */
+    rci_t const bufrows = MAX(1, (1 << 20) / (rowstride * (int)sizeof(word)));
+    word *buf = (word*)m4ri_mm_calloc(bufrows * rowstride, sizeof(word));
+    for(rci_t i = 0; i < A->nrows && !retval; i += bufrows) {
+      rci_t const n = MIN(bufrows, A->nrows - i);
+      for(rci_t k = 0; k < n; ++k) {
+        word *dst = buf + k * rowstride;
+        memcpy(dst, mzd_row(A, i + k), A->width * sizeof(word));
+        dst[A->width - 1] &= mask_end;
+        if (checksum)
+          h = mzd_bin_checksum(h, dst, A->width, mask_end);
+      }
+      if (fwrite(buf, rowstride * sizeof(word), n, fh) != (size_t)n)
+        retval = 1;
+    }
+    m4ri_mm_free(buf);
+    if (retval)
+      goto to_bin_close_fh;
+  }
+
+  if (checksum) {
+    header.checksum = h;
+    if (fseek(fh, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, fh) != 1)
+      retval = 1;
+  }
+
+ to_bin_close_fh:
+  if (fclose(fh))
+    retval = 1;
+  if (retval && verbose)
+    printf("Could not write file '%s'\n",fn);
+  return retval;
+}
+
+mzd_t *mzd_read_bin(const char *fn, int verbose) {
+  mzd_t *A = NULL;
+  FILE *fh = fopen(fn,"rb");
+
+  if (!fh) {
+    if (verbose)
+      printf("Could not open file '%s' for reading\n",fn);
+    return NULL;
+  }
+
+  mzd_file_header_t header;
+  if (fread(&header, sizeof(header), 1, fh) != 1 || mzd_file_header_check(&header)) {
+    if (verbose)
+      printf("'%s' is not a matrix file.\n",fn);
+    goto from_bin_close_fh;
+  }
+
+  A = mzd_init_uninitialized((rci_t)header.nrows, (rci_t)header.ncols);
+  if (A->nrows == 0 || A->ncols == 0)
+    goto from_bin_close_fh;
+
+  for(int n = 0; A->blocks[n].size; ++n) {
+    if (fread(A->blocks[n].begin, 1, A->blocks[n].size, fh) != A->blocks[n].size) {
+      if (verbose)
+        printf("Could not read file '%s'\n",fn);
+      mzd_free(A);
+      A = NULL;
+      goto from_bin_close_fh;
+    }
+  }
+
+  word const mask_end = A->high_bitmask;
+  word h = __M4RI_BIN_CHECKSUM_BASIS;
+  for(rci_t i = 0; i < A->nrows; ++i) {
+    word *row = mzd_row(A, i);
+    row[A->width - 1] &= mask_end;
+    if (A->rowstride > A->width)
+      row[A->width] = 0;
+    if (header.flags & mzd_file_flag_checksum)
+      h = mzd_bin_checksum(h, row, A->width, mask_end);
+  }
+
+  if ((header.flags & mzd_file_flag_checksum) && h != header.checksum) {
+    if (verbose)
+      printf("checksum mismatch in '%s'\n",fn);
+    mzd_free(A);
+    A = NULL;
+  }
+
+ from_bin_close_fh:
+  fclose(fh);
+  return A;
+}
@@ -139,4 +139,37 @@ mzd_t *mzd_from_jcf(const char *fn, int verbose);
 
 mzd_t *mzd_from_str(rci_t m, rci_t n, const char *str);
 
+/**
+ * \brief Write matrix to file in the native binary format.
+ *
+ * The file holds a mzd_file_header_t followed by the rows as they are
+ * laid out in memory (see mzd.h), so no conversion takes place. Such
+ * files are read back by mzd_read_bin() or mapped in place by
+ * mzd_init_mmap().
+ *
+ * \param A Matrix
+ * \param fn Filename
+ * \param checksum Store a checksum of the entries in the header if != 0
+ * \param verbose Print error message to stdout if != 0
+ *
+ * \return 0 on success, 1 if the file could not be written.
+ */
+
+int mzd_write_bin(mzd_t const *A, const char *fn, int checksum, int verbose);
+
+/**
+ * \brief Read matrix from file in the native binary format.
+ *
+ * Rows are read directly into the blocks of the new matrix. If the
+ * header carries a checksum it is verified. Use mzd_init_mmap() with
+ * mzd_mmap_private to map the file in place instead.
+ *
+ * \param fn Filename
+ * \param verbose Print error message to stdout if != 0
+ *
+ * \return the matrix or NULL on error.
+ */
+
+mzd_t *mzd_read_bin(const char *fn, int verbose);
+
 #endif //M4RI_IO_H
@@ -49,6 +49,18 @@
 #   endif
 #endif
 
+#if defined(__M4RI_HAVE_AVX2) && __M4RI_HAVE_AVX2
+#   if !defined(__AVX2__) || !__AVX2__
+#       error "Your current compiler and / or CFLAGS setting doesn't allow AVX2 code. Please change that or these to the setting(s) you used when compiling M4RI."
+#   endif
+#endif
+
+#if defined(__M4RI_HAVE_AVX512F) && __M4RI_HAVE_AVX512F
+#   if !defined(__AVX512F__) || !__AVX512F__
+#       error "Your current compiler and / or CFLAGS setting doesn't allow AVX-512 code. Please change that or these to the setting(s) you used when compiling M4RI."
+#   endif
+#endif
+
 #if defined(__cplusplus) && !defined (_MSC_VER)
 extern "C" {
 #endif
@@ -66,7 +78,11 @@ extern "C" {
 #include <m4ri/solve.h>
 #include <m4ri/echelonform.h>
 #include <m4ri/io.h>
+#include <m4ri/dispatch.h>
 #include <m4ri/djb.h>
+#include <m4ri/tiled.h>
+#include <m4ri/workspace.h>
+#include <m4ri/profile.h>
 
 #if defined(__cplusplus) && !defined (_MSC_VER)
 }
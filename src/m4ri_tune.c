@@ -0,0 +1,238 @@
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+/*
+ * m4ri_tune measures the crossovers of m4ri_profile_t on the running
+ * host and writes them to a profile, which m4ri_init() loads.
+ *
+ * usage: m4ri_tune [-n size] [-r repetitions] [-o profile]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "m4ri.h"
+
+enum { mul_m4rm, mul_strassen, ple, echelonize_m4ri, echelonize_pluq };
+
+static double walltime(void) {
+  struct timeval tp;
+  gettimeofday(&tp, NULL);
+  return tp.tv_sec + 1e-6 * tp.tv_usec;
+}
+
+static mzd_t *random_matrix(rci_t n, double density) {
+  mzd_t *A = mzd_init(n, n);
+  if (density >= 0.5) {
+    mzd_randomize(A);
+    return A;
+  }
+  long const threshold = (long)(density * RAND_MAX);
+  for (rci_t i = 0; i < n; ++i)
+    for (rci_t j = 0; j < n; ++j)
+      if (random() < threshold)
+        mzd_write_bit(A, i, j, 1);
+  return A;
+}
+
+/* Return the best time of reps runs of op on A (and A as B). */
+
+static double measure(int op, mzd_t const *A, int reps) {
+  double best = 0;
+  for (int r = 0; r < reps; ++r) {
+    mzd_t *B = mzd_copy(NULL, A);
+    mzd_t *C = mzd_init(A->nrows, A->ncols);
+    mzp_t *P = mzp_init(A->nrows);
+    mzp_t *Q = mzp_init(A->ncols);
+
+    double t = walltime();
+    switch (op) {
+    case mul_m4rm:        _mzd_mul_m4rm(C, A, B, 0, TRUE); break;
+    case mul_strassen:    mzd_mul(C, A, B, 0); break;
+    case ple:             mzd_ple(B, P, Q, 0); break;
+    case echelonize_m4ri: _mzd_echelonize_m4ri(B, 1, 0, 0, 0.0); break;
+    case echelonize_pluq: mzd_echelonize_pluq(B, 1); break;
+    }
+    t = walltime() - t;
+    if (r == 0 || t < best)
+      best = t;
+
+    mzp_free(Q);
+    mzp_free(P);
+    mzd_free(C);
+    mzd_free(B);
+  }
+  return best;
+}
+
+/*
+ * Set *param to each of the count values in turn and keep the
+ * fastest, where the other values must beat values[0] by the given
+ * margin.
+ */
+
+static int tune_int(char const *name, int *param, int const *values, int count, double margin, int op, mzd_t const *A, int reps) {
+  int best = *param;
+  double tbest = 0, t0 = 0;
+  for (int i = 0; i < count; ++i) {
+    *param = values[i];
+    double const t = measure(op, A, reps);
+    printf("  %-30s %8d: %8.4fs\n", name, values[i], t);
+    if (i == 0)
+      t0 = t;
+    if (i == 0 || (t < tbest && t < (1.0 - margin) * t0)) {
+      best = values[i];
+      tbest = t;
+    }
+  }
+  *param = best;
+  return best;
+}
+
+/* As tune_int() for parameters of type uint64_t. */
+
+static uint64_t tune_uint64(char const *name, uint64_t *param, uint64_t const *values, int count, double margin, int op, mzd_t const *A, int reps) {
+  uint64_t best = *param;
+  double tbest = 0, t0 = 0;
+  for (int i = 0; i < count; ++i) {
+    *param = values[i];
+    double const t = measure(op, A, reps);
+    printf("  %-30s %8llu: %8.4fs\n", name, (unsigned long long)values[i], t);
+    if (i == 0)
+      t0 = t;
+    if (i == 0 || (t < tbest && t < (1.0 - margin) * t0)) {
+      best = values[i];
+      tbest = t;
+    }
+  }
+  *param = best;
+  return best;
+}
+
+static void usage(char const *prog) {
+  printf("usage: %s [-n size] [-r repetitions] [-o profile]\n", prog);
+  printf("\n");
+  printf("Measure the crossovers of the M4RI library on this host and write them\n");
+  printf("to the profile loaded by m4ri_init(), by default $%s or ~/%s.\n", __M4RI_PROFILE_ENV, __M4RI_PROFILE_FILE);
+}
+
+int main(int argc, char **argv) {
+  rci_t n = 2048;
+  int reps = 3;
+  char buf[4096];
+  char const *path = NULL;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      n = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      reps = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      path = argv[++i];
+    } else {
+      usage(argv[0]);
+      return (strcmp(argv[i], "-h") == 0) ? 0 : 1;
+    }
+  }
+  if (n < 256 || reps < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (path == NULL)
+    path = m4ri_profile_path(buf, sizeof(buf));
+  if (path == NULL || path[0] == '\0') {
+    fprintf(stderr, "%s: no profile file name, use -o.\n", argv[0]);
+    return 1;
+  }
+
+  srandom(17);
+  /* we tune from the configured defaults, not from a previous profile */
+  m4ri_profile_defaults(&m4ri_profile);
+  m4ri_profile_t *p = &m4ri_profile;
+
+  printf("M4RM, %d x %d:\n", n, n);
+  {
+    mzd_t *A = random_matrix(n, 0.5);
+    int const blocksizes[] = { 256, 512, 1024, 2048, 4096 };
+    tune_int("mul_blocksize", &p->mul_blocksize, blocksizes, 5, 0.0, mul_m4rm, A, reps);
+    /* a fixed k applies to all shapes, so it must clearly beat the model */
+    int const ks[] = { 0, 2, 3, 4, 5, 6, 7, 8 };
+    tune_int("m4rm_k", &p->m4rm_k, ks, 8, 0.05, mul_m4rm, A, reps);
+    mzd_free(A);
+  }
+
+  printf("Strassen-Winograd, %d x %d:\n", 2 * n, 2 * n);
+  {
+    mzd_t *A = random_matrix(2 * n, 0.5);
+    int const cutoffs[] = { 256, 512, 1024, 2048, 4096 };
+    int count = 0;
+    while (count < 5 && cutoffs[count] <= n)
+      ++count;
+    tune_int("strassen_mul_cutoff", &p->strassen_mul_cutoff, cutoffs, count, 0.0, mul_strassen, A, reps);
+    mzd_free(A);
+  }
+
+  printf("PLE, %d x %d:\n", 2 * n, 2 * n);
+  {
+    mzd_t *A = random_matrix(2 * n, 0.5);
+    uint64_t const cutoffs[] = { 1 << 14, 1 << 15, 1 << 16, 1 << 17, 1 << 18, 1 << 19, 1 << 20 };
+    tune_uint64("ple_cutoff", &p->ple_cutoff, cutoffs, 7, 0.0, ple, A, reps);
+    mzd_free(A);
+  }
+
+  printf("Echelon form, %d x %d:\n", n, n);
+  {
+    /* the crossover is the lowest density from which on PLE is faster */
+    double const densities[] = { 0.02, 0.05, 0.1, 0.15, 0.2, 0.3, 0.4, 0.5 };
+    int const count = sizeof(densities) / sizeof(densities[0]);
+    double crossover = 1.0;
+    for (int i = count - 1; i >= 0; --i) {
+      mzd_t *A = random_matrix(n, densities[i]);
+      double const tm = measure(echelonize_m4ri, A, reps);
+      double const tp = measure(echelonize_pluq, A, reps);
+      printf("  density %4.2f: M4RI %8.4fs, PLE %8.4fs\n", densities[i], tm, tp);
+      mzd_free(A);
+      if (tp > tm)
+        break;
+      crossover = densities[i];
+    }
+    p->echelonform_crossover_density = crossover;
+  }
+
+  printf("\n");
+  printf("strassen_mul_cutoff = %d\n", p->strassen_mul_cutoff);
+  printf("mul_blocksize = %d\n", p->mul_blocksize);
+  printf("m4rm_k = %d\n", p->m4rm_k);
+  printf("ple_cutoff = %llu\n", (unsigned long long)p->ple_cutoff);
+  printf("echelonform_crossover_density = %.3f\n", p->echelonform_crossover_density);
+
+  if (m4ri_profile_write(p, path)) {
+    fprintf(stderr, "%s: cannot write %s.\n", argv[0], path);
+    return 1;
+  }
+  printf("\nwrote %s\n", path);
+  return 0;
+}
@@ -22,6 +22,14 @@
 #include "config.h"
 #endif
 
+#if defined(HAVE_SCHED_SETAFFINITY)
+/* for cpu_set_t */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#endif
+
 #ifdef _MSC_VER
 #include <windows.h>
 #endif
@@ -32,6 +40,12 @@
 #include "graycode.h"
 #include "misc.h"
 #include "mmc.h"
+#include "dispatch.h"
+#include "profile.h"
+
+#if __M4RI_HAVE_OPENMP
+#include <omp.h>
+#endif
 
 void m4ri_die(const char *errormessage, ...) {
   va_list lst;
@@ -72,12 +86,121 @@ word m4ri_random_word() {
 #endif
 }
 
+/* process-wide, accessed atomically since jobs may read it while another sets it */
+static int m4ri_num_threads = 0;
+static __M4RI_THREAD_LOCAL int m4ri_thread_budget = 0;
+
+void m4ri_set_num_threads(int n) {
+  n = MAX(n, 0);
+#if __M4RI_HAVE_OPENMP
+#pragma omp atomic write
+#endif
+  m4ri_num_threads = n;
+}
+
+void m4ri_set_thread_budget(int n) {
+  m4ri_thread_budget = MAX(n, 0);
+}
+
+int m4ri_get_num_threads(void) {
+#if __M4RI_HAVE_OPENMP
+  if (m4ri_thread_budget)
+    return m4ri_thread_budget;
+  int n;
+#pragma omp atomic read
+  n = m4ri_num_threads;
+  if (n)
+    return n;
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+#if defined(HAVE_SCHED_SETAFFINITY)
+/* the CPUs the process was allowed to use before we pinned anything, e.g. by taskset or a cpuset */
+static cpu_set_t m4ri_affinity_orig;
+static int m4ri_affinity_saved = 0;
+#endif
+
+int m4ri_set_affinity(int const *cpus, int ncpus) {
+#if defined(HAVE_SCHED_SETAFFINITY)
+  for (int i = 0; i < ncpus; ++i)
+    if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE)
+      return -1;
+
+  int failed = 0;
+#if __M4RI_HAVE_OPENMP
+#pragma omp critical (m4ri_affinity)
+#endif
+  if (!m4ri_affinity_saved) {
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &m4ri_affinity_orig) == 0)
+      m4ri_affinity_saved = 1;
+    else
+      failed = 1;
+  }
+  if (failed)
+    return -1;
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel num_threads(m4ri_get_num_threads()) reduction(|:failed)
+#endif
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (ncpus > 0) {
+#if __M4RI_HAVE_OPENMP
+      int const i = omp_get_thread_num();
+#else
+      int const i = 0;
+#endif
+      CPU_SET(cpus[i % ncpus], &set);
+    } else {
+      set = m4ri_affinity_orig;
+    }
+    failed |= (sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0);
+  }
+  return failed ? -1 : 0;
+#else
+  (void)cpus;
+  (void)ncpus;
+  return -1;
+#endif
+}
+
+static int m4ri_omp_chunk_size = 0;
+static uint64_t m4ri_omp_min_words = __M4RI_OMP_MIN_WORDS;
+
+void m4ri_set_omp_chunk(int chunk) {
+  m4ri_omp_chunk_size = (chunk > 0) ? chunk : 0;
+}
+
+void m4ri_set_omp_threshold(uint64_t words) {
+  m4ri_omp_min_words = words ? words : __M4RI_OMP_MIN_WORDS;
+}
+
+int m4ri_omp_chunk(rci_t nrows, wi_t wide) {
+  if (m4ri_omp_chunk_size)
+    return m4ri_omp_chunk_size;
+  int const threads = m4ri_get_num_threads();
+  rci_t chunk = __M4RI_CPU_L1_CACHE / (sizeof(word) * MAX(wide, 1));
+  chunk = MIN(chunk, nrows / (4 * threads));
+  chunk = (chunk + 7) & ~7;
+  return MAX(chunk, 8);
+}
+
+int m4ri_omp_parallel(rci_t nrows, wi_t wide) {
+  return nrows > 1 && (uint64_t)nrows * wide >= m4ri_omp_min_words;
+}
+
 #ifdef __GNUC__
 void __attribute__ ((constructor)) m4ri_init()
 #else
 void m4ri_init()
 #endif
 {
+  m4ri_dispatch_init();
+  m4ri_profile_init();
   m4ri_build_all_codes();
 }
 #ifdef __GNUC__
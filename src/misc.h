@@ -533,6 +533,13 @@ word m4ri_random_word();
  *
  * On Linux/Solaris this is called automatically when the shared
  * library is loaded, but it doesn't harm if it is called twice.
+ *
+ * This also fills m4ri_profile through m4ri_profile_init(), which
+ * reads the tuning profile named by the environment variable
+ * M4RI_PROFILE or, if that is not set, the file .m4ri_profile in the
+ * home directory if it exists. Hence every process linked with M4RI
+ * picks up the profile of its user. Set M4RI_PROFILE to an empty
+ * string to use the built-in defaults only.
  */
 
 #if defined(__GNUC__)
@@ -593,6 +600,116 @@ void m4ri_fini(void);
 #define __M4RI_CPU_L1_CACHE 16384
 #endif // __M4RI_CPU_L1_CACHE
 
+/***** Parallelism *****/
+
+/**
+ * \brief Set the number of threads used by the parallel regions of the library.
+ *
+ * This is a process-wide setting, meant to be made once at start-up.
+ * It may be changed while other threads call into the library, which
+ * then use either the old or the new value. Concurrent jobs which need
+ * different numbers of threads should use m4ri_set_thread_budget().
+ *
+ * \param n Number of threads, or 0 for the OpenMP default, e.g. OMP_NUM_THREADS (default).
+ */
+
+void m4ri_set_num_threads(int n);
+
+/**
+ * \brief Set the number of threads for calls made from the calling thread.
+ *
+ * The budget overrides m4ri_set_num_threads() for the calling thread
+ * only, such that concurrent jobs in one process can each be held to
+ * their share of the machine.
+ *
+ * \param n Number of threads, or 0 to fall back to m4ri_set_num_threads().
+ */
+
+void m4ri_set_thread_budget(int n);
+
+/**
+ * \brief Return the number of threads a parallel region started by the calling thread uses.
+ *
+ * This is 1 without OpenMP support.
+ */
+
+int m4ri_get_num_threads(void);
+
+/**
+ * \brief Pin the calling thread and its OpenMP threads to CPUs.
+ *
+ * Thread i of a team of m4ri_get_num_threads() threads started by the
+ * calling thread is pinned to cpus[i % ncpus], the calling thread
+ * itself being thread 0. This pins the threads of one parallel region
+ * started for this purpose. Later parallel regions only run on the
+ * same CPUs if the OpenMP runtime reuses the same threads for them,
+ * which common runtimes do for regions of the same size started from
+ * the same thread, but which OpenMP does not guarantee. In particular,
+ * regions of a different size, nested regions and regions started from
+ * other threads may run on threads that are not pinned. For static
+ * setups OMP_PROC_BIND and OMP_PLACES are the reliable alternative.
+ *
+ * \param cpus CPU numbers as used by the operating system.
+ * \param ncpus Length of cpus, or 0 to restore the CPUs the process
+ * was allowed to use before the first call.
+ *
+ * \return 0 on success, -1 if pinning failed or is not supported.
+ */
+
+int m4ri_set_affinity(int const *cpus, int ncpus);
+
+/**
+ * \brief Minimal number of words a loop over rows touches before it runs in parallel.
+ *
+ * Below this, forking threads costs more than it saves.
+ */
+
+#ifndef __M4RI_OMP_MIN_WORDS
+#define __M4RI_OMP_MIN_WORDS 16384
+#endif
+
+/**
+ * \brief Set the number of rows the parallel loops over rows hand out at a time.
+ *
+ * \param chunk Number of rows, or 0 to pick it per loop with m4ri_omp_chunk() (default).
+ */
+
+void m4ri_set_omp_chunk(int chunk);
+
+/**
+ * \brief Set the minimal number of words a loop over rows touches before it runs in parallel.
+ *
+ * \param words Number of words, or 0 for __M4RI_OMP_MIN_WORDS (default).
+ */
+
+void m4ri_set_omp_threshold(uint64_t words);
+
+/**
+ * \brief Return the number of rows to hand out at a time in a parallel loop over rows.
+ *
+ * Unless set with m4ri_set_omp_chunk(), a chunk holds as many rows of
+ * wide words as fit into __M4RI_CPU_L1_CACHE, but is small enough to
+ * give each thread about four chunks to balance the load. Chunks are
+ * a multiple of 8 rows, such that narrow rows sharing a cache line go
+ * to the same thread.
+ *
+ * \param nrows Number of rows of the loop.
+ * \param wide Number of words touched per row.
+ */
+
+int m4ri_omp_chunk(rci_t nrows, wi_t wide);
+
+/**
+ * \brief Return non-zero if a loop over rows is large enough to run in parallel.
+ *
+ * \param nrows Number of rows of the loop.
+ * \param wide Number of words touched per row.
+ *
+ * \see m4ri_set_omp_threshold()
+ */
+
+int m4ri_omp_parallel(rci_t nrows, wi_t wide);
+
 /**
  * \brief Calloc wrapper.
  *
@@ -715,6 +832,23 @@ static inline void m4ri_mm_free(void *condemned, ...) {
 #define RESTRICT
 #endif
 
+/**
+ * \brief Storage class specifier for thread-local variables.
+ *
+ * __M4RI_HAVE_THREAD_LOCAL is 1 iff the compiler supports it.
+ */
+
+#if defined (_MSC_VER)
+#define __M4RI_HAVE_THREAD_LOCAL 1
+#define __M4RI_THREAD_LOCAL __declspec(thread)
+#elif defined (__GNUC__)
+#define __M4RI_HAVE_THREAD_LOCAL 1
+#define __M4RI_THREAD_LOCAL __thread
+#else
+#define __M4RI_HAVE_THREAD_LOCAL 0
+#define __M4RI_THREAD_LOCAL
+#endif
+
 /**
  * Macros for template expansion.
  */
@@ -25,13 +25,216 @@
 
 #include "mmc.h"
 
+#if defined(__M4RI_ENABLE_MMC) && __M4RI_HAVE_THREAD_LOCAL && defined(HAVE_PTHREAD_H) && defined(HAVE_PTHREAD_KEY_CREATE)
+#define __M4RI_MMC_THREAD_EXIT 1
+#include <pthread.h>
+#else
+#define __M4RI_MMC_THREAD_EXIT 0
+#endif
+
 #ifdef __M4RI_ENABLE_MMC
+
+/**
+ * \brief Per-thread memory block cache.
+ *
+ * A thread cache is only touched by its own thread, without locking.
+ * Thread caches are never freed, such that m4ri_mmc_get_stats() can
+ * walk all of them. The cache of an exited thread is emptied into the
+ * depot and handed to the next new thread.
+ */
+typedef struct mmc_tcache {
+  mmb_t block[__M4RI_MMC_NBLOCKS];
+  size_t bytes;
+  int victim;
+  int orphan;
+  uint64_t hits;
+  uint64_t misses;
+  struct mmc_tcache *next;
+} mmc_tcache_t;
+
+/**
+ * All thread caches ever created, protected by the mmc lock.
+ */
+static mmc_tcache_t *mmc_tcaches = NULL;
+
+#if __M4RI_HAVE_THREAD_LOCAL
+static __M4RI_THREAD_LOCAL mmc_tcache_t *mmc_tcache = NULL;
+#endif
+
+/**
+ * The global depot, protected by the mmc lock.
+ */
+static mmb_t mmc_depot[__M4RI_MMC_DEPOT_NBLOCKS];
+static size_t mmc_depot_bytes = 0;
+static int mmc_depot_victim = 0;
+static uint64_t mmc_depot_hits = 0;
+#if !__M4RI_HAVE_THREAD_LOCAL
+static uint64_t mmc_depot_misses = 0;
+#endif
+
+#if __M4RI_HAVE_THREAD_LOCAL
+#if __M4RI_MMC_THREAD_EXIT
+static pthread_key_t mmc_tcache_key;
+static pthread_once_t mmc_tcache_once = PTHREAD_ONCE_INIT;
+static int mmc_tcache_key_ok = 0;
+
+static void mmc_depot_put(void *data, size_t size);
+
 /**
- * The actual memory block cache.
+ * \brief Move the blocks of the cache of an exiting thread to the depot.
  */
-mmb_t m4ri_mmc_cache[__M4RI_MMC_NBLOCKS];
+static void mmc_tcache_release(void *arg) {
+  mmc_tcache_t *tc = (mmc_tcache_t*)arg;
+  for (int i = 0; i < __M4RI_MMC_NBLOCKS; ++i) {
+    if (tc->block[i].size) {
+      void *data = tc->block[i].data;
+      size_t const size = tc->block[i].size;
+      tc->block[i].data = NULL;
+      tc->block[i].size = 0;
+      mmc_depot_put(data, size);
+    }
+  }
+  tc->bytes = 0;
+  mmc_tcache = NULL;
+#if __M4RI_HAVE_OPENMP
+#pragma omp critical (mmc)
+#endif
+  tc->orphan = 1;
+}
+
+static void mmc_tcache_key_init(void) {
+  mmc_tcache_key_ok = (pthread_key_create(&mmc_tcache_key, mmc_tcache_release) == 0);
+}
+#endif // __M4RI_MMC_THREAD_EXIT
+
+static mmc_tcache_t *mmc_tcache_get(void) {
+  mmc_tcache_t *tc = mmc_tcache;
+  if (__M4RI_UNLIKELY(tc == NULL)) {
+#if __M4RI_HAVE_OPENMP
+#pragma omp critical (mmc)
+    {
+#endif
+      /* reuse the cache of an exited thread */
+      for (mmc_tcache_t *o = mmc_tcaches; o; o = o->next) {
+        if (o->orphan) {
+          o->orphan = 0;
+          tc = o;
+          break;
+        }
+      }
+#if __M4RI_HAVE_OPENMP
+    }
+#endif
+    if (tc == NULL) {
+      tc = (mmc_tcache_t*)m4ri_mm_calloc(1, sizeof(mmc_tcache_t));
+#if __M4RI_HAVE_OPENMP
+#pragma omp critical (mmc)
+      {
+#endif
+        tc->next = mmc_tcaches;
+        mmc_tcaches = tc;
+#if __M4RI_HAVE_OPENMP
+      }
+#endif
+    }
+    mmc_tcache = tc;
+#if __M4RI_MMC_THREAD_EXIT
+    pthread_once(&mmc_tcache_once, mmc_tcache_key_init);
+    if (mmc_tcache_key_ok)
+      pthread_setspecific(mmc_tcache_key, tc);
+#endif
+  }
+  return tc;
+}
+#endif // __M4RI_HAVE_THREAD_LOCAL
+
+/**
+ * \brief Take a block of exactly size bytes from the depot or return NULL.
+ */
+static void *mmc_depot_take(size_t size) {
+  void *ret = NULL;
+#if __M4RI_HAVE_OPENMP
+#pragma omp critical (mmc)
+  {
+#endif
+    for (int i = 0; i < __M4RI_MMC_DEPOT_NBLOCKS; ++i) {
+      if (mmc_depot[i].size == size) {
+        ret = mmc_depot[i].data;
+        mmc_depot[i].data = NULL;
+        mmc_depot[i].size = 0;
+        mmc_depot_bytes -= size;
+        break;
+      }
+    }
+#if !__M4RI_HAVE_THREAD_LOCAL
+    if (ret)
+      ++mmc_depot_hits;
+    else
+      ++mmc_depot_misses;
+#endif
+#if __M4RI_HAVE_OPENMP
+  }
+#endif
+  return ret;
+}
+
+/**
+ * \brief Put a block of size bytes into the depot, evicting older blocks if needed.
+ */
+static void mmc_depot_put(void *data, size_t size) {
+  void *evicted[__M4RI_MMC_DEPOT_NBLOCKS];
+  int nevicted = 0;
+#if __M4RI_HAVE_OPENMP
+#pragma omp critical (mmc)
+  {
+#endif
+    int slot = -1;
+    for (int i = 0; i < __M4RI_MMC_DEPOT_NBLOCKS; ++i) {
+      if (mmc_depot[i].size == 0) {
+        slot = i;
+        break;
+      }
+    }
+    /* evict round robin until both the count and the byte bound hold */
+    while (slot < 0 || mmc_depot_bytes + size > __M4RI_MMC_DEPOT_MAX_BYTES) {
+      mmb_t *v = mmc_depot + mmc_depot_victim;
+      mmc_depot_victim = (mmc_depot_victim + 1) % __M4RI_MMC_DEPOT_NBLOCKS;
+      if (v->size == 0)
+        continue;
+      evicted[nevicted++] = v->data;
+      mmc_depot_bytes -= v->size;
+      v->data = NULL;
+      v->size = 0;
+      if (slot < 0)
+        slot = (int)(v - mmc_depot);
+      if (mmc_depot_bytes == 0)
+        break;
+    }
+    mmc_depot[slot].data = data;
+    mmc_depot[slot].size = size;
+    mmc_depot_bytes += size;
+#if __M4RI_HAVE_OPENMP
+  }
+#endif
+  /* release memory outside the critical section */
+  for (int i = 0; i < nevicted; ++i)
+    m4ri_mm_free(evicted[i]);
+}
+
 #endif // __M4RI_ENABLE_MMC
 
+size_t m4ri_mmc_size_class(size_t size) {
+  if (size <= 64)
+    return 64;
+  /* size is in (2^l, 2^(l+1)] which is split into 2^__M4RI_MMC_SUBCLASSES_LOG classes */
+  size_t s = size - 1;
+  int l = 0;
+  while (s >>= 1)
+    ++l;
+  size_t const step = ((size_t)1) << (l - __M4RI_MMC_SUBCLASSES_LOG);
+  return (size + step - 1) & ~(step - 1);
+}
+
 /**
  * \brief Allocate size bytes.
  *
@@ -42,26 +245,38 @@ mmb_t m4ri_mmc_cache[__M4RI_MMC_NBLOCKS];
 void *m4ri_mmc_malloc(size_t size) {
 
 #ifdef __M4RI_ENABLE_MMC
-  void *ret = NULL;
+  if (size > __M4RI_MMC_THRESHOLD)
+    return m4ri_mm_malloc(size);
 
-#if __M4RI_HAVE_OPENMP
-#pragma omp critical (mmc)
-  {
-#endif
-    mmb_t *mm = m4ri_mmc_cache;
-    if (size <= __M4RI_MMC_THRESHOLD) {
-      for (int i = 0; i < __M4RI_MMC_NBLOCKS; ++i) {
-        if(mm[i].size == size) {
-          ret = mm[i].data;
-          mm[i].data = NULL;
-          mm[i].size = 0;
-          break;
-        }
-      }
+  size = m4ri_mmc_size_class(size);
+
+#if __M4RI_HAVE_THREAD_LOCAL
+  mmc_tcache_t *tc = mmc_tcache_get();
+  mmb_t *mm = tc->block;
+  for (int i = 0; i < __M4RI_MMC_NBLOCKS; ++i) {
+    if(mm[i].size == size) {
+      void *ret = mm[i].data;
+      mm[i].data = NULL;
+      mm[i].size = 0;
+      tc->bytes -= size;
+      ++tc->hits;
+      return ret;
     }
-#if __M4RI_HAVE_OPENMP
   }
+#endif // __M4RI_HAVE_THREAD_LOCAL
+
+  void *ret = mmc_depot_take(size);
+#if __M4RI_HAVE_THREAD_LOCAL
+  if (ret) {
+    ++tc->hits;
+#if __M4RI_HAVE_OPENMP
+#pragma omp atomic
 #endif
+    ++mmc_depot_hits;
+  } else {
+    ++tc->misses;
+  }
+#endif // __M4RI_HAVE_THREAD_LOCAL
   if (ret)
     return ret;
   else
@@ -82,59 +297,127 @@ void *m4ri_mmc_malloc(size_t size) {
  */
 void m4ri_mmc_free(void *condemned, size_t size) {
 #ifdef __M4RI_ENABLE_MMC
+  if (size > __M4RI_MMC_THRESHOLD) {
+    m4ri_mm_free(condemned);
+    return;
+  }
+
+  size = m4ri_mmc_size_class(size);
+
+#if __M4RI_HAVE_THREAD_LOCAL
+  if (size > __M4RI_MMC_TCACHE_MAX_BYTES) {
+    mmc_depot_put(condemned, size);
+    return;
+  }
+  mmc_tcache_t *tc = mmc_tcache_get();
+  mmb_t *mm = tc->block;
+  int slot = -1;
+  for(int i = 0; i < __M4RI_MMC_NBLOCKS; ++i) {
+    if(mm[i].size == 0) {
+      slot = i;
+      break;
+    }
+  }
+  /* the thread cache is full, move its oldest entries to the depot until both bounds hold */
+  while (slot < 0 || tc->bytes + size > __M4RI_MMC_TCACHE_MAX_BYTES) {
+    mmb_t *v = mm + tc->victim;
+    tc->victim = (tc->victim + 1) % __M4RI_MMC_NBLOCKS;
+    if (v->size == 0)
+      continue;
+    void *data = v->data;
+    size_t const data_size = v->size;
+    v->data = NULL;
+    v->size = 0;
+    tc->bytes -= data_size;
+    if (slot < 0)
+      slot = (int)(v - mm);
+    mmc_depot_put(data, data_size);
+  }
+  mm[slot].size = size;
+  mm[slot].data = condemned;
+  tc->bytes += size;
+#else
+  mmc_depot_put(condemned, size);
+#endif // __M4RI_HAVE_THREAD_LOCAL
+
+#else // __M4RI_ENABLE_MMC
+  m4ri_mm_free(condemned);
+#endif // __M4RI_ENABLE_MMC
+}
 
+void m4ri_mmc_get_stats(m4ri_mmc_stats_t *stats) {
+  stats->hits = 0;
+  stats->depot_hits = 0;
+  stats->misses = 0;
+  stats->blocks_held = 0;
+  stats->bytes_held = 0;
+#ifdef __M4RI_ENABLE_MMC
 #if __M4RI_HAVE_OPENMP
 #pragma omp critical (mmc)
   {
 #endif
-    static int j = 0;
-    mmb_t *mm = m4ri_mmc_cache;
-    if (size < __M4RI_MMC_THRESHOLD) {
-      for(int i = 0; i < __M4RI_MMC_NBLOCKS; ++i) {
-        if(mm[i].size == 0) {
-          mm[i].size = size;
-          mm[i].data = condemned;
-          goto done;
+    for (mmc_tcache_t *tc = mmc_tcaches; tc; tc = tc->next) {
+      stats->hits += tc->hits;
+      stats->misses += tc->misses;
+      for (int i = 0; i < __M4RI_MMC_NBLOCKS; ++i) {
+        if (tc->block[i].size) {
+          stats->blocks_held++;
+          stats->bytes_held += tc->block[i].size;
         }
       }
-      m4ri_mm_free(mm[j].data);
-      mm[j].size = size;
-      mm[j].data = condemned;
-      j = (j+1) % __M4RI_MMC_NBLOCKS;
-    } else {
-      m4ri_mm_free(condemned);
     }
-  done:
-    ;
+    for (int i = 0; i < __M4RI_MMC_DEPOT_NBLOCKS; ++i) {
+      if (mmc_depot[i].size) {
+        stats->blocks_held++;
+        stats->bytes_held += mmc_depot[i].size;
+      }
+    }
+    stats->depot_hits = mmc_depot_hits;
+#if !__M4RI_HAVE_THREAD_LOCAL
+    stats->hits = mmc_depot_hits;
+    stats->misses = mmc_depot_misses;
+#endif
 #if __M4RI_HAVE_OPENMP
   }
-#endif // __M4RI_HAVE_OPENMP
-#else // __M4RI_ENABLE_MMC
-  m4ri_mm_free(condemned);
+#endif
 #endif // __M4RI_ENABLE_MMC
 }
 
 /**
  * \brief Cleans up memory block cache.
-
  *
- * This function is called automatically when the shared library is unloaded.
- *
- * \warning Not thread safe.
+ * This releases the blocks in the cache of the calling thread and in
+ * the depot. The caches of other threads belong to them and are
+ * returned to the depot when they exit. This function is called
+ * automatically when the shared library is unloaded.
  */
 void m4ri_mmc_cleanup(void) {
 #ifdef __M4RI_ENABLE_MMC
 
+#if __M4RI_HAVE_THREAD_LOCAL
+  mmc_tcache_t *tc = mmc_tcache;
+  if (tc) {
+    for(int i = 0; i < __M4RI_MMC_NBLOCKS; ++i) {
+      if (tc->block[i].size)
+        m4ri_mm_free(tc->block[i].data);
+      tc->block[i].data = NULL;
+      tc->block[i].size = 0;
+    }
+    tc->bytes = 0;
+  }
+#endif // __M4RI_HAVE_THREAD_LOCAL
+
 #if __M4RI_HAVE_OPENMP
 #pragma omp critical (mmc)
- {
- #endif
-    mmb_t *mm = m4ri_mmc_cache;
-    for(int i = 0; i < __M4RI_MMC_NBLOCKS; ++i) {
-      if (mm[i].size)
-        m4ri_mm_free(mm[i].data);
-      mm[i].size = 0;
+  {
+#endif
+    for(int i = 0; i < __M4RI_MMC_DEPOT_NBLOCKS; ++i) {
+      if (mmc_depot[i].size)
+        m4ri_mm_free(mmc_depot[i].data);
+      mmc_depot[i].data = NULL;
+      mmc_depot[i].size = 0;
     }
+    mmc_depot_bytes = 0;
 #if __M4RI_HAVE_OPENMP
   }
 #endif // __M4RI_HAVE_OPENMP
@@ -42,15 +42,86 @@ void m4ri_mmc_cleanup(void);
 #define __M4RI_ENABLE_MMC
 
 /**
- * \brief Number of blocks that are cached.
+ * \brief Number of blocks that are cached per thread.
  */
 #define __M4RI_MMC_NBLOCKS 16
 
+/**
+ * \brief Maximal number of bytes cached per thread.
+ */
+#define __M4RI_MMC_TCACHE_MAX_BYTES ((size_t)__M4RI_MMC_THRESHOLD)
+
+/**
+ * \brief Number of blocks in the global depot shared by all threads.
+ */
+#define __M4RI_MMC_DEPOT_NBLOCKS 64
+
+/**
+ * \brief Maximal number of bytes held by the global depot.
+ */
+#define __M4RI_MMC_DEPOT_MAX_BYTES (4 * (size_t)__M4RI_MMC_THRESHOLD)
+
 /**
  * \brief Maximal size of blocks stored in cache.
  */
 #define __M4RI_MMC_THRESHOLD __M4RI_CPU_L3_CACHE
 
+/**
+ * \brief Logarithm of the number of size classes per power of two.
+ *
+ * Requests are rounded up to the next size class, so with 4 classes
+ * at most a quarter of each cached block is wasted.
+ */
+#define __M4RI_MMC_SUBCLASSES_LOG 2
+
+/**
+ * \brief Statistics about the memory block cache.
+ */
+typedef struct {
+  /**
+   * Number of requests served from a thread cache or the depot.
+   */
+  uint64_t hits;
+
+  /**
+   * Number of requests (included in hits) served from the depot.
+   */
+  uint64_t depot_hits;
+
+  /**
+   * Number of cacheable requests passed on to the system allocator.
+   */
+  uint64_t misses;
+
+  /**
+   * Number of blocks currently held by all caches.
+   */
+  size_t blocks_held;
+
+  /**
+   * Number of bytes currently held by all caches.
+   */
+  size_t bytes_held;
+
+} m4ri_mmc_stats_t;
+
+/**
+ * \brief Collect statistics about the memory block cache.
+ *
+ * The counters of threads other than the calling one are read without
+ * synchronisation and may hence be slightly out of date.
+ *
+ * \param stats Filled with the current statistics.
+ */
+void m4ri_mmc_get_stats(m4ri_mmc_stats_t *stats);
+
+/**
+ * \brief Return the number of bytes actually allocated for a request of size bytes.
+ *
+ * \param size Number of bytes.
+ */
+size_t m4ri_mmc_size_class(size_t size);
+
 /**
  * \brief Tuple of pointer to allocated memory block and it's size.
  */
@@ -29,9 +29,37 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#endif
+
+#if defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_FCNTL_H)
+#include <fcntl.h>
+#endif
+
+#if defined(HAVE_SYS_SYSCALL_H)
+#include <sys/syscall.h>
+#endif
+
+#if defined(HAVE_NUMAIF_H)
+#include <numaif.h>
+#endif
+
 #include "mzd.h"
 #include "parity.h"
 #include "mmc.h"
+#include "dispatch.h"
+#include "profile.h"
+
+#if __M4RI_HAVE_OPENMP
+#include <omp.h>
+#endif
 
 
 typedef struct mzd_t_cache {
@@ -48,8 +76,33 @@ typedef struct mzd_t_cache {
 
 #define __M4RI_MZD_T_CACHE_MAX 16
 static mzd_t_cache_t mzd_cache;
-static mzd_t_cache_t* current_cache = &mzd_cache;
 
+/*
+ * Under OpenMP the pool is shared by all threads: slots are claimed
+ * and released with atomic operations on the used bitmap and caches
+ * are only ever appended to the list (under a lock), never removed,
+ * such that the list can be traversed without locking.
+ *
+ * Without compiler support for atomics we fall back to malloc.
+ */
+
+#if __M4RI_HAVE_OPENMP && !defined(__GNUC__)
+#define __M4RI_MZD_T_POOL 0
+#else
+#define __M4RI_MZD_T_POOL 1
+#endif
+
+#if __M4RI_HAVE_OPENMP
+#define __M4RI_MZD_T_CAS(ptr, oldval, newval) __sync_bool_compare_and_swap(ptr, oldval, newval)
+#define __M4RI_MZD_T_AND(ptr, mask) __sync_fetch_and_and(ptr, mask)
+#define __M4RI_MZD_T_BARRIER() __sync_synchronize()
+#else
+#define __M4RI_MZD_T_CAS(ptr, oldval, newval) (*(ptr) == (oldval) ? (*(ptr) = (newval), 1) : 0)
+#define __M4RI_MZD_T_AND(ptr, mask) (*(ptr) &= (mask))
+#define __M4RI_MZD_T_BARRIER()
+#endif
+
+#if __M4RI_MZD_T_POOL
 static int log2_floor(uint64_t v) {
   static uint64_t const b[] = { 0x2, 0xC, 0xF0, 0xFF00, 0xFFFF0000, 0xFFFFFFFF00000000 };
   static unsigned int const S[] = { 1, 2, 4, 8, 16, 32 };
@@ -64,6 +117,7 @@ static int log2_floor(uint64_t v) {
   }
   return r;
 }
+#endif // __M4RI_MZD_T_POOL
 
 /*
  * Return a pointer to a new mzd_t structure.
@@ -72,119 +126,259 @@ static int log2_floor(uint64_t v) {
  */
 
 static mzd_t* mzd_t_malloc() {
+#if __M4RI_MZD_T_POOL
+  int i = 0;
+  mzd_t_cache_t *cache = &mzd_cache;
+  while (1) {
+    uint64_t used = *(uint64_t volatile*)&cache->used;
+    while (used != (uint64_t)-1) {
+      int const free_entry = log2_floor(~used);
+      if (__M4RI_MZD_T_CAS(&cache->used, used, used | ((uint64_t)1 << free_entry)))
+        return &cache->mzd[free_entry];
+      used = *(uint64_t volatile*)&cache->used;
+    }
+
+    if (++i >= __M4RI_MZD_T_CACHE_MAX)
+      break;
+
+    if (*(mzd_t_cache_t* volatile*)&cache->next == NULL) {
 #if __M4RI_HAVE_OPENMP
-  return (mzd_t*)m4ri_mm_malloc(sizeof(mzd_t));
-#else
-  mzd_t *ret = NULL;
-  int i=0;
-
-  if (current_cache->used == (uint64_t)-1) {
-    mzd_t_cache_t *cache = &mzd_cache;
-    while (cache && cache->used == (uint64_t)-1) {
-      current_cache = cache;
-      cache = cache->next;
-      i++;
-    }
-    if (!cache && i< __M4RI_MZD_T_CACHE_MAX) {
-      cache = (mzd_t_cache_t*)m4ri_mm_malloc_aligned(sizeof(mzd_t_cache_t), 64);
-      memset((char*)cache, 0, sizeof(mzd_t_cache_t));
-
-      cache->prev = current_cache;
-      current_cache->next = cache;
-      current_cache = cache;
-    } else if (!cache && i>= __M4RI_MZD_T_CACHE_MAX) {
-      /* We have reached the upper limit on the number of caches */
-      ret = (mzd_t*)m4ri_mm_malloc(sizeof(mzd_t));
-    } else {
-      current_cache = cache;
+#pragma omp critical (mzd_t_cache)
+      {
+#endif
+        if (cache->next == NULL) {
+          mzd_t_cache_t *fresh = (mzd_t_cache_t*)m4ri_mm_malloc_aligned(sizeof(mzd_t_cache_t), 64);
+          memset((char*)fresh, 0, sizeof(mzd_t_cache_t));
+          fresh->prev = cache;
+          /* make sure fresh is initialised before other threads can see it */
+          __M4RI_MZD_T_BARRIER();
+          cache->next = fresh;
+        }
+#if __M4RI_HAVE_OPENMP
+      }
+#endif
     }
+    cache = cache->next;
   }
-  if (ret == NULL) {
-    int free_entry =log2_floor(~current_cache->used);
-    current_cache->used |= ((uint64_t)1 << free_entry);
-    ret = &current_cache->mzd[free_entry];
-  }
-  return ret;
-#endif //__M4RI_HAVE_OPENMP
-
+  /* We have reached the upper limit on the number of caches */
+#endif // __M4RI_MZD_T_POOL
+  return (mzd_t*)m4ri_mm_malloc(sizeof(mzd_t));
 }
 
 static void mzd_t_free(mzd_t *M) {
-#if __M4RI_HAVE_OPENMP
-  m4ri_mm_free(M);
-#else
-  int foundit = 0;
-  mzd_t_cache_t *cache = &mzd_cache;
-  while(cache) {
+#if __M4RI_MZD_T_POOL
+  for (mzd_t_cache_t *cache = &mzd_cache; cache; cache = *(mzd_t_cache_t* volatile*)&cache->next) {
     size_t entry = M - cache->mzd;
     if (entry < 64) {
-      cache->used &= ~((uint64_t)1 << entry);
-      if (cache->used == 0) {
-        if (cache == &mzd_cache) {
-          current_cache = cache;
-        } else {
-          if (cache == current_cache) {
-            current_cache = cache->prev;
-          }
-          cache->prev->next = cache->next;
-          if (cache->next)
-            cache->next->prev = cache->prev;
-          m4ri_mm_free(cache);
-        }
-      }
-      foundit = 1;
-      break;
+      __M4RI_MZD_T_AND(&cache->used, ~((uint64_t)1 << entry));
+      return;
     }
-    cache = cache->next;
   }
-  if(!foundit) {
-    m4ri_mm_free(M);
+#endif // __M4RI_MZD_T_POOL
+  m4ri_mm_free(M);
+}
+
+/*
+ * Blocks of large matrices may be mapped directly from the operating
+ * system, see mzd_alloc_policy_t. Mapped blocks are rounded up to a
+ * multiple of the huge page size and aligned to it, they are zeroed
+ * lazily by the kernel.
+ */
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP) && defined(MAP_ANONYMOUS)
+#define __M4RI_MZD_MAP 1
+#else
+#define __M4RI_MZD_MAP 0
+#endif
+
+#if defined(SYS_mbind) && defined(SYS_get_mempolicy)
+#define __M4RI_MZD_MBIND 1
+#else
+#define __M4RI_MZD_MBIND 0
+#endif
+
+/*
+ * We call mbind and get_mempolicy through syscall() to not depend on
+ * libnuma and only take the constants from <numaif.h> if it is
+ * available. The values are part of the Linux system call ABI.
+ */
+
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+#ifndef MPOL_F_MEMS_ALLOWED
+#define MPOL_F_MEMS_ALLOWED (1 << 2)
+#endif
+
+/* the maximum number of NUMA nodes of Linux on x86-64 */
+#define __M4RI_MZD_MAX_NUMNODES 1024
+
+/*
+ * Read by mzd_init() without synchronisation, see
+ * mzd_set_alloc_policy().
+ */
+
+static int mzd_alloc_policy = mzd_alloc_default;
+
+void mzd_set_alloc_policy(int policy) {
+  mzd_alloc_policy = policy;
+}
+
+int mzd_get_alloc_policy(void) {
+  return mzd_alloc_policy;
+}
+
+#if __M4RI_MZD_MAP
+
+static inline size_t mzd_block_mapsize(size_t size) {
+  return (size + __M4RI_HUGEPAGE_SIZE - 1) & ~(__M4RI_HUGEPAGE_SIZE - 1);
+}
+
+static word *mzd_block_map(size_t size, int policy) {
+  size_t const len = mzd_block_mapsize(size);
+  /* over-allocate by one huge page and trim to get an aligned mapping */
+  void *p = mmap(NULL, len + __M4RI_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return NULL;
+  uintptr_t const base = (uintptr_t)p;
+  uintptr_t const aligned = (base + __M4RI_HUGEPAGE_SIZE - 1) & ~(uintptr_t)(__M4RI_HUGEPAGE_SIZE - 1);
+  if (aligned != base)
+    munmap(p, aligned - base);
+  if (aligned + len != base + len + __M4RI_HUGEPAGE_SIZE)
+    munmap((void*)(aligned + len), base + __M4RI_HUGEPAGE_SIZE - aligned);
+  p = (void*)aligned;
+
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+  if (policy & mzd_alloc_hugepages)
+    madvise(p, len, MADV_HUGEPAGE);
+#endif
+
+#if __M4RI_MZD_MBIND
+  if (policy & mzd_alloc_numa_interleave) {
+    unsigned long nodemask[__M4RI_MZD_MAX_NUMNODES / (8 * sizeof(unsigned long))];
+    memset(nodemask, 0, sizeof(nodemask));
+    /*
+     * The kernel reads maxnode - 1 bits of the mask passed to mbind, so
+     * we pass one more than the number of bits of nodemask. Failures
+     * leave the default placement.
+     */
+    if (syscall(SYS_get_mempolicy, NULL, nodemask, (unsigned long)__M4RI_MZD_MAX_NUMNODES, NULL,
+                (unsigned long)MPOL_F_MEMS_ALLOWED) == 0)
+      syscall(SYS_mbind, p, len, (unsigned long)MPOL_INTERLEAVE, nodemask,
+              (unsigned long)__M4RI_MZD_MAX_NUMNODES + 1, 0UL);
   }
 #endif
+  return (word*)p;
 }
 
+static void mzd_block_unmap(word *begin, size_t size) {
+  munmap(begin, mzd_block_mapsize(size));
+}
+
+#endif //__M4RI_MZD_MAP
+
+static mzd_t *_mzd_init(rci_t r, rci_t c, int policy, int zero);
+
 mzd_t *mzd_init(rci_t r, rci_t c) {
-  assert(sizeof(mzd_t) == 64);
+  return _mzd_init(r, c, mzd_alloc_policy, TRUE);
+}
 
-  mzd_t *A = mzd_t_malloc();
+mzd_t *mzd_init_policy(rci_t r, rci_t c, int policy) {
+  return _mzd_init(r, c, policy, TRUE);
+}
 
+mzd_t *mzd_init_uninitialized(rci_t r, rci_t c) {
+  return _mzd_init(r, c, mzd_alloc_policy, FALSE);
+}
+
+/*
+ * Set up the dimensions and the block table of A, but do not allocate
+ * the blocks. Returns the number of blocks.
+ */
+
+static inline wi_t _mzd_rowstride(rci_t c) {
+  wi_t const width = (c + m4ri_radix - 1) / m4ri_radix;
+  return (width < mzd_paddingwidth || (width & 1) == 0) ? width : width + 1;
+}
+
+static int _mzd_init_layout(mzd_t *A, rci_t r, rci_t c) {
   A->nrows = r;
   A->ncols = c;
   A->width = (c + m4ri_radix - 1) / m4ri_radix;
-  A->rowstride = (A->width < mzd_paddingwidth || (A->width & 1) == 0) ? A->width : A->width + 1;
+  A->rowstride = _mzd_rowstride(c);
   A->high_bitmask = __M4RI_LEFT_BITMASK(c % m4ri_radix);
   A->flags = (A->high_bitmask != m4ri_ffff) ? mzd_flag_nonzero_excess : 0;
   A->offset_vector = 0;
   A->row_offset = 0;
+  A->blockrows_log = 0;
 
-  A->rows = (word**)m4ri_mmc_calloc(r + 1, sizeof(word*)); // We're overcomitting here.
+  A->rows = NULL; // built on demand by mzd_rows()
 
-  if (r && c) {
-    int blockrows = __M4RI_MAX_MZD_BLOCKSIZE / A->rowstride;
-    A->blockrows_log = 0;
-    while(blockrows >>= 1)
-      A->blockrows_log++;
-    blockrows = 1 << A->blockrows_log;
+  if (!r || !c) {
+    A->blocks = NULL;
+    return 0;
+  }
 
-    int const blockrows_mask = blockrows - 1;
-    int const nblocks = (r + blockrows - 1) / blockrows;
-    A->flags |= (nblocks > 1) ? mzd_flag_multiple_blocks : 0;
-    A->blocks = (mzd_block_t*)m4ri_mmc_calloc(nblocks + 1, sizeof(mzd_block_t));
+  int blockrows = __M4RI_MAX_MZD_BLOCKSIZE / A->rowstride;
+  while(blockrows >>= 1)
+    A->blockrows_log++;
+  blockrows = 1 << A->blockrows_log;
 
-    size_t block_words = (r - (nblocks - 1) * blockrows) * A->rowstride;
-    for(int i = nblocks - 1; i >= 0; --i) {
-      A->blocks[i].size = block_words * sizeof(word);
-      A->blocks[i].begin = (word*)m4ri_mmc_calloc(1, A->blocks[i].size);
-      A->blocks[i].end = A->blocks[i].begin + block_words;
-      block_words = blockrows * A->rowstride;
-    }
+  int const nblocks = (r + blockrows - 1) / blockrows;
+  A->flags |= (nblocks > 1) ? mzd_flag_multiple_blocks : 0;
+  A->blocks = (mzd_block_t*)m4ri_mmc_calloc(nblocks + 1, sizeof(mzd_block_t));
 
-    for(rci_t i = 0; i < A->nrows; ++i) {
-      A->rows[i] = A->blocks[i >> A->blockrows_log].begin + (i & blockrows_mask) * A->rowstride;
-    }
+  size_t block_words = (r - (nblocks - 1) * blockrows) * A->rowstride;
+  for(int i = nblocks - 1; i >= 0; --i) {
+    A->blocks[i].size = block_words * sizeof(word);
+    block_words = blockrows * A->rowstride;
+  }
+  return nblocks;
+}
 
-  } else {
-    A->blocks = NULL;
+static mzd_t *_mzd_init(rci_t r, rci_t c, int policy, int zero) {
+  assert(sizeof(mzd_t) == 64);
+
+  mzd_t *A = mzd_t_malloc();
+  int const nblocks = _mzd_init_layout(A, r, c);
+  if (!nblocks)
+    return A;
+
+#if __M4RI_MZD_MAP
+  if (policy != mzd_alloc_default && (size_t)r * A->rowstride * sizeof(word) >= __M4RI_HUGEPAGE_SIZE)
+    A->flags |= mzd_flag_mapped_blocks;
+#endif
+
+  for(int i = nblocks - 1; i >= 0; --i) {
+#if __M4RI_MZD_MAP
+    if (A->flags & mzd_flag_mapped_blocks) {
+      A->blocks[i].begin = mzd_block_map(A->blocks[i].size, policy);
+      if (A->blocks[i].begin == NULL)
+        m4ri_die("mzd_init_policy: mapping %zu bytes failed.\n", A->blocks[i].size);
+    } else
+#endif
+    A->blocks[i].begin = (word*)(zero ? m4ri_mmc_calloc(1, A->blocks[i].size) : m4ri_mmc_malloc(A->blocks[i].size));
+    A->blocks[i].end = A->blocks[i].begin + A->blocks[i].size / sizeof(word);
+  }
+
+  if ((A->flags & mzd_flag_mapped_blocks) && (policy & mzd_alloc_numa_firsttouch)) {
+    /* The pages are still untouched: fault them in from the threads which will process them. */
+    wi_t const rowstride = A->rowstride;
+#if __M4RI_HAVE_OPENMP
+    int const chunk = m4ri_omp_chunk(A->nrows, A->width);
+#pragma omp parallel for schedule(static,chunk) num_threads(m4ri_get_num_threads())
+#endif
+    for(rci_t i = 0; i < r; ++i)
+      memset(mzd_row(A, i), 0, rowstride * sizeof(word));
+  } else if (!zero && !(A->flags & mzd_flag_mapped_blocks)) {
+    /* Callers overwrite the valid bits only, keep the excess bits and padding well defined. */
+    wi_t const last = A->width - 1;
+    for(rci_t i = 0; i < r; ++i) {
+      word *row = mzd_row(A, i);
+      for(wi_t j = last; j < A->rowstride; ++j)
+        row[j] = 0;
+    }
   }
 
   return A;
@@ -198,7 +392,7 @@ mzd_t *mzd_init(rci_t r, rci_t c) {
    |                                 ^                                        /|                           |
    |                    m->row_offset|                      m->offset_vector_/ |                           |
    |                                 v                                      /  |                           |
-   |  .--------------------------------------------------------------------v<--|---- m->rows[0]            |_ skipped_blocks (in blocks)
+   |  .--------------------------------------------------------------------v<--|---- mzd_row(m, 0)         |_ skipped_blocks (in blocks)
    |  |m (also a window)             ^                                     |   |                           |
    |  |                              |                                     |   |                           |
    `---------------------------------|-----------------------------------------'                           v
@@ -206,8 +400,8 @@ mzd_t *mzd_init(rci_t r, rci_t c) {
    |  |                      ^   lowr|                                     |_^ |
    |  |    window->row_offset|       |            window->offset_vector _-^|   |
    |  |                      v       v                               _-^   |   |
-   |  |  .----------------------------------------------------------v<--.  |<--|---- m->rows[lowr]
-   |  |  |window                                                    |    `-|---|---- window->rows[0]
+   |  |  .----------------------------------------------------------v<--.  |<--|---- mzd_row(m, lowr)
+   |  |  |window                                                    |    `-|---|---- mzd_row(window, 0)
    |  |  |                                                          |      |   |
    `---------------------------------------------------------------------------'
    .---------------------------------------------------------------------------.  <-- m->blocks[2].begin <-- windows.blocks[1].begin
@@ -248,29 +442,154 @@ mzd_t *mzd_init_window(mzd_t *M, rci_t lowr, rci_t lowc, rci_t highr, rci_t high
   W->blocks = &M->blocks[skipped_blocks];
   wi_t const wrd_offset = lowc / m4ri_radix;
   W->offset_vector = (M->offset_vector + wrd_offset) + (W->row_offset - M->row_offset) * W->rowstride;
-  if(nrows)
-    W->rows = (word**)m4ri_mmc_calloc(nrows + 1, sizeof(word*));
-  else
-    W->rows = NULL;
-  for(rci_t i = 0; i < nrows; ++i) {
-    W->rows[i] = M->rows[lowr + i] + wrd_offset;
-  }
+  W->rows = NULL;
   if (mzd_row_to_block(W, nrows - 1) > 0)
     W->flags |= M->flags & mzd_flag_multiple_blocks;
 
   /* offset_vector is the distance from the start of the first block to the first word of the first row. */
-  assert(nrows == 0 || W->blocks[0].begin + W->offset_vector == W->rows[0]);
+  assert(nrows == 0 || W->blocks[0].begin + W->offset_vector == mzd_row(M, lowr) + wrd_offset);
 
   __M4RI_DD_MZD(W);
   return W;
 }
 
+void mzd_file_header_init(mzd_file_header_t *header, rci_t r, rci_t c) {
+  memset(header, 0, sizeof(mzd_file_header_t));
+  memcpy(header->magic, __M4RI_MZD_FILE_MAGIC, sizeof(header->magic));
+  header->version = __M4RI_MZD_FILE_VERSION;
+  header->byteorder = 0x0102030405060708ULL;
+  header->nrows = r;
+  header->ncols = c;
+  header->rowstride = _mzd_rowstride(c);
+}
+
+int mzd_file_header_check(mzd_file_header_t const *header) {
+  if (memcmp(header->magic, __M4RI_MZD_FILE_MAGIC, sizeof(header->magic)))
+    return 1;
+  if (header->version != __M4RI_MZD_FILE_VERSION || header->byteorder != 0x0102030405060708ULL)
+    return 2;
+  if (header->nrows > (uint64_t)INT_MAX || header->ncols > (uint64_t)INT_MAX)
+    return 3;
+  if (header->rowstride != (uint64_t)_mzd_rowstride((rci_t)header->ncols))
+    return 3;
+  return 0;
+}
+
+#if __M4RI_MZD_MAP && defined(HAVE_FCNTL_H) && defined(HAVE_UNISTD_H) && defined(HAVE_FTRUNCATE)
+#define __M4RI_MZD_FILE 1
+#else
+#define __M4RI_MZD_FILE 0
+#endif
+
+mzd_t *mzd_init_mmap(char const *path, rci_t r, rci_t c, int mode) {
+#if __M4RI_MZD_FILE
+  mzd_file_header_t header;
+  int fd;
+  if (mode == mzd_mmap_create) {
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+      m4ri_die("mzd_init_mmap: cannot create '%s'.\n", path);
+    mzd_file_header_init(&header, r, c);
+    /* the rows are a hole in the file which reads as zero */
+    if (write(fd, &header, sizeof(header)) != sizeof(header) ||
+        ftruncate(fd, sizeof(header) + (off_t)r * header.rowstride * sizeof(word)))
+      m4ri_die("mzd_init_mmap: cannot write '%s'.\n", path);
+  } else {
+    fd = open(path, (mode == mzd_mmap_private) ? O_RDONLY : O_RDWR);
+    if (fd < 0)
+      m4ri_die("mzd_init_mmap: cannot open '%s'.\n", path);
+    if (read(fd, &header, sizeof(header)) != sizeof(header) || mzd_file_header_check(&header))
+      m4ri_die("mzd_init_mmap: '%s' is not a matrix file.\n", path);
+    if ((r || c) && (header.nrows != (uint64_t)r || header.ncols != (uint64_t)c))
+      m4ri_die("mzd_init_mmap: '%s' holds a %d x %d matrix.\n", path, (int)header.nrows, (int)header.ncols);
+    r = (rci_t)header.nrows;
+    c = (rci_t)header.ncols;
+    if (lseek(fd, 0, SEEK_END) < (off_t)(sizeof(header) + (off_t)r * header.rowstride * sizeof(word)))
+      m4ri_die("mzd_init_mmap: '%s' is truncated.\n", path);
+  }
+
+  mzd_t *A = mzd_t_malloc();
+  int const nblocks = _mzd_init_layout(A, r, c);
+  if (nblocks) {
+    size_t const len = sizeof(header) + (size_t)r * A->rowstride * sizeof(word);
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, (mode == mzd_mmap_private) ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+      m4ri_die("mzd_init_mmap: mapping '%s' failed.\n", path);
+    word *data = (word*)((char*)p + sizeof(header));
+    for(int i = 0; i < nblocks; ++i) {
+      A->blocks[i].begin = data + ((size_t)i << A->blockrows_log) * A->rowstride;
+      A->blocks[i].end = A->blocks[i].begin + A->blocks[i].size / sizeof(word);
+    }
+    A->flags |= mzd_flag_file_backed;
+  }
+  close(fd);
+  return A;
+#else
+  m4ri_die("mzd_init_mmap: memory mapped files are not supported on this platform.\n");
+  return NULL;
+#endif
+}
+
+#if __M4RI_MZD_FILE
+/* The mapping starts with the header right before the first block and spans all blocks. */
+static inline size_t _mzd_file_mapping(mzd_t const *A, void **base) {
+  size_t len = sizeof(mzd_file_header_t);
+  for(int i = 0; A->blocks[i].size; ++i)
+    len += A->blocks[i].size;
+  *base = (char*)A->blocks[0].begin - sizeof(mzd_file_header_t);
+  return len;
+}
+#endif
+
+void mzd_mmap_sync(mzd_t const *A) {
+#if __M4RI_MZD_FILE
+  if (!mzd_owns_blocks(A) || !(A->flags & mzd_flag_file_backed))
+    return;
+  void *base;
+  size_t const len = _mzd_file_mapping(A, &base);
+  msync(base, len, MS_SYNC);
+#endif
+}
+
+word **mzd_rows(mzd_t *M) {
+  word **rows;
+  /* M->rows is only ever read and written under the lock, callers keep the result */
+#if __M4RI_HAVE_OPENMP
+#pragma omp critical (mzd_rows)
+#endif
+  {
+    if (M->rows == NULL && M->nrows != 0) {
+      M->rows = (word**)m4ri_mmc_malloc((M->nrows + 1) * sizeof(word*)); // We're overcomitting here.
+      for(rci_t i = 0; i < M->nrows; ++i)
+        M->rows[i] = mzd_row(M, i);
+      M->rows[M->nrows] = NULL;
+    }
+    rows = M->rows;
+  }
+  return rows;
+}
+
 void mzd_free(mzd_t *A) {
   if(A->rows)
     m4ri_mmc_free(A->rows, (A->nrows + 1) * sizeof(word*));
   if(mzd_owns_blocks(A)) {
     int i;
+#if __M4RI_MZD_FILE
+    if (A->flags & mzd_flag_file_backed) {
+      void *base;
+      size_t const len = _mzd_file_mapping(A, &base);
+      munmap(base, len);
+    }
+#endif
     for(i = 0; A->blocks[i].size; ++i) {
+      if (A->flags & mzd_flag_file_backed)
+        continue;
+#if __M4RI_MZD_MAP
+      if (A->flags & mzd_flag_mapped_blocks) {
+        mzd_block_unmap(A->blocks[i].begin, A->blocks[i].size);
+        continue;
+      }
+#endif
       m4ri_mmc_free(A->blocks[i].begin, A->blocks[i].size);
     }
     m4ri_mmc_free(A->blocks, (i + 1) * sizeof(mzd_block_t));
@@ -284,18 +603,19 @@ void mzd_row_add(mzd_t *M, rci_t sourcerow, rci_t destrow) {
 
 void mzd_row_clear_offset(mzd_t *M, rci_t row, rci_t coloffset) {
   wi_t const startblock = coloffset / m4ri_radix;
+  word *truerow = mzd_row(M, row);
   word temp;
 
   /* make sure to start clearing at coloffset */
   if (coloffset%m4ri_radix) {
-    temp = M->rows[row][startblock];
+    temp = truerow[startblock];
     temp &= __M4RI_RIGHT_BITMASK(m4ri_radix - coloffset);
   } else {
     temp = 0;
   }
-  M->rows[row][startblock] = temp;
+  truerow[startblock] = temp;
   for (wi_t i = startblock + 1; i < M->width; ++i) {
-    M->rows[row][i] = 0;
+    truerow[i] = 0;
   }
 
   __M4RI_DD_ROW(M, row);
@@ -490,6 +810,15 @@ static inline void _mzd_copy_transpose_64x64_2(word* RESTRICT dst1, word* RESTRI
   }
 }
 
+/**
+ * Out-of-line version of _mzd_copy_transpose_64x64, used as the
+ * default entry in the dispatch table.
+ */
+
+void _mzd_copy_transpose_64x64_default(word* RESTRICT dst, word const* RESTRICT src, wi_t rowstride_dst, wi_t rowstride_src) {
+  _mzd_copy_transpose_64x64(dst, src, rowstride_dst, rowstride_src);
+}
+
 static unsigned char log2_ceil_table[64] = {
   0, 1, 2, 2, 3, 3, 3, 3,
   4, 4, 4, 4, 4, 4, 4, 4,
@@ -1080,6 +1409,107 @@ static inline void _mzd_copy_transpose_le64xle64(word* RESTRICT dst, word const*
 
 void _mzd_transpose_multiblock(mzd_t *DST, mzd_t const *A, word* RESTRICT* fwdp, word const* RESTRICT* fwsp, rci_t* nrowsp, rci_t* ncolsp);
 
+/*
+ * Transpose the 64 x 64 blocks with block rows [r0, r1) and block
+ * columns [c0, c1) of A into DST.
+ *
+ * The range is halved along its longer side until it holds at most
+ * __M4RI_TRANSPOSE_LEAF_BLOCKS blocks, such that each leaf works on a
+ * patch of A and DST which fits into cache regardless of the size of
+ * the matrix. The first half of each split is run as a task.
+ *
+ * Blocks are addressed through mzd_row(), since 64 aligned rows never
+ * straddle a memory block this also works for matrices made of
+ * multiple blocks.
+ */
+
+static void _mzd_transpose_blocks(mzd_t *DST, mzd_t const *A, rci_t r0, rci_t r1, rci_t c0, rci_t c1) {
+  rci_t const nr = r1 - r0;
+  rci_t const nc = c1 - c0;
+
+  if (nr * nc <= __M4RI_TRANSPOSE_LEAF_BLOCKS) {
+    int const vectorised = (m4ri_dispatch.transpose_64x64 != _mzd_copy_transpose_64x64_default);
+    for (rci_t r = r0; r < r1; ++r) {
+      word const *fws = mzd_row(A, 64 * r);
+      rci_t c = c0;
+      if (!vectorised) {
+        for (; c + 2 <= c1; c += 2) {
+          _mzd_copy_transpose_64x64_2(mzd_row(DST, 64 * c) + r, mzd_row(DST, 64 * (c + 1)) + r,
+                                      fws + c, fws + c + 1, DST->rowstride, A->rowstride);
+        }
+      }
+      for (; c < c1; ++c)
+        m4ri_dispatch.transpose_64x64(mzd_row(DST, 64 * c) + r, fws + c, DST->rowstride, A->rowstride);
+    }
+    return;
+  }
+
+  if (nr >= nc) {
+    rci_t const rm = r0 + nr / 2;
+#if __M4RI_HAVE_OPENMP
+#pragma omp task
+#endif
+    _mzd_transpose_blocks(DST, A, r0, rm, c0, c1);
+    _mzd_transpose_blocks(DST, A, rm, r1, c0, c1);
+  } else {
+    rci_t const cm = c0 + nc / 2;
+#if __M4RI_HAVE_OPENMP
+#pragma omp task
+#endif
+    _mzd_transpose_blocks(DST, A, r0, r1, c0, cm);
+    _mzd_transpose_blocks(DST, A, r0, r1, cm, c1);
+  }
+#if __M4RI_HAVE_OPENMP
+#pragma omp taskwait
+#endif
+}
+
+/*
+ * Cache oblivious version of _mzd_transpose for large matrices. The
+ * whole 64 x 64 blocks are transposed by _mzd_transpose_blocks(), in
+ * parallel if we are not inside a parallel region already, the strips
+ * of fewer than 64 rows or columns at the bottom and right edge
+ * afterwards.
+ */
+
+static mzd_t *_mzd_transpose_recursive(mzd_t *DST, mzd_t const *A) {
+  rci_t const mb = A->nrows / 64;
+  rci_t const nb = A->ncols / 64;
+  int const rrem = A->nrows % 64;
+  int const crem = A->ncols % 64;
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel num_threads(m4ri_get_num_threads()) if(!omp_in_parallel())
+#pragma omp single
+#endif
+  _mzd_transpose_blocks(DST, A, 0, mb, 0, nb);
+
+  if (crem) {
+    for (rci_t r = 0; r < mb; ++r)
+      _mzd_copy_transpose_64xlt64(mzd_row(DST, 64 * nb) + r, mzd_row(A, 64 * r) + nb, DST->rowstride, A->rowstride, crem);
+  }
+  if (rrem) {
+    for (rci_t c = 0; c < nb; ++c)
+      _mzd_copy_transpose_lt64x64(mzd_row(DST, 64 * c) + mb, mzd_row(A, 64 * mb) + c, DST->rowstride, A->rowstride, rrem);
+  }
+  if (rrem && crem) {
+    word *fwd = mzd_row(DST, 64 * nb) + mb;
+    word const *fws = mzd_row(A, 64 * mb) + nb;
+    int const maxsize = MAX(rrem, crem);
+    if (maxsize <= 8)
+      _mzd_copy_transpose_le8xle8(fwd, fws, DST->rowstride, A->rowstride, rrem, crem, maxsize);
+    else if (maxsize <= 16)
+      _mzd_copy_transpose_le16xle16(fwd, fws, DST->rowstride, A->rowstride, rrem, crem, maxsize);
+    else if (maxsize <= 32)
+      _mzd_copy_transpose_le32xle32(fwd, fws, DST->rowstride, A->rowstride, rrem, crem);
+    else
+      _mzd_copy_transpose_le64xle64(fwd, fws, DST->rowstride, A->rowstride, rrem, crem);
+  }
+
+  __M4RI_DD_MZD(DST);
+  return DST;
+}
+
 mzd_t *_mzd_transpose(mzd_t *DST, mzd_t const *A) {
   assert(!mzd_is_windowed(DST) && !mzd_is_windowed(A));
   // We assume that there fit at least 64 rows in a block, if
@@ -1087,6 +1517,9 @@ mzd_t *_mzd_transpose(mzd_t *DST, mzd_t const *A) {
   // of 64 rows, since blockrows is a power of 2.
   assert(A->blockrows_log >= 6 && DST->blockrows_log >= 6);
 
+  if ((uint64_t)A->nrows * A->ncols >= __M4RI_TRANSPOSE_RECURSIVE_CUTOFF && A->nrows >= 64 && A->ncols >= 64)
+    return _mzd_transpose_recursive(DST, A);
+
   rci_t nrows = A->nrows;
   rci_t ncols = A->ncols;
   rci_t maxsize = MAX(nrows, ncols);
@@ -1112,6 +1545,24 @@ mzd_t *_mzd_transpose(mzd_t *DST, mzd_t const *A) {
       ncols = non_register_ncols;
     }
 
+    if (nrows >= 64 && m4ri_dispatch.transpose_64x64 != _mzd_copy_transpose_64x64_default) {
+      // A vectorised kernel was selected at runtime (see dispatch.c), it
+      // does not benefit from the pairing below.
+      wi_t const rowstride_64_dst = 64 * DST->rowstride;
+      rci_t const whole_64cols = ncols / 64;
+      do {
+	for (int j = 0; j < whole_64cols; ++j) {
+	  m4ri_dispatch.transpose_64x64(fwd + j * rowstride_64_dst, fws + j, DST->rowstride, A->rowstride);
+	}
+	nrows -= 64;
+	if (ncols % 64) {
+	  _mzd_copy_transpose_64xlt64(fwd + whole_64cols * rowstride_64_dst, fws + whole_64cols, DST->rowstride, A->rowstride, ncols % 64);
+	}
+	fwd += 1;
+	fws += 64 * A->rowstride;
+      } while(nrows >= 64);
+    }
+
     if (nrows >= 64) {
       /*
        * This is an interesting #if ...
@@ -1381,7 +1832,7 @@ void _mzd_transpose_multiblock(mzd_t *DST, mzd_t const *A, word* RESTRICT* fwdp,
 
 mzd_t *mzd_transpose(mzd_t *DST, mzd_t const *A) {
   if (DST == NULL) {
-    DST = mzd_init( A->ncols, A->nrows );
+    DST = mzd_init_uninitialized( A->ncols, A->nrows );
   } else if (__M4RI_UNLIKELY(DST->nrows != A->ncols || DST->ncols != A->nrows)) {
     m4ri_die("mzd_transpose: Wrong size for return matrix.\n");
   } else {
@@ -1400,7 +1851,7 @@ mzd_t *mzd_transpose(mzd_t *DST, mzd_t const *A) {
   if (__M4RI_LIKELY(!mzd_is_windowed(DST)))
     _mzd_transpose(DST, A);
   else {
-    mzd_t *D = mzd_init(DST->nrows, DST->ncols);
+    mzd_t *D = mzd_init_uninitialized(DST->nrows, DST->ncols);
     _mzd_transpose(D, A);
     mzd_copy(DST, D);
     mzd_free(D);
@@ -1410,6 +1861,64 @@ mzd_t *mzd_transpose(mzd_t *DST, mzd_t const *A) {
   return DST;
 }
 
+/*
+ * Load the 64 x 64 block of A at block row bi and block column bj,
+ * rows and columns outside of A are read as zero.
+ */
+
+static inline void _mzd_load_block_64x64(word *t, mzd_t const *A, rci_t bi, rci_t bj) {
+  rci_t const h = MIN(64, A->nrows - 64 * bi);
+  word const mask = (bj == A->width - 1) ? A->high_bitmask : m4ri_ffff;
+  for (rci_t r = 0; r < h; ++r)
+    t[r] = mzd_row(A, 64 * bi + r)[bj] & mask;
+  for (rci_t r = h; r < 64; ++r)
+    t[r] = 0;
+}
+
+/*
+ * Store t as the 64 x 64 block of A at block row bi and block column
+ * bj, bits outside of A are left untouched.
+ */
+
+static inline void _mzd_store_block_64x64(mzd_t *A, rci_t bi, rci_t bj, word const *t) {
+  rci_t const h = MIN(64, A->nrows - 64 * bi);
+  word const mask = (bj == A->width - 1) ? A->high_bitmask : m4ri_ffff;
+  for (rci_t r = 0; r < h; ++r) {
+    word *w = mzd_row(A, 64 * bi + r) + bj;
+    *w ^= (*w ^ t[r]) & mask;
+  }
+}
+
+mzd_t *mzd_transpose_inplace(mzd_t *A) {
+  if (A->nrows != A->ncols)
+    m4ri_die("mzd_transpose_inplace: A (%d x %d) is not square.\n", A->nrows, A->ncols);
+
+  rci_t const nb = A->width;
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic) if((uint64_t)A->nrows * A->ncols >= __M4RI_TRANSPOSE_RECURSIVE_CUTOFF) num_threads(m4ri_get_num_threads())
+#endif
+  for (rci_t bi = 0; bi < nb; ++bi) {
+    word x[64], y[64], xt[64], yt[64];
+
+    _mzd_load_block_64x64(x, A, bi, bi);
+    m4ri_dispatch.transpose_64x64(xt, x, 1, 1);
+    _mzd_store_block_64x64(A, bi, bi, xt);
+
+    for (rci_t bj = bi + 1; bj < nb; ++bj) {
+      _mzd_load_block_64x64(x, A, bi, bj);
+      _mzd_load_block_64x64(y, A, bj, bi);
+      m4ri_dispatch.transpose_64x64(xt, x, 1, 1);
+      m4ri_dispatch.transpose_64x64(yt, y, 1, 1);
+      _mzd_store_block_64x64(A, bi, bj, yt);
+      _mzd_store_block_64x64(A, bj, bi, xt);
+    }
+  }
+
+  __M4RI_DD_MZD(A);
+  return A;
+}
+
 mzd_t *mzd_mul_naive(mzd_t *C, mzd_t const *A, mzd_t const *B) {
   if (C == NULL) {
     C = mzd_init(A->nrows, B->ncols);
@@ -1452,11 +1961,12 @@ mzd_t *_mzd_mul_naive(mzd_t *C, mzd_t const *A, mzd_t const *B, const int clear)
     /* improves performance on x86_64 but is not cross plattform */
     /* asm __volatile__ (".p2align 4\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop"); */
     for (rci_t i = 0; i < C->nrows; ++i) {
+      word *row = mzd_row(C, i);
       wi_t j = 0;
       for (; j < C->width - 1; ++j) {
-  	C->rows[i][j] = 0;
+  	row[j] = 0;
       }
-      C->rows[i][j] &= ~mask_end;
+      row[j] &= ~mask_end;
     }
   }
 
@@ -1471,14 +1981,14 @@ mzd_t *_mzd_mul_naive(mzd_t *C, mzd_t const *A, mzd_t const *B, const int clear)
     parity[i] = 0;
   }
   wi_t const wide = A->width;
-  int const blocksize = __M4RI_MUL_BLOCKSIZE;
+  int const blocksize = m4ri_profile.mul_blocksize;
   for (rci_t start = 0; start + blocksize <= C->nrows; start += blocksize) {
     for (rci_t i = start; i < start + blocksize; ++i) {
-      a = A->rows[i];
-      c = C->rows[i];
+      a = mzd_row(A, i);
+      c = mzd_row(C, i);
       for (rci_t j = 0; j < m4ri_radix * eol; j += m4ri_radix) {
 	for (int k = 0; k < m4ri_radix; ++k) {
-          b = B->rows[j + k];
+          b = mzd_row(B, j + k);
           parity[k] = a[0] & b[0];
           for (wi_t ii = wide - 1; ii >= 1; --ii)
 	    parity[k] ^= a[ii] & b[ii];
@@ -1491,7 +2001,7 @@ mzd_t *_mzd_mul_naive(mzd_t *C, mzd_t const *A, mzd_t const *B, const int clear)
         /* improves performance on x86_64 but is not cross plattform */
 	/* asm __volatile__ (".p2align 4\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop"); */
         for (int k = 0; k < (C->ncols % m4ri_radix); ++k) {
-          b = B->rows[m4ri_radix * eol + k];
+          b = mzd_row(B, m4ri_radix * eol + k);
           parity[k] = a[0] & b[0];
           for (wi_t ii = 1; ii < A->width; ++ii)
             parity[k] ^= a[ii] & b[ii];
@@ -1502,11 +2012,11 @@ mzd_t *_mzd_mul_naive(mzd_t *C, mzd_t const *A, mzd_t const *B, const int clear)
   }
 
   for (rci_t i = C->nrows - (C->nrows % blocksize); i < C->nrows; ++i) {
-    a = A->rows[i];
-    c = C->rows[i];
+    a = mzd_row(A, i);
+    c = mzd_row(C, i);
     for (rci_t j = 0; j < m4ri_radix * eol; j += m4ri_radix) {
       for (int k = 0; k < m4ri_radix; ++k) {
-        b = B->rows[j+k];
+        b = mzd_row(B, j+k);
         parity[k] = a[0] & b[0];
         for (wi_t ii = wide - 1; ii >= 1; --ii)
           parity[k] ^= a[ii] & b[ii];
@@ -1519,7 +2029,7 @@ mzd_t *_mzd_mul_naive(mzd_t *C, mzd_t const *A, mzd_t const *B, const int clear)
       /* improves performance on x86_64 but is not cross plattform */
       /* asm __volatile__ (".p2align 4\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop\n\tnop"); */
       for (int k = 0; k < (C->ncols % m4ri_radix); ++k) {
-        b = B->rows[m4ri_radix * eol + k];
+        b = mzd_row(B, m4ri_radix * eol + k);
         parity[k] = a[0] & b[0];
         for (wi_t ii = 1; ii < A->width; ++ii)
           parity[k] ^= a[ii] & b[ii];
@@ -1552,9 +2062,10 @@ void mzd_randomize(mzd_t *A) {
   wi_t const width = A->width - 1;
   word const mask_end = A->high_bitmask;
   for(rci_t i = 0; i < A->nrows; ++i) {
+    word *row = mzd_row(A, i);
     for(wi_t j = 0; j < width; ++j)
-      A->rows[i][j] = m4ri_random_word();
-    A->rows[i][width] ^= (A->rows[i][width] ^ m4ri_random_word()) & mask_end;
+      row[j] = m4ri_random_word();
+    row[width] ^= (row[width] ^ m4ri_random_word()) & mask_end;
   }
 
   __M4RI_DD_MZD(A);
@@ -1564,7 +2075,7 @@ void mzd_set_ui( mzd_t *A, unsigned int value) {
   word const mask_end = A->high_bitmask;
   
   for (rci_t i = 0; i < A->nrows; ++i) {
-    word *row = A->rows[i];
+    word *row = mzd_row(A, i);
     for(wi_t j = 0; j < A->width - 1; ++j)
       row[j] = 0;
     row[A->width - 1] &= ~mask_end;
@@ -1591,15 +2102,17 @@ int mzd_equal(mzd_t const *A, mzd_t const *B) {
   wi_t Awidth = A->width - 1;
   
   for (rci_t i = 0; i < A->nrows; ++i) {
+    word const *a = mzd_row(A, i);
+    word const *b = mzd_row(B, i);
     for (wi_t j = 0; j < Awidth; ++j) {
-      if (A->rows[i][j] != B->rows[i][j])
+      if (a[j] != b[j])
         return FALSE;
     }
   }
 
   word const mask_end = A->high_bitmask;
   for (rci_t i = 0; i < A->nrows; ++i) {
-    if (((A->rows[i][Awidth] ^ B->rows[i][Awidth]) & mask_end))
+    if (((mzd_row(A, i)[Awidth] ^ mzd_row(B, i)[Awidth]) & mask_end))
       return FALSE;
   }
   return TRUE;
@@ -1618,15 +2131,17 @@ int mzd_cmp(mzd_t const *A, mzd_t const *B) {
      are more important than with large index. */
 
   for(rci_t i=0; i<A->nrows; i++) {
-    if ((A->rows[i][n]&mask_end) < (B->rows[i][n]&mask_end))
+    word const *a = mzd_row(A, i);
+    word const *b = mzd_row(B, i);
+    if ((a[n]&mask_end) < (b[n]&mask_end))
       return -1;
-    else if ((A->rows[i][n]&mask_end) > (B->rows[i][n]&mask_end))
+    else if ((a[n]&mask_end) > (b[n]&mask_end))
       return 1;
 
     for(wi_t j=n-1; j>=0; j--) {
-      if (A->rows[i][j] < B->rows[i][j])
+      if (a[j] < b[j])
         return -1;
-      else if (A->rows[i][j] > B->rows[i][j])
+      else if (a[j] > b[j])
         return 1;
     }
   }
@@ -1638,7 +2153,7 @@ mzd_t *mzd_copy(mzd_t *N, mzd_t const *P) {
     return N;
 
   if (N == NULL) {
-    N = mzd_init(P->nrows, P->ncols);
+    N = mzd_init_uninitialized(P->nrows, P->ncols);
   } else {
     if (N->nrows < P->nrows || N->ncols < P->ncols)
       m4ri_die("mzd_copy: Target matrix is too small.");
@@ -1647,8 +2162,8 @@ mzd_t *mzd_copy(mzd_t *N, mzd_t const *P) {
   wi_t const wide = P->width - 1;
   word mask_end = P->high_bitmask;
   for (rci_t i = 0; i < P->nrows; ++i) {
-    p_truerow = P->rows[i];
-    n_truerow = N->rows[i];
+    p_truerow = mzd_row(P, i);
+    n_truerow = mzd_row(N, i);
     for (wi_t j = 0; j < wide; ++j)
       n_truerow[j] = p_truerow[j];
     n_truerow[wide] = (n_truerow[wide] & ~mask_end) | (p_truerow[wide] & mask_end);
@@ -1670,8 +2185,8 @@ mzd_t *mzd_concat(mzd_t *C, mzd_t const *A, mzd_t const *B) {
   }
 
   for (rci_t i = 0; i < A->nrows; ++i) {
-    word *dst_truerow = C->rows[i];
-    word *src_truerow = A->rows[i];
+    word *dst_truerow = mzd_row(C, i);
+    word *src_truerow = mzd_row(A, i);
     for (wi_t j = 0; j < A->width; ++j) {
       dst_truerow[j] = src_truerow[j];
     }
@@ -1699,16 +2214,16 @@ mzd_t *mzd_stack(mzd_t *C, mzd_t const *A, mzd_t const *B) {
   }
   
   for(rci_t i = 0; i < A->nrows; ++i) {
-    word *src_truerow = A->rows[i];
-    word *dst_truerow = C->rows[i];
+    word *src_truerow = mzd_row(A, i);
+    word *dst_truerow = mzd_row(C, i);
     for (wi_t j = 0; j < A->width; ++j) {
       dst_truerow[j] = src_truerow[j]; 
     }
   }
 
   for(rci_t i = 0; i < B->nrows; ++i) {
-    word *dst_truerow = C->rows[A->nrows + i];
-    word *src_truerow = B->rows[i];
+    word *dst_truerow = mzd_row(C, A->nrows + i);
+    word *src_truerow = mzd_row(B, i);
     for (wi_t j = 0; j < B->width; ++j) {
       dst_truerow[j] = src_truerow[j]; 
     }
@@ -1768,70 +2283,94 @@ mzd_t *_mzd_add(mzd_t *C, mzd_t const *A, mzd_t const *B) {
     return C;
   case 1:
     for(rci_t i = 0; i < nrows; ++i) {
-      C->rows[i][0] ^= ((A->rows[i][0] ^ B->rows[i][0] ^ C->rows[i][0]) & mask_end);
+      word *c = mzd_row(C, i);
+      word const *a = mzd_row(A, i);
+      word const *b = mzd_row(B, i);
+      c[0] ^= ((a[0] ^ b[0] ^ c[0]) & mask_end);
     }
     break;
   case 2:
     for(rci_t i = 0; i < nrows; ++i) {
-      C->rows[i][0] = A->rows[i][0] ^ B->rows[i][0];
-      C->rows[i][1] ^= ((A->rows[i][1] ^ B->rows[i][1] ^ C->rows[i][1]) & mask_end);
+      word *c = mzd_row(C, i);
+      word const *a = mzd_row(A, i);
+      word const *b = mzd_row(B, i);
+      c[0] = a[0] ^ b[0];
+      c[1] ^= ((a[1] ^ b[1] ^ c[1]) & mask_end);
     }
     break;
   case 3:
     for(rci_t i = 0; i < nrows; ++i) {
-      C->rows[i][0] = A->rows[i][0] ^ B->rows[i][0];
-      C->rows[i][1] = A->rows[i][1] ^ B->rows[i][1];
-      C->rows[i][2] ^= ((A->rows[i][2] ^ B->rows[i][2] ^ C->rows[i][2]) & mask_end);
+      word *c = mzd_row(C, i);
+      word const *a = mzd_row(A, i);
+      word const *b = mzd_row(B, i);
+      c[0] = a[0] ^ b[0];
+      c[1] = a[1] ^ b[1];
+      c[2] ^= ((a[2] ^ b[2] ^ c[2]) & mask_end);
     }
     break;
   case 4:
     for(rci_t i = 0; i < nrows; ++i) {
-      C->rows[i][0] = A->rows[i][0] ^ B->rows[i][0];
-      C->rows[i][1] = A->rows[i][1] ^ B->rows[i][1];
-      C->rows[i][2] = A->rows[i][2] ^ B->rows[i][2];
-      C->rows[i][3] ^= ((A->rows[i][3] ^ B->rows[i][3] ^ C->rows[i][3]) & mask_end);
+      word *c = mzd_row(C, i);
+      word const *a = mzd_row(A, i);
+      word const *b = mzd_row(B, i);
+      c[0] = a[0] ^ b[0];
+      c[1] = a[1] ^ b[1];
+      c[2] = a[2] ^ b[2];
+      c[3] ^= ((a[3] ^ b[3] ^ c[3]) & mask_end);
     }
     break;
   case 5:
     for(rci_t i = 0; i < nrows; ++i) {
-      C->rows[i][0] = A->rows[i][0] ^ B->rows[i][0];
-      C->rows[i][1] = A->rows[i][1] ^ B->rows[i][1];
-      C->rows[i][2] = A->rows[i][2] ^ B->rows[i][2];
-      C->rows[i][3] = A->rows[i][3] ^ B->rows[i][3];
-      C->rows[i][4] ^= ((A->rows[i][4] ^ B->rows[i][4] ^ C->rows[i][4]) & mask_end);
+      word *c = mzd_row(C, i);
+      word const *a = mzd_row(A, i);
+      word const *b = mzd_row(B, i);
+      c[0] = a[0] ^ b[0];
+      c[1] = a[1] ^ b[1];
+      c[2] = a[2] ^ b[2];
+      c[3] = a[3] ^ b[3];
+      c[4] ^= ((a[4] ^ b[4] ^ c[4]) & mask_end);
     }
     break;
   case 6:
     for(rci_t i = 0; i < nrows; ++i) {
-      C->rows[i][0] = A->rows[i][0] ^ B->rows[i][0];
-      C->rows[i][1] = A->rows[i][1] ^ B->rows[i][1];
-      C->rows[i][2] = A->rows[i][2] ^ B->rows[i][2];
-      C->rows[i][3] = A->rows[i][3] ^ B->rows[i][3];
-      C->rows[i][4] = A->rows[i][4] ^ B->rows[i][4];
-      C->rows[i][5] ^= ((A->rows[i][5] ^ B->rows[i][5] ^ C->rows[i][5]) & mask_end);
+      word *c = mzd_row(C, i);
+      word const *a = mzd_row(A, i);
+      word const *b = mzd_row(B, i);
+      c[0] = a[0] ^ b[0];
+      c[1] = a[1] ^ b[1];
+      c[2] = a[2] ^ b[2];
+      c[3] = a[3] ^ b[3];
+      c[4] = a[4] ^ b[4];
+      c[5] ^= ((a[5] ^ b[5] ^ c[5]) & mask_end);
     }
     break;
   case 7:
     for(rci_t i = 0; i < nrows; ++i) {
-      C->rows[i][0] = A->rows[i][0] ^ B->rows[i][0];
-      C->rows[i][1] = A->rows[i][1] ^ B->rows[i][1];
-      C->rows[i][2] = A->rows[i][2] ^ B->rows[i][2];
-      C->rows[i][3] = A->rows[i][3] ^ B->rows[i][3];
-      C->rows[i][4] = A->rows[i][4] ^ B->rows[i][4];
-      C->rows[i][5] = A->rows[i][5] ^ B->rows[i][5];
-      C->rows[i][6] ^= ((A->rows[i][6] ^ B->rows[i][6] ^ C->rows[i][6]) & mask_end);
+      word *c = mzd_row(C, i);
+      word const *a = mzd_row(A, i);
+      word const *b = mzd_row(B, i);
+      c[0] = a[0] ^ b[0];
+      c[1] = a[1] ^ b[1];
+      c[2] = a[2] ^ b[2];
+      c[3] = a[3] ^ b[3];
+      c[4] = a[4] ^ b[4];
+      c[5] = a[5] ^ b[5];
+      c[6] ^= ((a[6] ^ b[6] ^ c[6]) & mask_end);
     }
     break;
   case 8:
     for(rci_t i = 0; i < nrows; ++i) {
-      C->rows[i][0] = A->rows[i][0] ^ B->rows[i][0];
-      C->rows[i][1] = A->rows[i][1] ^ B->rows[i][1];
-      C->rows[i][2] = A->rows[i][2] ^ B->rows[i][2];
-      C->rows[i][3] = A->rows[i][3] ^ B->rows[i][3];
-      C->rows[i][4] = A->rows[i][4] ^ B->rows[i][4];
-      C->rows[i][5] = A->rows[i][5] ^ B->rows[i][5];
-      C->rows[i][6] = A->rows[i][6] ^ B->rows[i][6];
-      C->rows[i][7] ^= ((A->rows[i][7] ^ B->rows[i][7] ^ C->rows[i][7]) & mask_end);
+      word *c = mzd_row(C, i);
+      word const *a = mzd_row(A, i);
+      word const *b = mzd_row(B, i);
+      c[0] = a[0] ^ b[0];
+      c[1] = a[1] ^ b[1];
+      c[2] = a[2] ^ b[2];
+      c[3] = a[3] ^ b[3];
+      c[4] = a[4] ^ b[4];
+      c[5] = a[5] ^ b[5];
+      c[6] = a[6] ^ b[6];
+      c[7] ^= ((a[7] ^ b[7] ^ c[7]) & mask_end);
     }
     break;
 
@@ -1861,24 +2400,25 @@ mzd_t *mzd_submatrix(mzd_t *S, mzd_t const *M, rci_t const startrow, rci_t const
     /* we start at the beginning of a word */
     if(ncols / m4ri_radix != 0) {
       for(rci_t x = startrow, i = 0; i < nrows; ++i, ++x) {
-        memcpy(S->rows[i], M->rows[x] + startword, sizeof(word) * (ncols / m4ri_radix));
+        memcpy(mzd_row(S, i), mzd_row(M, x) + startword, sizeof(word) * (ncols / m4ri_radix));
       }
     }
     if (ncols % m4ri_radix) {
       word const mask_end = __M4RI_LEFT_BITMASK(ncols % m4ri_radix);
       for(rci_t x = startrow, i = 0; i < nrows; ++i, ++x) {
         /* process remaining bits */
-        word temp = M->rows[x][startword + ncols / m4ri_radix] & mask_end;
-        S->rows[i][ncols / m4ri_radix] = temp;
+        word temp = mzd_row(M, x)[startword + ncols / m4ri_radix] & mask_end;
+        mzd_row(S, i)[ncols / m4ri_radix] = temp;
       } 
     }
   } else {
     wi_t j;
     for(rci_t i=0; i<nrows; i++) {
+      word *row = mzd_row(S, i);
       for(j=0; j+m4ri_radix<=ncols; j+=m4ri_radix)
-        S->rows[i][j/m4ri_radix] = mzd_read_bits(M, startrow+i, startcol+j, m4ri_radix);
-      S->rows[i][j/m4ri_radix] &= ~S->high_bitmask;
-      S->rows[i][j/m4ri_radix] |= mzd_read_bits(M, startrow+i, startcol+j, ncols - j) & S->high_bitmask;
+        row[j/m4ri_radix] = mzd_read_bits(M, startrow+i, startcol+j, m4ri_radix);
+      row[j/m4ri_radix] &= ~S->high_bitmask;
+      row[j/m4ri_radix] |= mzd_read_bits(M, startrow+i, startcol+j, ncols - j) & S->high_bitmask;
     }
   }
   __M4RI_DD_MZD(S);
@@ -1983,9 +2523,10 @@ int mzd_is_zero(mzd_t const *A) {
   word status = 0;
   word mask_end = A->high_bitmask;
   for (rci_t i = 0; i < A->nrows; ++i) {
+    word const *row = mzd_row(A, i);
     for (wi_t j = 0; j < A->width - 1; ++j)
-      status |= A->rows[i][j];
-    status |= A->rows[i][A->width - 1] & mask_end;
+      status |= row[j];
+    status |= row[A->width - 1] & mask_end;
     if(status)
       return 0;
   }
@@ -1996,8 +2537,8 @@ void mzd_copy_row(mzd_t *B, rci_t i, mzd_t const *A, rci_t j) {
   assert(B->ncols >= A->ncols);
   wi_t const width = MIN(B->width, A->width) - 1;
 
-  word const *a = A->rows[j];
-  word *b = B->rows[i];
+  word const *a = mzd_row(A, j);
+  word *b = mzd_row(B, i);
  
   word const mask_end = __M4RI_LEFT_BITMASK(A->ncols % m4ri_radix);
 
@@ -2050,7 +2591,7 @@ int mzd_find_pivot(mzd_t const *A, rci_t start_row, rci_t start_col, rci_t *r, r
     wi_t const word_offset = start_col / m4ri_radix;
     word const mask_begin = __M4RI_RIGHT_BITMASK(m4ri_radix-bit_offset);
     for(rci_t i = start_row; i < nrows; ++i) {
-      word const curr_data = A->rows[i][word_offset] & mask_begin;
+      word const curr_data = mzd_row(A, i)[word_offset] & mask_begin;
       if (m4ri_lesser_LSB(curr_data, data)) {
         row_candidate = i;
         data = curr_data;
@@ -2077,7 +2618,7 @@ int mzd_find_pivot(mzd_t const *A, rci_t start_row, rci_t start_col, rci_t *r, r
     /* handle complete words */
     for(wi_t wi = word_offset + 1; wi < A->width - 1; ++wi) {
       for(rci_t i = start_row; i < nrows; ++i) {
-        word const curr_data = A->rows[i][wi];
+        word const curr_data = mzd_row(A, i)[wi];
         if (m4ri_lesser_LSB(curr_data, data)) {
           row_candidate = i;
           data = curr_data;
@@ -2104,7 +2645,7 @@ int mzd_find_pivot(mzd_t const *A, rci_t start_row, rci_t start_col, rci_t *r, r
     word const mask_end = __M4RI_LEFT_BITMASK(end_offset % m4ri_radix);
     wi_t wi = A->width - 1;
     for(rci_t i = start_row; i < nrows; ++i) {
-      word const curr_data = A->rows[i][wi] & mask_end;
+      word const curr_data = mzd_row(A, i)[wi] & mask_end;
       if (m4ri_lesser_LSB(curr_data, data)) {
         row_candidate = i;
         data = curr_data;
@@ -2166,15 +2707,23 @@ double _mzd_density(mzd_t const *A, wi_t res, rci_t r, rci_t c) {
     res = 1;
 
   for(rci_t i = r; i < A->nrows; ++i) {
-    word *truerow = A->rows[i];
+    word *truerow = mzd_row(A, i);
     for(rci_t j = c; j < m4ri_radix; ++j)
       if(mzd_read_bit(A, i, j))
         ++count;
     total += m4ri_radix;
 
-    for(wi_t j = MAX(1, c / m4ri_radix); j < A->width - 1; j += res) {
-      count += m4ri_bitcount(truerow[j]);
-      total += m4ri_radix;
+    if (res == 1) {
+      wi_t const j = MAX(1, c / m4ri_radix);
+      if (j < A->width - 1) {
+        count += m4ri_dispatch.popcount(truerow + j, A->width - 1 - j);
+        total += m4ri_radix * (A->width - 1 - j);
+      }
+    } else {
+      for(wi_t j = MAX(1, c / m4ri_radix); j < A->width - 1; j += res) {
+        count += m4ri_bitcount(truerow[j]);
+        total += m4ri_radix;
+      }
     }
     for(int j = 0; j < A->ncols % m4ri_radix; ++j)
       if(mzd_read_bit(A, i, m4ri_radix * (A->ncols / m4ri_radix) + j))
@@ -2195,7 +2744,7 @@ rci_t mzd_first_zero_row(mzd_t const *A) {
   word *row;
 
   for(rci_t i = A->nrows - 1; i >= 0; --i) {
-    row = A->rows[i];
+    row = mzd_row(A, i);
     word tmp = row[0];
     for (wi_t j = 1; j < end; ++j)
       tmp |= row[j];
@@ -2216,8 +2765,9 @@ mzd_t *mzd_extract_u(mzd_t *U, mzd_t const *A) {
   else
     assert(U->nrows == k && U->ncols == k);
   for(rci_t i=1; i<U->nrows; i++) {
+    word *row = mzd_row(U, i);
     for(wi_t j=0; j<i/m4ri_radix; j++) {
-      U->rows[i][j] = 0;
+      row[j] = 0;
     }
     if(i%m4ri_radix)
       mzd_clear_bits(U, i, (i/m4ri_radix)*m4ri_radix, i%m4ri_radix);
@@ -2234,8 +2784,9 @@ mzd_t *mzd_extract_l(mzd_t *L, mzd_t const *A) {
   for(rci_t i=0; i<L->nrows-1; i++) {
     if(m4ri_radix - (i+1)%m4ri_radix)
       mzd_clear_bits(L, i, i+1, m4ri_radix - (i+1)%m4ri_radix);
+    word *row = mzd_row(L, i);
     for(wi_t j=(i/m4ri_radix+1); j<L->width; j++) {
-      L->rows[i][j] = 0;
+      row[j] = 0;
     }
   }
   return L;
@@ -67,6 +67,28 @@
 
 #define __M4RI_MUL_BLOCKSIZE MIN(((int)sqrt((double)(4 * __M4RI_CPU_L3_CACHE))) / 2, 2048)
 
+/**
+ * \brief Minimal number of bits for which mzd_transpose() recurses.
+ *
+ * Smaller matrices are transposed row of blocks by row of blocks.
+ */
+
+#ifndef __M4RI_TRANSPOSE_RECURSIVE_CUTOFF
+#define __M4RI_TRANSPOSE_RECURSIVE_CUTOFF (((uint64_t)1) << 22)
+#endif
+
+/**
+ * \brief Number of 64 x 64 blocks the parallel transpose handles as one task.
+ *
+ * The block range is halved recursively along its longer side until
+ * it is at most this size. A range of 64 blocks, i.e. 512 x 512 bits,
+ * reads and writes 64KB.
+ */
+
+#ifndef __M4RI_TRANSPOSE_LEAF_BLOCKS
+#define __M4RI_TRANSPOSE_LEAF_BLOCKS 64
+#endif
+
 typedef struct {
   size_t size;
   word* begin;
@@ -97,7 +119,7 @@ typedef struct mzd_t {
   /**
    * Offset in words from start of block to first word.
    *
-   * rows[0] = blocks[0].begin + offset_vector;
+   * mzd_row(M, 0) = blocks[0].begin + offset_vector;
    * This, together with rowstride, makes the rows array obsolete.
    */
 
@@ -115,6 +137,8 @@ typedef struct mzd_t {
    * 3: Is windowed, but has zero excess.
    * 4: Is windowed, but owns the blocks allocations.
    * 5: Spans more than 1 block.
+   * 6: Blocks were mapped according to an allocation policy, see mzd_alloc_policy_t.
+   * 7: Blocks point into a file mapped by mzd_init_mmap().
    */
 
   uint8_t flags;
@@ -128,7 +152,7 @@ typedef struct mzd_t {
 
   word high_bitmask;    /*!< Mask for valid bits in the word with the highest index (width - 1). */
   mzd_block_t *blocks;  /*!< Pointers to the actual blocks of memory containing the values packed into words. */
-  word   **rows;        /*!< Address of first word in each row, so the first word of row i is is m->rows[i] */
+  word   **rows;        /*!< NULL until mzd_rows() is called, then the address of the first word of each row */
   uint64_t dummy;       /*!< ensures sizeof(mzd_t) == 64 */
 
 } mzd_t;
@@ -143,6 +167,33 @@ static uint8_t const mzd_flag_windowed_zerooffset = 0x4;
 static uint8_t const mzd_flag_windowed_zeroexcess = 0x8;
 static uint8_t const mzd_flag_windowed_ownsblocks = 0x10;
 static uint8_t const mzd_flag_multiple_blocks = 0x20;
+static uint8_t const mzd_flag_mapped_blocks = 0x40;
+static uint8_t const mzd_flag_file_backed = 0x80;
+
+/**
+ * \brief Size of a (transparent) huge page in bytes.
+ *
+ * Allocation policies are only applied to matrices of at least this
+ * size, smaller matrices always come from the memory manager.
+ */
+
+#define __M4RI_HUGEPAGE_SIZE (((size_t)1) << 21)
+
+/**
+ * \brief Placement policies for the blocks of large matrices.
+ *
+ * Policies may be or-ed together. Any policy other than
+ * mzd_alloc_default maps the blocks directly from the operating
+ * system instead of taking them from the memory manager (mmc.h). On
+ * systems where a policy is not supported it is silently ignored.
+ */
+
+typedef enum {
+  mzd_alloc_default         = 0, /*!< take blocks from the memory manager */
+  mzd_alloc_hugepages       = 1, /*!< align blocks to 2 MB and request transparent huge pages */
+  mzd_alloc_numa_firsttouch = 2, /*!< zero blocks in parallel with the row distribution used by the OpenMP kernels */
+  mzd_alloc_numa_interleave = 4, /*!< interleave the pages of blocks over all allowed NUMA nodes */
+} mzd_alloc_policy_t;
 
 /**
  * \brief Test if a matrix is windowed.
@@ -175,9 +226,7 @@ static inline int mzd_owns_blocks(mzd_t const *M) {
  */
 
 static inline word* mzd_first_row(mzd_t const *M) {
-  word* result = M->blocks[0].begin + M->offset_vector;
-  assert(M->nrows == 0 || result == M->rows[0]);
-  return result;
+  return M->blocks[0].begin + M->offset_vector;
 }
 
 /**
@@ -263,6 +312,9 @@ static inline wi_t mzd_remaining_rows_in_block(mzd_t const* M, rci_t r) {
 /**
  * \brief Get pointer to first word of row.
  *
+ * The address is computed from rowstride and offset_vector, this is
+ * how rows are accessed throughout the library.
+ *
  * \param M Matrix
  * \param row The row index.
  *
@@ -270,16 +322,31 @@ static inline wi_t mzd_remaining_rows_in_block(mzd_t const* M, rci_t r) {
  */
 
 static inline word* mzd_row(mzd_t const* M, rci_t row) {
-  wi_t big_vector = M->offset_vector + row * M->rowstride;
+  size_t big_vector = M->offset_vector + (size_t)row * M->rowstride;
   word* result = M->blocks[0].begin + big_vector;
   if (__M4RI_UNLIKELY(M->flags & mzd_flag_multiple_blocks)) {
     int const n = (M->row_offset + row) >> M->blockrows_log;
     result = M->blocks[n].begin + big_vector - n * (M->blocks[0].size / sizeof(word));
   }
-  assert(result == M->rows[row]);
   return result;
 }
 
+/**
+ * \brief Return an array holding the address of the first word of each row.
+ *
+ * The array is built on the first call and cached in M->rows until
+ * M is freed. Matrices do not carry this array by default, prefer
+ * mzd_row() which costs no memory. This function may be called from
+ * several threads at once, but it takes a lock, so keep the result
+ * instead of calling it for every row.
+ *
+ * \param M Matrix
+ *
+ * \return M->rows, NULL if M has no rows.
+ */
+
+word **mzd_rows(mzd_t *M);
+
 /**
  * \brief Create a new matrix of dimension r x c.
  *
@@ -292,6 +359,149 @@ static inline word* mzd_row(mzd_t const* M, rci_t row) {
 
 mzd_t *mzd_init(rci_t const r, rci_t const c);
 
+/**
+ * \brief Create a new matrix of dimension r x c with an explicit allocation policy.
+ *
+ * Use mzd_free to kill it.
+ *
+ * \param r Number of rows
+ * \param c Number of columns
+ * \param policy Bitwise or of mzd_alloc_policy_t values.
+ *
+ * \sa mzd_set_alloc_policy()
+ */
+
+mzd_t *mzd_init_policy(rci_t const r, rci_t const c, int policy);
+
+/**
+ * \brief Create a new matrix of dimension r x c without clearing it.
+ *
+ * The valid bits of the matrix are undefined and must be written by
+ * the caller, only the excess bits of the last word of each row and
+ * the padding words are zero. This saves a pass over memory for
+ * results which are overwritten anyway.
+ *
+ * Use mzd_free to kill it.
+ *
+ * \param r Number of rows
+ * \param c Number of columns
+ */
+
+mzd_t *mzd_init_uninitialized(rci_t const r, rci_t const c);
+
+/**
+ * \brief Set the allocation policy used by mzd_init().
+ *
+ * The policy is a process-wide setting which mzd_init() reads without
+ * synchronisation. Set it before starting threads which allocate
+ * matrices, and use mzd_init_policy() for a policy per allocation.
+ *
+ * \param policy Bitwise or of mzd_alloc_policy_t values.
+ */
+
+void mzd_set_alloc_policy(int policy);
+
+/**
+ * \brief Return the allocation policy used by mzd_init().
+ */
+
+int mzd_get_alloc_policy(void);
+
+/**
+ * \brief Magic string at the start of m4ri matrix files.
+ */
+
+#define __M4RI_MZD_FILE_MAGIC "M4RIMZD"
+
+/**
+ * \brief Version of the matrix file format written by this library.
+ */
+
+#define __M4RI_MZD_FILE_VERSION 1
+
+/**
+ * \brief Header of m4ri matrix files.
+ *
+ * The header is followed by nrows rows of rowstride words each, in
+ * the byte order of the machine which wrote the file. The rowstride
+ * is the one mzd_init() uses for ncols columns, such that the rows can
+ * be mapped in place.
+ */
+
+typedef struct {
+  char     magic[8];  /*!< __M4RI_MZD_FILE_MAGIC */
+  uint32_t version;   /*!< __M4RI_MZD_FILE_VERSION */
+  uint32_t flags;     /*!< see mzd_file_flag_checksum */
+  uint64_t byteorder; /*!< 0x0102030405060708 as written by the creator */
+  uint64_t nrows;     /*!< number of rows */
+  uint64_t ncols;     /*!< number of columns */
+  uint64_t rowstride; /*!< words per row */
+  uint64_t checksum;  /*!< checksum of the valid bits if mzd_file_flag_checksum is set */
+  uint64_t reserved;  /*!< zero */
+} mzd_file_header_t;
+
+static uint32_t const mzd_file_flag_checksum = 0x1;
+
+/**
+ * \brief Modes for mzd_init_mmap().
+ */
+
+typedef enum {
+  mzd_mmap_create    = 0, /*!< create or truncate the file, the matrix is zero */
+  mzd_mmap_readwrite = 1, /*!< map an existing file, changes are written back to it */
+  mzd_mmap_private   = 2, /*!< map an existing file, changes are private to this process */
+} mzd_mmap_mode_t;
+
+/**
+ * \brief Create a matrix whose rows live in a memory mapped file.
+ *
+ * The file holds a mzd_file_header_t followed by the rows, so it can be
+ * larger than main memory and is persistent without copying. When an
+ * existing file is opened its header defines the dimensions; r and c
+ * must either match them or both be zero.
+ *
+ * Use mzd_free to unmap it.
+ *
+ * \param path File name
+ * \param r Number of rows
+ * \param c Number of columns
+ * \param mode One of mzd_mmap_mode_t.
+ *
+ * \sa mzd_mmap_sync()
+ */
+
+mzd_t *mzd_init_mmap(char const *path, rci_t r, rci_t c, int mode);
+
+/**
+ * \brief Write the rows of a matrix created by mzd_init_mmap() back to its file.
+ *
+ * Blocks until the data is on disk. Does nothing for other matrices.
+ *
+ * \param A Matrix
+ */
+
+void mzd_mmap_sync(mzd_t const *A);
+
+/**
+ * \brief Fill in a file header for a r x c matrix.
+ *
+ * \param header Header to fill
+ * \param r Number of rows
+ * \param c Number of columns
+ */
+
+void mzd_file_header_init(mzd_file_header_t *header, rci_t r, rci_t c);
+
+/**
+ * \brief Check magic, version, byte order and layout of a file header.
+ *
+ * \param header Header read from a file
+ *
+ * \return zero if the header is valid for this library.
+ */
+
+int mzd_file_header_check(mzd_file_header_t const *header);
+
 /**
  * \brief Free a matrix created with mzd_init.
  * 
@@ -357,8 +567,8 @@ static inline void _mzd_row_swap(mzd_t *M, rci_t const rowa, rci_t const rowb, w
     return;
 
   wi_t width = M->width - startblock - 1;
-  word *a = M->rows[rowa] + startblock;
-  word *b = M->rows[rowb] + startblock;
+  word *a = mzd_row(M, rowa) + startblock;
+  word *b = mzd_row(M, rowb) + startblock;
   word tmp; 
   word const mask_end = M->high_bitmask;
 
@@ -535,7 +745,7 @@ static inline void mzd_col_swap_in_rows(mzd_t *M, rci_t const cola, rci_t const
  */
 
 static inline BIT mzd_read_bit(mzd_t const *M, rci_t const row, rci_t const col ) {
-  return __M4RI_GET_BIT(M->rows[row][col/m4ri_radix], col%m4ri_radix);
+  return __M4RI_GET_BIT(mzd_row(M, row)[col/m4ri_radix], col%m4ri_radix);
 }
 
 /**
@@ -551,7 +761,7 @@ static inline BIT mzd_read_bit(mzd_t const *M, rci_t const row, rci_t const col
  */
 
 static inline void mzd_write_bit(mzd_t *M, rci_t const row, rci_t const col, BIT const value) {
-  __M4RI_WRITE_BIT(M->rows[row][col/m4ri_radix], col%m4ri_radix, value);
+  __M4RI_WRITE_BIT(mzd_row(M, row)[col/m4ri_radix], col%m4ri_radix, value);
 }
 
 
@@ -568,10 +778,11 @@ static inline void mzd_write_bit(mzd_t *M, rci_t const row, rci_t const col, BIT
 static inline void mzd_xor_bits(mzd_t const *M, rci_t const x, rci_t const y, int const n, word values) {
   int const spot   = y % m4ri_radix;
   wi_t const block = y / m4ri_radix;
-  M->rows[x][block] ^= values << spot;
+  word *row = mzd_row(M, x);
+  row[block] ^= values << spot;
   int const space = m4ri_radix - spot;
   if (n > space)
-    M->rows[x][block + 1] ^= values >> space;
+    row[block + 1] ^= values >> space;
 }
 
 /**
@@ -590,10 +801,11 @@ static inline void mzd_and_bits(mzd_t const *M, rci_t const x, rci_t const y, in
 
   int const spot   = y % m4ri_radix;
   wi_t const block = y / m4ri_radix;
-  M->rows[x][block] &= values << spot;
+  word *row = mzd_row(M, x);
+  row[block] &= values << spot;
   int const space = m4ri_radix - spot;
   if (n > space)
-    M->rows[x][block + 1] &= values >> space;
+    row[block + 1] &= values >> space;
 }
 
 /**
@@ -610,10 +822,11 @@ static inline void mzd_clear_bits(mzd_t const *M, rci_t const x, rci_t const y,
   word values = m4ri_ffff >> (m4ri_radix - n);
   int const spot   = y % m4ri_radix;
   wi_t const block = y / m4ri_radix;
-  M->rows[x][block] &= ~(values << spot);
+  word *row = mzd_row(M, x);
+  row[block] &= ~(values << spot);
   int const space = m4ri_radix - spot;
   if (n > space)
-    M->rows[x][block + 1] &= ~(values >> space);
+    row[block + 1] &= ~(values >> space);
 }
 
 /**
@@ -632,8 +845,8 @@ static inline void mzd_row_add_offset(mzd_t *M, rci_t dstrow, rci_t srcrow, rci_
   assert(dstrow < M->nrows && srcrow < M->nrows && coloffset < M->ncols);
   wi_t const startblock= coloffset/m4ri_radix;
   wi_t wide = M->width - startblock;
-  word *src = M->rows[srcrow] + startblock;
-  word *dst = M->rows[dstrow] + startblock;
+  word *src = mzd_row(M, srcrow) + startblock;
+  word *dst = mzd_row(M, dstrow) + startblock;
   word const mask_begin = __M4RI_RIGHT_BITMASK(m4ri_radix - coloffset % m4ri_radix);
   word const mask_end   = M->high_bitmask;
 
@@ -669,7 +882,7 @@ static inline void mzd_row_add_offset(mzd_t *M, rci_t dstrow, rci_t srcrow, rci_
   /* 
    * Revert possibly non-zero excess bits.
    * Note that i == wide here, and wide can be 0.
-   * But really, src[wide - 1] is M->rows[srcrow][M->width - 1] ;)
+   * But really, src[wide - 1] is mzd_row(M, srcrow)[M->width - 1] ;)
    * We use i - 1 here to let the compiler know these are the same addresses
    * that we last accessed, in the previous loop.
    */
@@ -701,12 +914,30 @@ void mzd_row_add(mzd_t *M, rci_t const sourcerow, rci_t const destrow);
  \endverbatim 
  * and thus rearranges the blocks recursively. 
  *
+ * Matrices of at least __M4RI_TRANSPOSE_RECURSIVE_CUTOFF bits are
+ * split recursively into cache sized ranges of 64 x 64 blocks, which
+ * are distributed over threads with OpenMP.
+ *
  * \param DST Preallocated return matrix, may be NULL for automatic creation.
  * \param A Matrix
  */
 
 mzd_t *mzd_transpose(mzd_t *DST, mzd_t const *A);
 
+/**
+ * \brief Transpose a square matrix in place.
+ *
+ * The 64 x 64 blocks above the diagonal are swapped with their mirror
+ * images below the diagonal while being transposed, thus no second
+ * matrix is allocated.
+ *
+ * \param A Square matrix, may be a window.
+ *
+ * \return A
+ */
+
+mzd_t *mzd_transpose_inplace(mzd_t *A);
+
 /**
  * \brief Naive cubic matrix multiplication.
  *
@@ -996,7 +1227,8 @@ static inline word mzd_read_bits(mzd_t const *M, rci_t const x, rci_t const y, i
   int const spot   = y % m4ri_radix;
   wi_t const block = y / m4ri_radix;
   int const spill = spot + n - m4ri_radix;
-  word temp = (spill <= 0) ? M->rows[x][block] << -spill : (M->rows[x][block + 1] << (m4ri_radix - spill)) | (M->rows[x][block] >> spill);
+  word const *row = mzd_row(M, x);
+  word temp = (spill <= 0) ? row[block] << -spill : (row[block + 1] << (m4ri_radix - spill)) | (row[block] >> spill);
   return temp >> (m4ri_radix - n);
 }
 
@@ -1022,8 +1254,8 @@ static inline void mzd_combine_even_in_place(mzd_t *A,       rci_t const a_row,
 
   wi_t wide = A->width - a_startblock - 1;
 
-  word *a = A->rows[a_row] + a_startblock;
-  word *b = B->rows[b_row] + b_startblock;
+  word *a = mzd_row(A, a_row) + a_startblock;
+  word *b = mzd_row(B, b_row) + b_startblock;
   
 #if __M4RI_HAVE_SSE2
   if(wide > 2) {
@@ -1096,9 +1328,9 @@ static inline void mzd_combine_even(mzd_t *C,       rci_t const c_row, wi_t cons
                                     mzd_t const *B, rci_t const b_row, wi_t const b_startblock) {
 
   wi_t wide = A->width - a_startblock - 1;
-  word *a = A->rows[a_row] + a_startblock;
-  word *b = B->rows[b_row] + b_startblock;
-  word *c = C->rows[c_row] + c_startblock;
+  word *a = mzd_row(A, a_row) + a_startblock;
+  word *b = mzd_row(B, b_row) + b_startblock;
+  word *c = mzd_row(C, c_row) + c_startblock;
   
 #if __M4RI_HAVE_SSE2
   if(wide > 2) {
@@ -1278,7 +1510,7 @@ rci_t mzd_first_zero_row(mzd_t const *A);
 static inline word mzd_hash(mzd_t const *A) {
   word hash = 0;
   for (rci_t r = 0; r < A->nrows; ++r)
-    hash ^= rotate_word(calculate_hash(A->rows[r], A->width), r % m4ri_radix);
+    hash ^= rotate_word(calculate_hash(mzd_row(A, r), A->width), r % m4ri_radix);
   return hash;
 }
 
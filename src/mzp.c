@@ -24,6 +24,10 @@
 #include "mzp.h"
 #include "mzd.h"
 
+#if __M4RI_HAVE_OPENMP
+#include <omp.h>
+#endif
+
 mzp_t *mzp_init(rci_t length) {
   mzp_t *P = (mzp_t*)m4ri_mm_malloc(sizeof(mzp_t));
   P->values = (rci_t*)m4ri_mm_malloc(sizeof(rci_t) * length);
@@ -66,9 +70,74 @@ void mzp_set_ui(mzp_t *P, unsigned int value) {
   }
 }
 
+/*
+ * Swap the words startblock, ..., stopblock - 1 of the rows rowa and
+ * rowb. The last word of a row is masked.
+ */
+
+static inline void _mzd_row_swap_blocks(mzd_t *M, rci_t const rowa, rci_t const rowb, wi_t const startblock, wi_t const stopblock) {
+  if (rowa == rowb)
+    return;
+
+  word *a = mzd_row(M, rowa);
+  word *b = mzd_row(M, rowb);
+  wi_t const stop = (stopblock == M->width) ? stopblock - 1 : stopblock;
+
+  for(wi_t i = startblock; i < stop; ++i) {
+    word const tmp = a[i];
+    a[i] = b[i];
+    b[i] = tmp;
+  }
+  if (stop != stopblock) {
+    word const tmp = (a[stop] ^ b[stop]) & M->high_bitmask;
+    a[stop] ^= tmp;
+    b[stop] ^= tmp;
+  }
+}
+
+#if __M4RI_HAVE_OPENMP
+/*
+ * Apply the row swaps of P to A with each thread taking a slab of
+ * columns, which it permutes independently of all others. Slabs span
+ * whole cache lines. Returns FALSE if A is too narrow to be worth it.
+ */
+
+static int _mzd_apply_p_left_parallel(mzd_t *A, mzp_t const *P, int const trans) {
+  int const nthreads = m4ri_get_num_threads();
+  if (nthreads == 1 || omp_in_parallel() || A->width < 2 * __M4RI_APPLY_P_SLAB_WIDTH)
+    return FALSE;
+
+  rci_t const length = MIN(P->length, A->nrows);
+  wi_t slab = (A->width + nthreads - 1) / nthreads;
+  slab = MAX(slab, __M4RI_APPLY_P_SLAB_WIDTH);
+  slab = (slab + 7) & ~(wi_t)7;
+  int const nslabs = (A->width + slab - 1) / slab;
+
+#pragma omp parallel for schedule(static,1) num_threads(m4ri_get_num_threads())
+  for (int s = 0; s < nslabs; ++s) {
+    wi_t const startblock = s * slab;
+    wi_t const stopblock = MIN(startblock + slab, A->width);
+    if (trans) {
+      for (rci_t i = length - 1; i >= 0; --i)
+        _mzd_row_swap_blocks(A, i, P->values[i], startblock, stopblock);
+    } else {
+      for (rci_t i = 0; i < length; ++i)
+        _mzd_row_swap_blocks(A, i, P->values[i], startblock, stopblock);
+    }
+  }
+
+  __M4RI_DD_MZD(A);
+  return TRUE;
+}
+#endif
+
 void mzd_apply_p_left(mzd_t *A, mzp_t const *P) {
   if(A->ncols == 0)
     return;
+#if __M4RI_HAVE_OPENMP
+  if (_mzd_apply_p_left_parallel(A, P, FALSE))
+    return;
+#endif
   rci_t const length = MIN(P->length, A->nrows);
   for (rci_t i = 0; i < length; ++i) {
     assert(P->values[i] >= i);
@@ -79,6 +148,10 @@ void mzd_apply_p_left(mzd_t *A, mzp_t const *P) {
 void mzd_apply_p_left_trans(mzd_t *A, mzp_t const *P) {
   if(A->ncols == 0)
     return;
+#if __M4RI_HAVE_OPENMP
+  if (_mzd_apply_p_left_parallel(A, P, TRUE))
+    return;
+#endif
   rci_t const length = MIN(P->length, A->nrows);
   for (rci_t i = length - 1; i >= 0; --i) {
     assert(P->values[i] >= i);
@@ -108,8 +181,8 @@ static inline void mzd_write_col_to_rows_blockd(mzd_t *A, mzd_t const *B, rci_t
     }
 
     for (rci_t r = start_row; r < stop_row; ++r) {
-      word const *Brow = B->rows[r-start_row];
-      word *Arow = A->rows[r];
+      word const *Brow = mzd_row(B, r-start_row);
+      word *Arow = mzd_row(A, r);
       register word value = 0;
 
       /* we gather the bits in a register word */
@@ -241,8 +314,8 @@ void _mzd_apply_p_right_even(mzd_t *A, mzp_t const *P, rci_t start_row, rci_t st
   for(rci_t i = start_row; i < A->nrows; i += step_size) {
     step_size = MIN(step_size, A->nrows - i);
     for(int k = 0; k < step_size; ++k) {
-      Arow = A->rows[i+k];
-      Brow = B->rows[k];
+      Arow = mzd_row(A, i+k);
+      Brow = mzd_row(B, k);
 
       /*copy row & clear those values which will be overwritten */
       for(wi_t j = 0; j < width; ++j) {
@@ -401,8 +474,14 @@ void _mzd_compress_l(mzd_t *A, rci_t r1, rci_t n1, rci_t r2) {
   word tmp;
   wi_t block;
 
+#if __M4RI_HAVE_OPENMP
+  wi_t const wide = r2 / m4ri_radix + 1;
+  int const chunk = m4ri_omp_chunk(A->nrows - r1 - r2, wide);
+#pragma omp parallel for schedule(static,chunk) private(tmp,block) if(m4ri_omp_parallel(A->nrows - r1 - r2, wide)) num_threads(m4ri_get_num_threads())
+#endif
   for(rci_t i = r1 + r2; i < A->nrows; ++i) {
 
+    word *row = mzd_row(A, i);
     rci_t j = r1;
 
     /* first we deal with the rest of the current word we need to
@@ -421,13 +500,13 @@ void _mzd_compress_l(mzd_t *A, rci_t r1, rci_t n1, rci_t r2) {
 
     if (rest % m4ri_radix == 0) {
       for( ; j + m4ri_radix <= r1 + r2; j += m4ri_radix, ++block) {
-        tmp = A->rows[i][block];
-        A->rows[i][j / m4ri_radix] = tmp;
+        tmp = row[block];
+        row[j / m4ri_radix] = tmp;
       }
     } else {
       for(; j + m4ri_radix <= r1 + r2; j += m4ri_radix, ++block) {
-        tmp = (A->rows[i][block] >> rest) | ( A->rows[i][block + 1] << (m4ri_radix - rest)); 
-        A->rows[i][j / m4ri_radix] = tmp;
+        tmp = (row[block] >> rest) | ( row[block + 1] << (m4ri_radix - rest)); 
+        row[j / m4ri_radix] = tmp;
       }
     }
 
@@ -437,7 +516,7 @@ void _mzd_compress_l(mzd_t *A, rci_t r1, rci_t n1, rci_t r2) {
 
     if (j < r1 + r2) {
       tmp = mzd_read_bits(A, i, n1 + j - r1, r1 + r2 - j);
-      A->rows[i][j / m4ri_radix] = tmp;
+      row[j / m4ri_radix] = tmp;
     }
 
     /* now clear the rest of L2 */
@@ -451,7 +530,7 @@ void _mzd_compress_l(mzd_t *A, rci_t r1, rci_t n1, rci_t r2) {
        which deals with last few bits. */
 
     for(; j < n1 + r2; j += m4ri_radix) {
-      A->rows[i][j / m4ri_radix] = 0;
+      row[j / m4ri_radix] = 0;
     }
   }
  
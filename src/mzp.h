@@ -112,7 +112,9 @@ void mzp_set_ui(mzp_t *P, unsigned int value);
 /**
  * Apply the permutation P to A from the left.
  *
- * This is equivalent to row swaps walking from 0 to length-1.
+ * This is equivalent to row swaps walking from 0 to length-1. With
+ * OpenMP, wide matrices are split into column slabs which are
+ * permuted in parallel.
  *
  * \param A Matrix.
  * \param P Permutation.
@@ -225,4 +227,13 @@ void mzp_print(mzp_t const *P);
 
 void _mzd_compress_l(mzd_t *A, rci_t r1, rci_t n1, rci_t r2);
 
+/**
+ * The minimal number of words per thread when row permutations are
+ * applied in parallel, see mzd_apply_p_left().
+ */
+
+#ifndef __M4RI_APPLY_P_SLAB_WIDTH
+#define __M4RI_APPLY_P_SLAB_WIDTH 16
+#endif
+
 #endif // M4RI_MZP
@@ -28,6 +28,7 @@
 #include "parity.h"
 #include "ple_russian.h"
 #include "strassen.h"
+#include "profile.h"
 #include "ple.h"
 
 rci_t mzd_ple(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff) {
@@ -61,7 +62,12 @@ rci_t _mzd_pluq(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff) {
   return r;
 }
 
-rci_t _mzd_ple(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff) {
+/*
+ * The recursion of _mzd_ple(), where all base cases share the Gray
+ * code tables of ws.
+ */
+
+static rci_t _mzd_ple_ws(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff, m4ri_workspace_t *ws) {
   rci_t ncols = A->ncols;
 
 #if 1
@@ -77,10 +83,10 @@ rci_t _mzd_ple(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff) {
   rci_t nrows = A->nrows;
 #endif
 
-  if (ncols <= m4ri_radix || A->width * A->nrows <= __M4RI_PLE_CUTOFF) {
+  if (ncols <= m4ri_radix || (uint64_t)A->width * A->nrows <= m4ri_profile.ple_cutoff) {
     /* this improves data locality and runtime considerably */
     mzd_t *Abar = mzd_copy(NULL, A);
-    rci_t r = _mzd_ple_russian(Abar, P, Q, 0);
+    rci_t r = _mzd_ple_russian_ws(Abar, P, Q, 0, ws);
     mzd_copy(A, Abar);
     mzd_free(Abar);
     return r;
@@ -107,7 +113,7 @@ rci_t _mzd_ple(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff) {
 
     mzp_t *P1 = mzp_init_window(P, 0, nrows);
     mzp_t *Q1 = mzp_init_window(Q, 0, A0->ncols);
-    rci_t r1 = _mzd_ple(A0, P1, Q1, cutoff);
+    rci_t r1 = _mzd_ple_ws(A0, P1, Q1, cutoff, ws);
 
     /*           r1           n1
      *   ------------------------------------------
@@ -139,7 +145,7 @@ rci_t _mzd_ple(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff) {
     mzp_t *P2 = mzp_init_window(P, r1, nrows);
     mzp_t *Q2 = mzp_init_window(Q, n1, ncols);
 
-    rci_t r2 = _mzd_ple(A11, P2, Q2, cutoff);
+    rci_t r2 = _mzd_ple_ws(A11, P2, Q2, cutoff, ws);
 
     /*           n
      *   -------------------
@@ -187,6 +193,13 @@ rci_t _mzd_ple(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff) {
   }
 }
 
+rci_t _mzd_ple(mzd_t *A, mzp_t *P, mzp_t *Q, int const cutoff) {
+  m4ri_workspace_t *ws = m4ri_workspace_init();
+  rci_t const r = _mzd_ple_ws(A, P, Q, cutoff, ws);
+  m4ri_workspace_free(ws);
+  return r;
+}
+
 rci_t _mzd_pluq_naive(mzd_t *A, mzp_t *P, mzp_t *Q)  {
   rci_t curr_pos = 0;
   for (curr_pos = 0; curr_pos < A->ncols; ) {
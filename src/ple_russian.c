@@ -39,6 +39,10 @@
 /** the number of tables used in PLE decomposition **/
 #define __M4RI_PLE_NTABLES 8
 
+#if __M4RI_PLE_NTABLES > __M4RI_WORKSPACE_NTABLES
+#error "__M4RI_PLE_NTABLES must not exceed __M4RI_WORKSPACE_NTABLES"
+#endif
+
 ple_table_t *ple_table_init(int k, rci_t ncols) {
   ple_table_t *T = (ple_table_t*)m4ri_mm_malloc(sizeof(ple_table_t));
   T->T =  mzd_init(__M4RI_TWOPOW(k), ncols);
@@ -132,7 +136,7 @@ int _mzd_ple_submatrix(mzd_t *A,
     for(i = start_row + rank; i < stop_row; ++i) {
       word const tmp = mzd_read_bits(A, i, start_col, curr_pos + 1);
       if(tmp) {
-        word *Arow = A->rows[i];
+        word *Arow = mzd_row(A, i);
         /* clear before but preserve transformation matrix */
         for (rci_t l = 0; l < rank; ++l)
           if(done[l] < i) {
@@ -205,7 +209,7 @@ void mzd_make_table_ple(mzd_t const *A, rci_t r, rci_t writecol, int k, int knar
   wi_t const next_row_offset = writeblock + T->rowstride - T->width;
 
   word *a;
-  word *ti1 = T->rows[0] + writeblock;
+  word *ti1 = mzd_row(T, 0) + writeblock;
   word *ti = ti1         + T->rowstride;
 
   if(!fullrank) {
@@ -214,10 +218,10 @@ void mzd_make_table_ple(mzd_t const *A, rci_t r, rci_t writecol, int k, int knar
      */
     M[0] = 0;
     for (int i = 1; i < twokay; ++i) {
-      T->rows[i][readblock] = 0; /* we make sure that we can safely add from readblock */
+      mzd_row(T, i)[readblock] = 0; /* we make sure that we can safely add from readblock */
 
       rci_t rowneeded = r + m4ri_codebook[knar]->inc[i - 1];
-      a = A->rows[rowneeded] + writeblock;
+      a = mzd_row(A, rowneeded) + writeblock;
 
       /* Duff's device loop unrolling */
       wi_t n = count;
@@ -243,10 +247,10 @@ void mzd_make_table_ple(mzd_t const *A, rci_t r, rci_t writecol, int k, int knar
      */
     M[0] = 0; E[0] = 0; B[0] = 0;
     for (int i = 1; i < twokay; ++i) {
-      T->rows[i][readblock] = 0; /* we make sure that we can safely add from readblock */
+      mzd_row(T, i)[readblock] = 0; /* we make sure that we can safely add from readblock */
 
       rci_t rowneeded = r + m4ri_codebook[knar]->inc[i - 1];
-      a = A->rows[rowneeded] + writeblock;
+      a = mzd_row(A, rowneeded) + writeblock;
 
       /* Duff's device loop unrolling */
       wi_t n = count;
@@ -326,10 +330,10 @@ void _mzd_ple_a10(mzd_t *A, mzp_t const *P, rci_t const start_row, rci_t const s
 
   for(int i = 1; i < k; ++i) {
     word const tmp = mzd_read_bits(A, start_row + i, start_col, pivots[i]);
-    word *target = A->rows[start_row + i];
+    word *target = mzd_row(A, start_row + i);
     for(int j = 0; j < i; ++j) {
       if((tmp & m4ri_one << pivots[j])) {
-        word const *source = A->rows[start_row + j];
+        word const *source = mzd_row(A, start_row + j);
         for(wi_t w = addblock; w < A->width; ++w) {
           target[w] ^= source[w];
         }
@@ -349,10 +353,14 @@ void _mzd_ple_a11_1(mzd_t *A,
   if (wide <= 0)
     return;
 
+#if __M4RI_HAVE_OPENMP
+  int const chunk = m4ri_omp_chunk(stop_row - start_row, wide);
+#pragma omp parallel for schedule(static,chunk) if(m4ri_omp_parallel(stop_row - start_row, wide)) num_threads(m4ri_get_num_threads())
+#endif
   for(rci_t i = start_row; i < stop_row; ++i) {
     rci_t x0 = T0->M[mzd_read_bits_int(A,i,start_col, k)];
-    word const *s0 = T0->T->rows[x0] + addblock;
-    word *t = A->rows[i] + addblock;
+    word const *s0 = mzd_row(T0->T, x0) + addblock;
+    word *t = mzd_row(A, i) + addblock;
     _mzd_combine(t, s0, wide);
   }
 
@@ -378,6 +386,10 @@ mzd_t *_mzd_ple_to_e(mzd_t *E, mzd_t const *A, rci_t r, rci_t c, int k, rci_t *o
 
 /* method of many people factorisation */
 rci_t _mzd_ple_russian(mzd_t *A, mzp_t *P, mzp_t *Q, int k) {
+  return _mzd_ple_russian_ws(A, P, Q, k, NULL);
+}
+
+rci_t _mzd_ple_russian_ws(mzd_t *A, mzp_t *P, mzp_t *Q, int k, m4ri_workspace_t *ws) {
   rci_t const nrows = A->nrows;
   rci_t const ncols = A->ncols;
   rci_t curr_row = 0;
@@ -389,14 +401,8 @@ rci_t _mzd_ple_russian(mzd_t *A, mzp_t *P, mzp_t *Q, int k) {
   /** compute good k **/
 
   if(k == 0) {
-    /* __M4RI_CPU_L2_CACHE == __M4RI_PLE_NTABLES * 2^k * B->width * 8 */
-    k = (int)log2((__M4RI_CPU_L2_CACHE/8)/(double)A->width/(double)__M4RI_PLE_NTABLES);
-
-    rci_t const klog = round(0.75 * log2_floor(MIN(nrows, ncols)));
-
-    if(klog < k) k = klog;
-    if (k<2)     k = 2;
-    else if(k>8) k = 8;
+    /* on average the tables are applied to half of the rows and are half as wide as A */
+    k = m4ri_opt_k_tables(nrows / 2, ncols, (A->width + 1) / 2, __M4RI_PLE_NTABLES, m4ri_radix / __M4RI_PLE_NTABLES);
   }
   int kk = __M4RI_PLE_NTABLES * k;
   assert(kk <= m4ri_radix);
@@ -410,10 +416,8 @@ rci_t _mzd_ple_russian(mzd_t *A, mzp_t *P, mzp_t *Q, int k) {
   for(rci_t i = 0; i < nrows; ++i)
     P->values[i] = i;
 
-  ple_table_t *T[__M4RI_PLE_NTABLES];
-
-  for(int i=0; i<__M4RI_PLE_NTABLES; i++)
-    T[i] = ple_table_init(k, ncols);
+  m4ri_workspace_t *tmp_ws = (ws == NULL) ? m4ri_workspace_init() : NULL;
+  ple_table_t **T = m4ri_workspace_ple_tables(ws ? ws : tmp_ws, k, ncols);
 
   mzd_t *U = mzd_init(kk, ncols);
 
@@ -484,7 +488,7 @@ rci_t _mzd_ple_russian(mzd_t *A, mzp_t *P, mzp_t *Q, int k) {
         word const bm = m4ri_one << (j % m4ri_radix);
         if (j + 1 < A->ncols)
           for(rci_t l = curr_row + 1; l < nrows; ++l)
-            if(A->rows[l][wrd] & bm)
+            if(mzd_row(A, l)[wrd] & bm)
               mzd_row_add_offset(A, l, curr_row, j + 1);
         curr_col = j + 1;
         ++curr_row;
@@ -600,9 +604,7 @@ rci_t _mzd_ple_russian(mzd_t *A, mzp_t *P, mzp_t *Q, int k) {
   mzp_free_window(Qbar);
 
   mzd_free(U);
-  for(int i=0; i<__M4RI_PLE_NTABLES; i++) {
-    ple_table_free(T[i]);
-  }
+  m4ri_workspace_free(tmp_ws);
   m4ri_mm_free(done);   m4ri_mm_free(pivots);
 
   __M4RI_DD_MZD(A);
@@ -32,16 +32,7 @@
 
 #include <m4ri/mzd.h>
 #include <m4ri/mzp.h>
-
-/**
- * \brief PLE Elimination Tables 
- */
-typedef struct {
-  mzd_t *T; /*< the actual table with 2^k entries */
-  rci_t *M; /*< lookup for multiplication */
-  rci_t *E; /*< lookup for elimination */
-  word  *B; /*< cache of first 64 entries in each row */
-} ple_table_t;
+#include <m4ri/workspace.h>
 
 /**
  * Create new table with 2^k rows and ncols.
@@ -83,6 +74,25 @@ void ple_table_free(ple_table_t *T);
 
 rci_t _mzd_ple_russian(mzd_t *A, mzp_t *P, mzp_t *Q, int k);
 
+/**
+ * \brief PLE matrix decomposition of A using Gray codes and the tables of a workspace.
+ *
+ * See _mzd_ple_russian(), the tables are taken from ws instead of
+ * being allocated by this call.
+ *
+ * \param A Matrix.
+ * \param P Preallocated row permutation.
+ * \param Q Preallocated column permutation.
+ * \param k Size of Gray code tables.
+ * \param ws Workspace or NULL.
+ *
+ * \wordoffset
+ *
+ * \return Rank of A.
+ */
+
+rci_t _mzd_ple_russian_ws(mzd_t *A, mzp_t *P, mzp_t *Q, int k, m4ri_workspace_t *ws);
+
 /**
  * \brief PLUQ matrix decomposition of A using Gray codes.
  *
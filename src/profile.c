@@ -0,0 +1,149 @@
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "profile.h"
+#include "mzd.h"
+#include "strassen.h"
+#include "ple.h"
+#include "echelonform.h"
+
+m4ri_profile_t m4ri_profile;
+
+void m4ri_profile_defaults(m4ri_profile_t *p) {
+  p->strassen_mul_cutoff = __M4RI_STRASSEN_MUL_CUTOFF;
+  p->mul_blocksize = __M4RI_MUL_BLOCKSIZE;
+  p->m4rm_k = 0;
+  p->ple_cutoff = __M4RI_PLE_CUTOFF;
+  p->echelonform_crossover_density = __M4RI_ECHELONFORM_CROSSOVER_DENSITY;
+}
+
+/*
+ * Return non-zero if lo <= value <= hi, written such that NaN is out of
+ * range.
+ */
+
+static inline int _m4ri_profile_in_range(double value, double lo, double hi) {
+  return value >= lo && value <= hi;
+}
+
+/*
+ * Parse a single "key = value" line into p. Returns 0 if the line is
+ * empty, a comment, an unknown key or a valid setting and -1
+ * otherwise.
+ */
+
+static int _m4ri_profile_parse(m4ri_profile_t *p, char const *line) {
+  char key[64];
+  double value;
+  char c;
+
+  if (sscanf(line, " %c", &c) != 1 || c == '#')
+    return 0;
+  if (sscanf(line, " %63[a-z0-9_] = %lf", key, &value) != 2)
+    return -1;
+
+  if (strcmp(key, "strassen_mul_cutoff") == 0) {
+    if (!_m4ri_profile_in_range(value, m4ri_radix, INT_MAX))
+      return -1;
+    p->strassen_mul_cutoff = (int)value;
+  } else if (strcmp(key, "mul_blocksize") == 0) {
+    if (!_m4ri_profile_in_range(value, 1, INT_MAX))
+      return -1;
+    p->mul_blocksize = (int)value;
+  } else if (strcmp(key, "m4rm_k") == 0) {
+    /* M4RM uses eight tables of k bits each on a word */
+    if (!_m4ri_profile_in_range(value, 0, m4ri_radix / 8))
+      return -1;
+    p->m4rm_k = (int)value;
+  } else if (strcmp(key, "ple_cutoff") == 0) {
+    /* 2^53 words is more than any matrix has and keeps the conversion exact */
+    if (!_m4ri_profile_in_range(value, 0, (double)(UINT64_C(1) << 53)))
+      return -1;
+    p->ple_cutoff = (uint64_t)value;
+  } else if (strcmp(key, "echelonform_crossover_density") == 0) {
+    if (!_m4ri_profile_in_range(value, 0, 1))
+      return -1;
+    p->echelonform_crossover_density = value;
+  }
+  return 0;
+}
+
+int m4ri_profile_read(m4ri_profile_t *p, char const *path) {
+  FILE *fh = fopen(path, "r");
+  if (fh == NULL)
+    return -1;
+
+  int ret = 0;
+  char line[256];
+  while (fgets(line, sizeof(line), fh) != NULL)
+    if (_m4ri_profile_parse(p, line))
+      ret = -1;
+
+  fclose(fh);
+  return ret;
+}
+
+int m4ri_profile_write(m4ri_profile_t const *p, char const *path) {
+  FILE *fh = fopen(path, "w");
+  if (fh == NULL)
+    return -1;
+
+  fprintf(fh, "# M4RI tuning profile, see m4ri/profile.h\n");
+  fprintf(fh, "strassen_mul_cutoff = %d\n", p->strassen_mul_cutoff);
+  fprintf(fh, "mul_blocksize = %d\n", p->mul_blocksize);
+  fprintf(fh, "m4rm_k = %d\n", p->m4rm_k);
+  fprintf(fh, "ple_cutoff = %llu\n", (unsigned long long)p->ple_cutoff);
+  fprintf(fh, "echelonform_crossover_density = %.3f\n", p->echelonform_crossover_density);
+
+  return (fclose(fh) == 0) ? 0 : -1;
+}
+
+char const *m4ri_profile_path(char *buf, size_t len) {
+  char const *env = getenv(__M4RI_PROFILE_ENV);
+  if (env != NULL)
+    return env;
+  char const *home = getenv("HOME");
+  if (home == NULL || (size_t)snprintf(buf, len, "%s/%s", home, __M4RI_PROFILE_FILE) >= len)
+    return NULL;
+  return buf;
+}
+
+void m4ri_profile_init(void) {
+  m4ri_profile_defaults(&m4ri_profile);
+
+  char buf[4096];
+  char const *path = m4ri_profile_path(buf, sizeof(buf));
+  if (path == NULL || path[0] == '\0')
+    return;
+
+  /* a broken profile must not leave us with some of its settings */
+  m4ri_profile_t p = m4ri_profile;
+  if (m4ri_profile_read(&p, path) == 0)
+    m4ri_profile = p;
+}
@@ -0,0 +1,154 @@
+/**
+ * \file profile.h
+ * \brief Tuning parameters chosen at runtime.
+ *
+ * The crossovers between the algorithms of this library are derived
+ * from the cache sizes detected at configure time, which often does
+ * not give the best choice on the machine the library actually runs
+ * on. The m4ri_tune program measures them on the running host and
+ * writes a profile, which m4ri_init() loads into m4ri_profile.
+ *
+ * A profile is a text file of "key = value" lines, where empty lines
+ * and lines starting with '#' are ignored. The keys are the names of
+ * the members of m4ri_profile_t.
+ */
+
+#ifndef M4RI_PROFILE_H
+#define M4RI_PROFILE_H
+
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+#include <m4ri/misc.h>
+
+/**
+ * Name of the environment variable holding the path of the profile.
+ */
+
+#define __M4RI_PROFILE_ENV "M4RI_PROFILE"
+
+/**
+ * Name of the profile in the home directory, used if __M4RI_PROFILE_ENV is not set.
+ */
+
+#define __M4RI_PROFILE_FILE ".m4ri_profile"
+
+/**
+ * \brief Tuning parameters.
+ */
+
+typedef struct {
+  /**
+   * Strassen-Winograd cutoff used by mzd_mul() and mzd_addmul() if
+   * they are passed 0, see __M4RI_STRASSEN_MUL_CUTOFF.
+   */
+  int strassen_mul_cutoff;
+
+  /**
+   * Number of rows of A processed as one block by M4RM, see
+   * __M4RI_MUL_BLOCKSIZE.
+   */
+  int mul_blocksize;
+
+  /**
+   * M4RM parameter k used if 0 is passed, or 0 to derive it from the
+   * dimensions.
+   */
+  int m4rm_k;
+
+  /**
+   * Matrices of at most this many words are decomposed by PLE using
+   * Gray codes directly instead of recursively, see __M4RI_PLE_CUTOFF.
+   */
+  uint64_t ple_cutoff;
+
+  /**
+   * Density at which mzd_echelonize() switches from M4RI to PLE, see
+   * __M4RI_ECHELONFORM_CROSSOVER_DENSITY.
+   */
+  double echelonform_crossover_density;
+
+} m4ri_profile_t;
+
+/**
+ * \brief The parameters in use.
+ *
+ * This is filled by m4ri_init() and may be changed between calls into
+ * the library.
+ */
+
+extern m4ri_profile_t m4ri_profile;
+
+/**
+ * \brief Set p to the parameters derived from the cache sizes at configure time.
+ *
+ * \param p Profile.
+ */
+
+void m4ri_profile_defaults(m4ri_profile_t *p);
+
+/**
+ * \brief Read the parameters in the file path into p.
+ *
+ * Parameters not in the file are left unchanged and unknown keys are
+ * ignored. Lines with a value out of range are not applied.
+ *
+ * \param p Profile.
+ * \param path File name.
+ *
+ * \return 0 on success, -1 if the file cannot be read or has a malformed or invalid line.
+ */
+
+int m4ri_profile_read(m4ri_profile_t *p, char const *path);
+
+/**
+ * \brief Write p to the file path.
+ *
+ * \param p Profile.
+ * \param path File name.
+ *
+ * \return 0 on success, -1 on error.
+ */
+
+int m4ri_profile_write(m4ri_profile_t const *p, char const *path);
+
+/**
+ * \brief Return the file name of the profile loaded by m4ri_init().
+ *
+ * This is the value of the environment variable __M4RI_PROFILE_ENV if
+ * it is set, or __M4RI_PROFILE_FILE in the home directory otherwise.
+ * The result is NULL if neither is available, and an empty string
+ * disables loading a profile.
+ *
+ * \param buf Buffer for the file name.
+ * \param len Size of buf.
+ */
+
+char const *m4ri_profile_path(char *buf, size_t len);
+
+/**
+ * \brief Fill m4ri_profile with the defaults and the profile found by m4ri_profile_path(), if any.
+ *
+ * This is called by m4ri_init().
+ */
+
+void m4ri_profile_init(void);
+
+#endif // M4RI_PROFILE_H
@@ -27,6 +27,7 @@
 #include "graycode.h"
 #include "strassen.h"
 #include "parity.h"
+#include "profile.h"
 #ifndef MIN
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #endif
@@ -41,12 +42,7 @@ static inline int CLOSER(rci_t a, int cutoff)
   return 3 * a < 4 * cutoff;
 }
 
-/**
- * Simple blockwise product
- */
-mzd_t *_mzd_addmul_mp_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff);
-
-mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
+mzd_t *_mzd_mul_even_ws(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff, m4ri_workspace_t *ws) {
   rci_t mmm, kkk, nnn;
 
   if(C->nrows == 0 || C->ncols == 0)
@@ -64,13 +60,13 @@ mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
       mzd_t *Abar = mzd_copy(NULL, A);
       mzd_t *Bbar = mzd_copy(NULL, B);
       mzd_t *Cbar = mzd_init(m, n);
-      _mzd_mul_m4rm(Cbar, Abar, Bbar, 0, FALSE);
+      _mzd_mul_m4rm_ws(Cbar, Abar, Bbar, 0, FALSE, ws);
       mzd_copy(C, Cbar);
       mzd_free(Cbar);
       mzd_free(Bbar);
       mzd_free(Abar);
     } else {
-      _mzd_mul_m4rm(C, A, B, 0, TRUE);
+      _mzd_mul_m4rm_ws(C, A, B, 0, TRUE, ws);
     }
     return C;
   }
@@ -119,18 +115,18 @@ mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
 
     _mzd_add(Wkn, B22, B12);		 /* Wkn = B22 + B12 */
     _mzd_add(Wmk, A22, A12);		 /* Wmk = A22 + A12 */
-    _mzd_mul_even(C21, Wmk, Wkn, cutoff);/* C21 = Wmk * Wkn */
+    _mzd_mul_even_ws(C21, Wmk, Wkn, cutoff, ws);/* C21 = Wmk * Wkn */
 
     _mzd_add(Wmk, A22, A21);		 /* Wmk = A22 - A21 */
     _mzd_add(Wkn, B22, B21);		 /* Wkn = B22 - B21 */
-    _mzd_mul_even(C22, Wmk, Wkn, cutoff);/* C22 = Wmk * Wkn */
+    _mzd_mul_even_ws(C22, Wmk, Wkn, cutoff, ws);/* C22 = Wmk * Wkn */
 
     _mzd_add(Wkn, Wkn, B12);		 /* Wkn = Wkn + B12 */
     _mzd_add(Wmk, Wmk, A12);		 /* Wmk = Wmk + A12 */
-    _mzd_mul_even(C11, Wmk, Wkn, cutoff);/* C11 = Wmk * Wkn */
+    _mzd_mul_even_ws(C11, Wmk, Wkn, cutoff, ws);/* C11 = Wmk * Wkn */
 
     _mzd_add(Wmk, Wmk, A11);		 /* Wmk = Wmk - A11 */
-    _mzd_mul_even(C12, Wmk, B12, cutoff);/* C12 = Wmk * B12 */
+    _mzd_mul_even_ws(C12, Wmk, B12, cutoff, ws);/* C12 = Wmk * B12 */
     _mzd_add(C12, C12, C22);		 /* C12 = C12 + C22 */
 
     /**
@@ -143,18 +139,19 @@ mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
      */
 
     mzd_free(Wmk);
-    Wmk = mzd_mul(NULL, A12, B21, cutoff);/*Wmk = A12 * B21 */
+    Wmk = mzd_init(mmm, nnn);
+    _mzd_mul_even_ws(Wmk, A12, B21, cutoff, ws);/*Wmk = A12 * B21 */
 
     _mzd_add(C11, C11, Wmk);		  /* C11 = C11 + Wmk */
     _mzd_add(C12, C11, C12);		  /* C12 = C11 - C12 */
     _mzd_add(C11, C21, C11);		  /* C11 = C21 - C11 */
     _mzd_add(Wkn, Wkn, B11);		  /* Wkn = Wkn - B11 */
-    _mzd_mul_even(C21, A21, Wkn, cutoff); /* C21 = A21 * Wkn */
+    _mzd_mul_even_ws(C21, A21, Wkn, cutoff, ws); /* C21 = A21 * Wkn */
     mzd_free(Wkn);
 
     _mzd_add(C21, C11, C21);		  /* C21 = C11 - C21 */
     _mzd_add(C22, C22, C11);		  /* C22 = C22 + C11 */
-    _mzd_mul_even(C11, A11, B11, cutoff); /* C11 = A11 * B11 */
+    _mzd_mul_even_ws(C11, A11, B11, cutoff, ws); /* C11 = A11 * B11 */
 
     _mzd_add(C11, C11, Wmk);		  /* C11 = C11 + Wmk */
 
@@ -177,7 +174,7 @@ mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
      * Compute |AA| x | B| = | C| */
     mzd_t const *B_last_col = mzd_init_window_const(B, 0, nnn, k, n);
     mzd_t *C_last_col = mzd_init_window(C, 0, nnn, m, n);
-    _mzd_mul_m4rm(C_last_col, A, B_last_col, 0, TRUE);
+    _mzd_mul_m4rm_ws(C_last_col, A, B_last_col, 0, TRUE, ws);
     mzd_free_window((mzd_t*)B_last_col);
     mzd_free_window(C_last_col);
   }
@@ -188,7 +185,7 @@ mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
     mzd_t const *A_last_row = mzd_init_window_const(A, mmm, 0, m, k);
     mzd_t const *B_first_col= mzd_init_window_const(B,   0, 0, k, nnn);
     mzd_t *C_last_row = mzd_init_window(C, mmm, 0, m, nnn);
-    _mzd_mul_m4rm(C_last_row, A_last_row, B_first_col, 0, TRUE);
+    _mzd_mul_m4rm_ws(C_last_row, A_last_row, B_first_col, 0, TRUE, ws);
     mzd_free_window((mzd_t*)A_last_row);
     mzd_free_window((mzd_t*)B_first_col);
     mzd_free_window(C_last_row);
@@ -200,7 +197,7 @@ mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
     mzd_t const *A_last_col = mzd_init_window_const(A,   0, kkk, mmm, k);
     mzd_t const *B_last_row = mzd_init_window_const(B, kkk,   0,   k, nnn);
     mzd_t *C_bulk = mzd_init_window(C, 0, 0, mmm, nnn);
-    mzd_addmul_m4rm(C_bulk, A_last_col, B_last_row, 0);
+    _mzd_mul_m4rm_ws(C_bulk, A_last_col, B_last_row, 0, FALSE, ws);
     mzd_free_window((mzd_t*)A_last_col);
     mzd_free_window((mzd_t*)B_last_row);
     mzd_free_window(C_bulk);
@@ -210,7 +207,7 @@ mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
   return C;
 }
 
-mzd_t *_mzd_sqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
+static mzd_t *_mzd_sqr_even_ws(mzd_t *C, mzd_t const *A, int cutoff, m4ri_workspace_t *ws) {
   rci_t m;
 
   m = A->nrows;
@@ -221,12 +218,12 @@ mzd_t *_mzd_sqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
     if(mzd_is_windowed(A)|mzd_is_windowed(C)) {
       mzd_t *Abar = mzd_copy(NULL, A);
       mzd_t *Cbar = mzd_init(m, m);
-      _mzd_mul_m4rm(Cbar, Abar, Abar, 0, FALSE);
+      _mzd_mul_m4rm_ws(Cbar, Abar, Abar, 0, FALSE, ws);
       mzd_copy(C, Cbar);
       mzd_free(Cbar);
       mzd_free(Abar);
     } else {
-      _mzd_mul_m4rm(C, A, A, 0, TRUE);
+      _mzd_mul_m4rm_ws(C, A, A, 0, TRUE, ws);
     }
     return C;
   }
@@ -266,29 +263,30 @@ mzd_t *_mzd_sqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
     mzd_t *Wkn = mzd_init(mmm, mmm);
 
     _mzd_add(Wkn, A22, A12);                 /* Wkn = A22 + A12 */
-    _mzd_sqr_even(C21, Wkn, cutoff);     /* C21 = Wkn^2 */
+    _mzd_sqr_even_ws(C21, Wkn, cutoff, ws); /* C21 = Wkn^2 */
 
     _mzd_add(Wkn, A22, A21);                 /* Wkn = A22 - A21 */
-    _mzd_sqr_even(C22, Wkn, cutoff);     /* C22 = Wkn^2 */
+    _mzd_sqr_even_ws(C22, Wkn, cutoff, ws); /* C22 = Wkn^2 */
 
     _mzd_add(Wkn, Wkn, A12);                 /* Wkn = Wkn + A12 */
-    _mzd_sqr_even(C11, Wkn, cutoff);     /* C11 = Wkn^2 */
+    _mzd_sqr_even_ws(C11, Wkn, cutoff, ws); /* C11 = Wkn^2 */
 
     _mzd_add(Wkn, Wkn, A11);                 /* Wkn = Wkn - A11 */
-    _mzd_mul_even(C12, Wkn, A12, cutoff);/* C12 = Wkn * A12 */
+    _mzd_mul_even_ws(C12, Wkn, A12, cutoff, ws);/* C12 = Wkn * A12 */
     _mzd_add(C12, C12, C22);		  /* C12 = C12 + C22 */
 
-    Wmk = mzd_mul(NULL, A12, A21, cutoff);/*Wmk = A12 * A21 */
+    Wmk = mzd_init(mmm, mmm);
+    _mzd_mul_even_ws(Wmk, A12, A21, cutoff, ws);/*Wmk = A12 * A21 */
 
     _mzd_add(C11, C11, Wmk);		  /* C11 = C11 + Wmk */
     _mzd_add(C12, C11, C12);		  /* C12 = C11 - C12 */
     _mzd_add(C11, C21, C11);		  /* C11 = C21 - C11 */
-    _mzd_mul_even(C21, A21, Wkn, cutoff);/* C21 = A21 * Wkn */
+    _mzd_mul_even_ws(C21, A21, Wkn, cutoff, ws);/* C21 = A21 * Wkn */
     mzd_free(Wkn);
 
     _mzd_add(C21, C11, C21);		  /* C21 = C11 - C21 */
     _mzd_add(C22, C22, C11);		  /* C22 = C22 + C11 */
-    _mzd_sqr_even(C11, A11, cutoff);     /* C11 = A11^2 */
+    _mzd_sqr_even_ws(C11, A11, cutoff, ws); /* C11 = A11^2 */
 
     _mzd_add(C11, C11, Wmk);		  /* C11 = C11 + Wmk */
 
@@ -309,7 +307,7 @@ mzd_t *_mzd_sqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
     {
       mzd_t const *A_last_col = mzd_init_window_const(A, 0, mmm, m, m);
       mzd_t *C_last_col = mzd_init_window(C, 0, mmm, m, m);
-      _mzd_mul_m4rm(C_last_col, A, A_last_col, 0, TRUE);
+      _mzd_mul_m4rm_ws(C_last_col, A, A_last_col, 0, TRUE, ws);
       mzd_free_window((mzd_t*)A_last_col);
       mzd_free_window(C_last_col);
     }
@@ -319,7 +317,7 @@ mzd_t *_mzd_sqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
       mzd_t const *A_last_row = mzd_init_window_const(A, mmm, 0, m, m);
       mzd_t const *A_first_col= mzd_init_window_const(A,   0, 0, m, mmm);
       mzd_t *C_last_row = mzd_init_window(C, mmm, 0, m, mmm);
-      _mzd_mul_m4rm(C_last_row, A_last_row, A_first_col, 0, TRUE);
+      _mzd_mul_m4rm_ws(C_last_row, A_last_row, A_first_col, 0, TRUE, ws);
       mzd_free_window((mzd_t*)A_last_row);
       mzd_free_window((mzd_t*)A_first_col);
       mzd_free_window(C_last_row);
@@ -330,7 +328,7 @@ mzd_t *_mzd_sqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
       mzd_t const *A_last_col = mzd_init_window_const(A,   0, mmm, mmm, m);
       mzd_t const *A_last_row = mzd_init_window_const(A, mmm,   0,   m, mmm);
       mzd_t *C_bulk = mzd_init_window(C, 0, 0, mmm, mmm);
-      mzd_addmul_m4rm(C_bulk, A_last_col, A_last_row, 0);
+      _mzd_mul_m4rm_ws(C_bulk, A_last_col, A_last_row, 0, FALSE, ws);
       mzd_free_window((mzd_t*)A_last_col);
       mzd_free_window((mzd_t*)A_last_row);
       mzd_free_window(C_bulk);
@@ -342,125 +340,296 @@ mzd_t *_mzd_sqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
 }
 
 
+mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
+  m4ri_workspace_t *ws = m4ri_workspace_init();
+  _mzd_mul_even_ws(C, A, B, cutoff, ws);
+  m4ri_workspace_free(ws);
+  return C;
+}
+
+mzd_t *_mzd_sqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
+  m4ri_workspace_t *ws = m4ri_workspace_init();
+  _mzd_sqr_even_ws(C, A, cutoff, ws);
+  m4ri_workspace_free(ws);
+  return C;
+}
+
+static int strassen_task_depth = __M4RI_STRASSEN_TASK_DEPTH;
+
+void mzd_set_strassen_task_depth(int depth) {
+  strassen_task_depth = depth;
+}
+
+int mzd_get_strassen_task_depth(void) {
+  return strassen_task_depth;
+}
+
 #if __M4RI_HAVE_OPENMP
-mzd_t *_mzd_addmul_mp_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
-  /**
-   * \todo make sure not to overwrite crap after ncols and before width * m4ri_radix
-   */
-  rci_t a = A->nrows;
-  rci_t b = A->ncols;
-  rci_t c = B->ncols;
-  /* handle case first, where the input matrices are too small already */
-  if (CLOSER(A->nrows, cutoff) || CLOSER(A->ncols, cutoff) || CLOSER(B->ncols, cutoff)) {
-    /* we copy the matrix first since it is only constant memory
-       overhead and improves data locality, if you remove it make sure
-       there are no speed regressions */
-    /* C = _mzd_mul_m4rm(C, A, B, 0, TRUE); */
-    mzd_t *Cbar = mzd_init(C->nrows, C->ncols);
-    Cbar = _mzd_mul_m4rm(Cbar, A, B, 0, FALSE);
-    mzd_copy(C, Cbar);
-    mzd_free(Cbar);
-    return C;
+/*
+ * Number of recursion levels to run as tasks. If none was set we pick
+ * the smallest depth for which the 7^depth products give every thread
+ * a few tasks to balance the load.
+ */
+
+static int _mzd_strassen_task_depth(void) {
+  int depth = strassen_task_depth;
+  if (depth < 0) {
+    int const threads = m4ri_get_num_threads();
+    depth = 0;
+    if (threads > 1)
+      for (int leaves = 1; leaves < 4 * threads; leaves *= 7)
+        ++depth;
+  }
+  return depth;
+}
+
+/*
+ * Compute C = AB if add is FALSE and C = C + AB otherwise, where the
+ * top depth levels of the recursion run their seven products as
+ * OpenMP tasks. This must be called from within a parallel region.
+ *
+ * We use Winograd's form of Strassen's algorithm, where over GF(2)
+ * all signs vanish:
+ *
+ *   S1 = A21 + A22   T1 = B11 + B12   P1 = A11 * B11   P5 = S1 * T1
+ *   S2 = S1  + A11   T2 = T1  + B22   P2 = A12 * B21   P6 = S2 * T2
+ *   S3 = A11 + A21   T3 = B12 + B22   P3 = S4  * B22   P7 = S3 * T3
+ *   S4 = S2  + A12   T4 = T2  + B21   P4 = A22 * T4
+ *
+ *   C11 = P1 + P2             C12 = P1 + P6 + P5 + P3
+ *   C21 = P1 + P6 + P7 + P4   C22 = P1 + P6 + P7 + P5
+ *
+ * In contrast to the sequential schedule of _mzd_mul_even the
+ * products are independent. The eight sums are formed once before the
+ * products are spawned and freed when they are done. P2, P3 and P4
+ * (and P7 if add is FALSE) go straight into the quadrants of C, the
+ * others are held in temporaries until they are combined.
+ *
+ * Thus a level holds up to twelve temporaries of a quarter of the
+ * size of its operands: S1..S4 as large as A, T1..T4 as large as B
+ * and P1, P5, P6, P7 as large as C. Its seven products run at the
+ * same time and each again holds a quarter of that, so with operands
+ * of total size X = |A| + |B| + |C| and d task levels the extra
+ * memory is at most X (1 + 7/4 + ... + (7/4)^(d-1)), plus what the
+ * sequential products at the leaves need.
+ *
+ * ws holds one workspace per thread of the team. The M4RM products
+ * at the leaves and edges use the workspace of the thread they run
+ * on. They contain no task scheduling point, so no other task can
+ * run on that thread and use the same workspace before they finish.
+ */
+
+static mzd_t *_mzd_mul_tasks(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff, int depth, int add, m4ri_workspace_t **ws) {
+  rci_t const m = A->nrows;
+  rci_t const k = A->ncols;
+  rci_t const n = B->ncols;
+
+  if (depth == 0 || CLOSER(m, cutoff) || CLOSER(k, cutoff) || CLOSER(n, cutoff)) {
+    m4ri_workspace_t *tws = ws[omp_get_thread_num()];
+    return add ? _mzd_addmul_even_ws(C, A, B, cutoff, tws) : _mzd_mul_even_ws(C, A, B, cutoff, tws);
   }
 
   /* adjust cutting numbers to work on words */
+  rci_t mmm, kkk, nnn;
   {
-    rci_t mult = 2 * m4ri_radix;
-/*    rci_t width = a; */
-/*    while (width > 2 * cutoff) { */
-/*      width /= 2; */
-/*      mult *= 2; */
-/*    } */
-    a -= a % mult;
-    b -= b % mult;
-    c -= c % mult;
-  }
-
-  rci_t anr = ((a / m4ri_radix) >> 1) * m4ri_radix;
-  rci_t anc = ((b / m4ri_radix) >> 1) * m4ri_radix;
-  rci_t bnr = anc;
-  rci_t bnc = ((c / m4ri_radix) >> 1) * m4ri_radix;
-
-  mzd_t const *A00 = mzd_init_window_const(A,   0,   0,   anr,   anc);
-  mzd_t const *A01 = mzd_init_window_const(A,   0, anc,   anr, 2*anc);
-  mzd_t const *A10 = mzd_init_window_const(A, anr,   0, 2*anr,   anc);
-  mzd_t const *A11 = mzd_init_window_const(A, anr, anc, 2*anr, 2*anc);
-
-  mzd_t const *B00 = mzd_init_window_const(B,   0,   0,   bnr,   bnc);
-  mzd_t const *B01 = mzd_init_window_const(B,   0, bnc,   bnr, 2*bnc);
-  mzd_t const *B10 = mzd_init_window_const(B, bnr,   0, 2*bnr,   bnc);
-  mzd_t const *B11 = mzd_init_window_const(B, bnr, bnc, 2*bnr, 2*bnc);
-
-  mzd_t *C00 = mzd_init_window(C,   0,   0,   anr,   bnc);
-  mzd_t *C01 = mzd_init_window(C,   0, bnc,   anr, 2*bnc);
-  mzd_t *C10 = mzd_init_window(C, anr,   0, 2*anr,   bnc);
-  mzd_t *C11 = mzd_init_window(C, anr, bnc, 2*anr, 2*bnc);
-
-#pragma omp parallel sections num_threads(4)
-  {
-#pragma omp section
-    {
-      _mzd_addmul_even(C00, A00, B00, cutoff);
-      _mzd_addmul_even(C00, A01, B10, cutoff);
-    }
-#pragma omp section
-    {
-      _mzd_addmul_even(C01, A00, B01, cutoff);
-      _mzd_addmul_even(C01, A01, B11, cutoff);
+    rci_t mult = m4ri_radix;
+    rci_t width = MIN(MIN(m, n), k) / 2;
+    while (width > cutoff) {
+      width /= 2;
+      mult *= 2;
     }
-#pragma omp section
+
+    mmm = (((m - m % mult) / m4ri_radix) >> 1) * m4ri_radix;
+    kkk = (((k - k % mult) / m4ri_radix) >> 1) * m4ri_radix;
+    nnn = (((n - n % mult) / m4ri_radix) >> 1) * m4ri_radix;
+  }
+
+  mzd_t const *A11 = mzd_init_window_const(A,   0,   0,   mmm,   kkk);
+  mzd_t const *A12 = mzd_init_window_const(A,   0, kkk,   mmm, 2*kkk);
+  mzd_t const *A21 = mzd_init_window_const(A, mmm,   0, 2*mmm,   kkk);
+  mzd_t const *A22 = mzd_init_window_const(A, mmm, kkk, 2*mmm, 2*kkk);
+
+  mzd_t const *B11 = mzd_init_window_const(B,   0,   0,   kkk,   nnn);
+  mzd_t const *B12 = mzd_init_window_const(B,   0, nnn,   kkk, 2*nnn);
+  mzd_t const *B21 = mzd_init_window_const(B, kkk,   0, 2*kkk,   nnn);
+  mzd_t const *B22 = mzd_init_window_const(B, kkk, nnn, 2*kkk, 2*nnn);
+
+  mzd_t *C11 = mzd_init_window(C,   0,   0,   mmm,   nnn);
+  mzd_t *C12 = mzd_init_window(C,   0, nnn,   mmm, 2*nnn);
+  mzd_t *C21 = mzd_init_window(C, mmm,   0, 2*mmm,   nnn);
+  mzd_t *C22 = mzd_init_window(C, mmm, nnn, 2*mmm, 2*nnn);
+
+  mzd_t *P1 = mzd_init_uninitialized(mmm, nnn);
+  mzd_t *P5 = mzd_init_uninitialized(mmm, nnn);
+  mzd_t *P6 = mzd_init_uninitialized(mmm, nnn);
+  mzd_t *P7 = add ? mzd_init_uninitialized(mmm, nnn) : C22;
+
+  --depth;
+
+  /* the sums are shared between products, form them once */
+  mzd_t *S1 = mzd_init_uninitialized(mmm, kkk);
+  mzd_t *S2 = mzd_init_uninitialized(mmm, kkk);
+  mzd_t *S3 = mzd_init_uninitialized(mmm, kkk);
+  mzd_t *S4 = mzd_init_uninitialized(mmm, kkk);
+  mzd_t *T1 = mzd_init_uninitialized(kkk, nnn);
+  mzd_t *T2 = mzd_init_uninitialized(kkk, nnn);
+  mzd_t *T3 = mzd_init_uninitialized(kkk, nnn);
+  mzd_t *T4 = mzd_init_uninitialized(kkk, nnn);
+
+#pragma omp task
+  {
+    _mzd_add(S1, A21, A22);
+    _mzd_add(S2, S1, A11);
+    _mzd_add(S4, S2, A12);
+  }
+#pragma omp task
+  {
+    _mzd_add(T1, B11, B12);
+    _mzd_add(T2, T1, B22);
+    _mzd_add(T4, T2, B21);
+  }
+#pragma omp task
+  _mzd_add(S3, A11, A21);
+#pragma omp task
+  _mzd_add(T3, B12, B22);
+#pragma omp taskwait
+
+#pragma omp task
+  _mzd_mul_tasks(P1, A11, B11, cutoff, depth, FALSE, ws);
+#pragma omp task
+  _mzd_mul_tasks(C11, A12, B21, cutoff, depth, add, ws);
+#pragma omp task
+  _mzd_mul_tasks(C12, S4, B22, cutoff, depth, add, ws);
+#pragma omp task
+  _mzd_mul_tasks(C21, A22, T4, cutoff, depth, add, ws);
+#pragma omp task
+  _mzd_mul_tasks(P5, S1, T1, cutoff, depth, FALSE, ws);
+#pragma omp task
+  _mzd_mul_tasks(P6, S2, T2, cutoff, depth, FALSE, ws);
+#pragma omp task
+  _mzd_mul_tasks(P7, S3, T3, cutoff, depth, FALSE, ws);
+
+  /* the remaining columns and rows of C do not overlap with the quadrants */
+  if (n > 2*nnn) {
+#pragma omp task
     {
-      _mzd_addmul_even(C10, A10, B00, cutoff);
-      _mzd_addmul_even(C10, A11, B10, cutoff);
+      /*         |AA|   | B|   | C|
+       * Compute |AA| x | B| = | C| */
+      mzd_t const *B_last_col = mzd_init_window_const(B, 0, 2*nnn, k, n);
+      mzd_t *C_last_col = mzd_init_window(C, 0, 2*nnn, m, n);
+      _mzd_mul_m4rm_ws(C_last_col, A, B_last_col, 0, !add, ws[omp_get_thread_num()]);
+      mzd_free_window((mzd_t*)B_last_col);
+      mzd_free_window(C_last_col);
     }
-#pragma omp section
+  }
+  if (m > 2*mmm) {
+#pragma omp task
     {
-      _mzd_addmul_even(C11, A10, B01, cutoff);
-      _mzd_addmul_even(C11, A11, B11, cutoff);
+      /*         |  |   |B |   |  |
+       * Compute |AA| x |B | = |C | */
+      mzd_t const *A_last_row = mzd_init_window_const(A, 2*mmm, 0, m, k);
+      mzd_t const *B_first_col= mzd_init_window_const(B,     0, 0, k, 2*nnn);
+      mzd_t *C_last_row = mzd_init_window(C, 2*mmm, 0, m, 2*nnn);
+      _mzd_mul_m4rm_ws(C_last_row, A_last_row, B_first_col, 0, !add, ws[omp_get_thread_num()]);
+      mzd_free_window((mzd_t*)A_last_row);
+      mzd_free_window((mzd_t*)B_first_col);
+      mzd_free_window(C_last_row);
     }
   }
 
-  /* deal with rest */
-  if (B->ncols > 2 * bnc) {
-    mzd_t const *B_last_col = mzd_init_window_const(B, 0, 2*bnc, A->ncols, B->ncols);
-    mzd_t *C_last_col = mzd_init_window(C, 0, 2*bnc, A->nrows, C->ncols);
-    mzd_addmul_m4rm(C_last_col, A, B_last_col, 0);
-    mzd_free_window((mzd_t*)B_last_col);
-    mzd_free_window(C_last_col);
+#pragma omp taskwait
+
+  mzd_free(T4); mzd_free(T3); mzd_free(T2); mzd_free(T1);
+  mzd_free(S4); mzd_free(S3); mzd_free(S2); mzd_free(S1);
+
+  /* U2 = P1 + P6 */
+#pragma omp task
+  _mzd_add(P6, P6, P1);
+#pragma omp task
+  _mzd_add(C11, C11, P1);
+#pragma omp taskwait
+
+#pragma omp task
+  {
+    _mzd_add(C12, C12, P6);
+    _mzd_add(C12, C12, P5);
   }
-  if (A->nrows > 2 * anr) {
-    mzd_t const *A_last_row = mzd_init_window_const(A, 2*anr, 0, A->nrows, A->ncols);
-    mzd_t const *B_bulk = mzd_init_window_const(B, 0, 0, B->nrows, 2*bnc);
-    mzd_t *C_last_row = mzd_init_window(C, 2*anr, 0, C->nrows, 2*bnc);
-    mzd_addmul_m4rm(C_last_row, A_last_row, B_bulk, 0);
-    mzd_free_window((mzd_t*)A_last_row);
-    mzd_free_window((mzd_t*)B_bulk);
-    mzd_free_window(C_last_row);
+#pragma omp task
+  {
+    if (add) {
+      _mzd_add(P7, P7, P6);   /* U3 = U2 + P7 */
+      _mzd_add(C21, C21, P7);
+      _mzd_add(C22, C22, P7);
+    } else {
+      _mzd_add(C22, C22, P6); /* U3 = U2 + P7 */
+      _mzd_add(C21, C21, C22);
+    }
+    _mzd_add(C22, C22, P5);
   }
-  if (A->ncols > 2 * anc) {
-    mzd_t const *A_last_col = mzd_init_window_const(A,     0, 2*anc, 2*anr, A->ncols);
-    mzd_t const *B_last_row = mzd_init_window_const(B, 2*bnr,     0, B->nrows, 2*bnc);
-    mzd_t *C_bulk = mzd_init_window(C, 0, 0, 2*anr, 2*bnc);
-    mzd_addmul_m4rm(C_bulk, A_last_col, B_last_row, 0);
+#pragma omp taskwait
+
+  if (add)
+    mzd_free(P7);
+  mzd_free(P6);
+  mzd_free(P5);
+  mzd_free(P1);
+
+  /* clean up */
+  mzd_free_window((mzd_t*)A11); mzd_free_window((mzd_t*)A12);
+  mzd_free_window((mzd_t*)A21); mzd_free_window((mzd_t*)A22);
+
+  mzd_free_window((mzd_t*)B11); mzd_free_window((mzd_t*)B12);
+  mzd_free_window((mzd_t*)B21); mzd_free_window((mzd_t*)B22);
+
+  mzd_free_window(C11); mzd_free_window(C12);
+  mzd_free_window(C21); mzd_free_window(C22);
+
+  if (k > 2*kkk) {
+    /* Add to  |  |   | B|   |C |
+     * result  |A | x |  | = |  | */
+    mzd_t const *A_last_col = mzd_init_window_const(A,     0, 2*kkk, 2*mmm, k);
+    mzd_t const *B_last_row = mzd_init_window_const(B, 2*kkk,     0,     k, 2*nnn);
+    mzd_t *C_bulk = mzd_init_window(C, 0, 0, 2*mmm, 2*nnn);
+    _mzd_mul_m4rm_ws(C_bulk, A_last_col, B_last_row, 0, FALSE, ws[omp_get_thread_num()]);
     mzd_free_window((mzd_t*)A_last_col);
     mzd_free_window((mzd_t*)B_last_row);
     mzd_free_window(C_bulk);
   }
 
-  /* clean up */
-  mzd_free_window((mzd_t*)A00); mzd_free_window((mzd_t*)A01);
-  mzd_free_window((mzd_t*)A10); mzd_free_window((mzd_t*)A11);
+  __M4RI_DD_MZD(C);
+  return C;
+}
 
-  mzd_free_window((mzd_t*)B00); mzd_free_window((mzd_t*)B01);
-  mzd_free_window((mzd_t*)B10); mzd_free_window((mzd_t*)B11);
+/*
+ * Return TRUE if C = AB should be computed by _mzd_mul_tasks, i.e. if
+ * we are not in a parallel region already and the top level is split.
+ */
 
-  mzd_free_window(C00); mzd_free_window(C01);
-  mzd_free_window(C10); mzd_free_window(C11);
+static int _mzd_mul_use_tasks(mzd_t const *A, mzd_t const *B, int cutoff, int depth) {
+  return depth > 0 && !omp_in_parallel() && !CLOSER(A->nrows, cutoff) && !CLOSER(A->ncols, cutoff) && !CLOSER(B->ncols, cutoff);
+}
 
-  __M4RI_DD_MZD(C);
+/*
+ * Run _mzd_mul_tasks in a new parallel region with one workspace per
+ * thread, which all products on that thread share.
+ */
+
+static mzd_t *_mzd_mul_tasks_run(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff, int depth, int add) {
+  int const nthreads = m4ri_get_num_threads();
+  m4ri_workspace_t **ws = (m4ri_workspace_t**)m4ri_mm_malloc(nthreads * sizeof(m4ri_workspace_t*));
+  for (int i = 0; i < nthreads; ++i)
+    ws[i] = m4ri_workspace_init();
+
+#pragma omp parallel num_threads(nthreads)
+#pragma omp single
+  _mzd_mul_tasks(C, A, B, cutoff, depth, add, ws);
+
+  for (int i = 0; i < nthreads; ++i)
+    m4ri_workspace_free(ws[i]);
+  m4ri_mm_free(ws);
   return C;
 }
-#endif
+#endif // __M4RI_HAVE_OPENMP
 
 mzd_t *mzd_mul(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
   if(A->ncols != B->nrows)
@@ -470,7 +639,7 @@ mzd_t *mzd_mul(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
     m4ri_die("mzd_mul: cutoff must be >= 0.\n");
 
   if(cutoff == 0) {
-    cutoff = __M4RI_STRASSEN_MUL_CUTOFF;
+    cutoff = m4ri_profile.strassen_mul_cutoff;
   }
 
   cutoff = cutoff / m4ri_radix * m4ri_radix;
@@ -485,11 +654,18 @@ mzd_t *mzd_mul(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
 	     C->nrows, C->ncols, A->nrows, B->ncols);
   }
 
+#if __M4RI_HAVE_OPENMP
+  int const depth = _mzd_strassen_task_depth();
+  if (_mzd_mul_use_tasks(A, B, cutoff, depth)) {
+    return _mzd_mul_tasks_run(C, A, B, cutoff, depth, FALSE);
+  }
+#endif
+
   C = (A == B) ? _mzd_sqr_even(C, A, cutoff) : _mzd_mul_even(C, A, B, cutoff);
   return C;
 }
 
-mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
+mzd_t *_mzd_addmul_even_ws(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff, m4ri_workspace_t *ws) {
   /**
    * \todo make sure not to overwrite crap after ncols and before width * m4ri_radix
    */
@@ -508,13 +684,13 @@ mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
       mzd_t *Abar = mzd_copy(NULL, A);
       mzd_t *Bbar = mzd_copy(NULL, B);
       mzd_t *Cbar = mzd_copy(NULL, C);
-      mzd_addmul_m4rm(Cbar, Abar, Bbar, 0);
+      _mzd_mul_m4rm_ws(Cbar, Abar, Bbar, 0, FALSE, ws);
       mzd_copy(C, Cbar);
       mzd_free(Cbar);
       mzd_free(Bbar);
       mzd_free(Abar);
     } else {
-      mzd_addmul_m4rm(C, A, B, 0);
+      _mzd_mul_m4rm_ws(C, A, B, 0, FALSE, ws);
     }
     return C;
   }
@@ -565,29 +741,29 @@ mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
 
     _mzd_add(S, A22, A21);                   /* 1  S = A22 - A21       */
     _mzd_add(T, B22, B21);                   /* 2  T = B22 - B21       */
-    _mzd_mul_even(U, S, T, cutoff);          /* 3  U = S*T             */
+    _mzd_mul_even_ws(U, S, T, cutoff, ws);      /* 3  U = S*T             */
     _mzd_add(C22, U, C22);                   /* 4  C22 = U + C22       */
     _mzd_add(C12, U, C12);                   /* 5  C12 = U + C12       */
 
-    _mzd_mul_even(U, A12, B21, cutoff);      /* 8  U = A12*B21         */
+    _mzd_mul_even_ws(U, A12, B21, cutoff, ws);  /* 8  U = A12*B21         */
     _mzd_add(C11, U, C11);                   /* 9  C11 = U + C11       */
 
-    _mzd_addmul_even(C11, A11, B11, cutoff); /* 11 C11 = A11*B11 + C11 */
+    _mzd_addmul_even_ws(C11, A11, B11, cutoff, ws); /* 11 C11 = A11*B11 + C11 */
 
     _mzd_add(S, S, A12);                     /* 6  S = S - A12         */
     _mzd_add(T, T, B12);                     /* 7  T = T - B12         */
-    _mzd_addmul_even(U, S, T, cutoff);       /* 10 U = S*T + U         */
+    _mzd_addmul_even_ws(U, S, T, cutoff, ws);   /* 10 U = S*T + U         */
     _mzd_add(C12, C12, U);                   /* 15 C12 = U + C12       */
 
     _mzd_add(S, A11, S);                     /* 12 S = A11 - S         */
-    _mzd_addmul_even(C12, S, B12, cutoff);   /* 14 C12 = S*B12 + C12   */
+    _mzd_addmul_even_ws(C12, S, B12, cutoff, ws); /* 14 C12 = S*B12 + C12   */
 
     _mzd_add(T, B11, T);                     /* 13 T = B11 - T         */
-    _mzd_addmul_even(C21, A21, T, cutoff);   /* 16 C21 = A21*T + C21   */
+    _mzd_addmul_even_ws(C21, A21, T, cutoff, ws); /* 16 C21 = A21*T + C21   */
 
     _mzd_add(S, A22, A12);                   /* 17 S = A22 + A21       */
     _mzd_add(T, B22, B12);                   /* 18 T = B22 + B21       */
-    _mzd_addmul_even(U, S, T, cutoff);       /* 19 U = U - S*T         */
+    _mzd_addmul_even_ws(U, S, T, cutoff, ws);   /* 19 U = U - S*T         */
     _mzd_add(C21, C21, U);                   /* 20 C21 = C21 - U       */
     _mzd_add(C22, C22, U);                   /* 21 C22 = C22 - U       */
 
@@ -612,7 +788,7 @@ mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
      * Compute | C| += |AA| x | B| */
     mzd_t const *B_last_col = mzd_init_window_const(B, 0, nnn, k, n);
     mzd_t *C_last_col = mzd_init_window(C, 0, nnn, m, n);
-    mzd_addmul_m4rm(C_last_col, A, B_last_col, 0);
+    _mzd_mul_m4rm_ws(C_last_col, A, B_last_col, 0, FALSE, ws);
     mzd_free_window((mzd_t*)B_last_col);
     mzd_free_window(C_last_col);
   }
@@ -623,7 +799,7 @@ mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
     mzd_t const *A_last_row = mzd_init_window_const(A, mmm, 0, m, k);
     mzd_t const *B_first_col= mzd_init_window_const(B,   0, 0, k, nnn);
     mzd_t *C_last_row = mzd_init_window(C, mmm, 0, m, nnn);
-    mzd_addmul_m4rm(C_last_row, A_last_row, B_first_col, 0);
+    _mzd_mul_m4rm_ws(C_last_row, A_last_row, B_first_col, 0, FALSE, ws);
     mzd_free_window((mzd_t*)A_last_row);
     mzd_free_window((mzd_t*)B_first_col);
     mzd_free_window(C_last_row);
@@ -635,7 +811,7 @@ mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
     mzd_t const *A_last_col = mzd_init_window_const(A,   0, kkk, mmm, k);
     mzd_t const *B_last_row = mzd_init_window_const(B, kkk,   0,   k, nnn);
     mzd_t *C_bulk = mzd_init_window(C, 0, 0, mmm, nnn);
-    mzd_addmul_m4rm(C_bulk, A_last_col, B_last_row, 0);
+    _mzd_mul_m4rm_ws(C_bulk, A_last_col, B_last_row, 0, FALSE, ws);
     mzd_free_window((mzd_t*)A_last_col);
     mzd_free_window((mzd_t*)B_last_row);
     mzd_free_window(C_bulk);
@@ -645,7 +821,7 @@ mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
   return C;
 }
 
-mzd_t *_mzd_addsqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
+static mzd_t *_mzd_addsqr_even_ws(mzd_t *C, mzd_t const *A, int cutoff, m4ri_workspace_t *ws) {
   /**
    * \todo make sure not to overwrite crap after ncols and before width * m4ri_radix
    */
@@ -661,12 +837,12 @@ mzd_t *_mzd_addsqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
     if(mzd_is_windowed(A)|mzd_is_windowed(C)) {
       mzd_t *Cbar = mzd_copy(NULL, C);
       mzd_t *Abar = mzd_copy(NULL, A);
-      mzd_addmul_m4rm(Cbar, Abar, Abar, 0);
+      _mzd_mul_m4rm_ws(Cbar, Abar, Abar, 0, FALSE, ws);
       mzd_copy(C, Cbar);
       mzd_free(Cbar);
       mzd_free(Abar);
     } else {
-      mzd_addmul_m4rm(C, A, A, 0);
+      _mzd_mul_m4rm_ws(C, A, A, 0, FALSE, ws);
     }
     return C;
   }
@@ -708,26 +884,26 @@ mzd_t *_mzd_addsqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
     mzd_t *U = mzd_init(mmm, mmm);
 
     _mzd_add(S, A22, A21);                   /* 1  S = A22 - A21       */
-    _mzd_sqr_even(U, S, cutoff);             /* 3  U = S^2             */
+    _mzd_sqr_even_ws(U, S, cutoff, ws);         /* 3  U = S^2             */
     _mzd_add(C22, U, C22);                   /* 4  C22 = U + C22       */
     _mzd_add(C12, U, C12);                   /* 5  C12 = U + C12       */
 
-    _mzd_mul_even(U, A12, A21, cutoff);      /* 8  U = A12*A21         */
+    _mzd_mul_even_ws(U, A12, A21, cutoff, ws);  /* 8  U = A12*A21         */
     _mzd_add(C11, U, C11);                   /* 9  C11 = U + C11       */
 
-    _mzd_addsqr_even(C11, A11, cutoff);      /* 11 C11 = A11^2 + C11   */
+    _mzd_addsqr_even_ws(C11, A11, cutoff, ws);  /* 11 C11 = A11^2 + C11   */
 
     _mzd_add(S, S, A12);                     /* 6  S = S + A12         */
-    _mzd_addsqr_even(U, S, cutoff);          /* 10 U = S^2 + U         */
+    _mzd_addsqr_even_ws(U, S, cutoff, ws);      /* 10 U = S^2 + U         */
     _mzd_add(C12, C12, U);                   /* 15 C12 = U + C12       */
 
     _mzd_add(S, A11, S);                     /* 12 S = A11 - S         */
-    _mzd_addmul_even(C12, S, A12, cutoff);   /* 14 C12 = S*B12 + C12   */
+    _mzd_addmul_even_ws(C12, S, A12, cutoff, ws); /* 14 C12 = S*B12 + C12   */
 
-    _mzd_addmul_even(C21, A21, S, cutoff);   /* 16 C21 = A21*T + C21   */
+    _mzd_addmul_even_ws(C21, A21, S, cutoff, ws); /* 16 C21 = A21*T + C21   */
 
     _mzd_add(S, A22, A12);                   /* 17 S = A22 + A21       */
-    _mzd_addsqr_even(U, S, cutoff);          /* 19 U = U - S^2         */
+    _mzd_addsqr_even_ws(U, S, cutoff, ws);      /* 19 U = U - S^2         */
     _mzd_add(C21, C21, U);                   /* 20 C21 = C21 - U3      */
     _mzd_add(C22, C22, U);                   /* 21 C22 = C22 - U3      */
 
@@ -749,7 +925,7 @@ mzd_t *_mzd_addsqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
     {
       mzd_t const *A_last_col = mzd_init_window_const(A, 0, mmm, m, m);
       mzd_t *C_last_col = mzd_init_window(C, 0, mmm, m, m);
-      mzd_addmul_m4rm(C_last_col, A, A_last_col, 0);
+      _mzd_mul_m4rm_ws(C_last_col, A, A_last_col, 0, FALSE, ws);
       mzd_free_window((mzd_t*)A_last_col);
       mzd_free_window(C_last_col);
     }
@@ -759,7 +935,7 @@ mzd_t *_mzd_addsqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
       mzd_t const *A_last_row = mzd_init_window_const(A, mmm, 0, m, m);
       mzd_t const *A_first_col= mzd_init_window_const(A,   0, 0, m, mmm);
       mzd_t *C_last_row = mzd_init_window(C, mmm, 0, m, mmm);
-      mzd_addmul_m4rm(C_last_row, A_last_row, A_first_col, 0);
+      _mzd_mul_m4rm_ws(C_last_row, A_last_row, A_first_col, 0, FALSE, ws);
       mzd_free_window((mzd_t*)A_last_row);
       mzd_free_window((mzd_t*)A_first_col);
       mzd_free_window(C_last_row);
@@ -770,7 +946,7 @@ mzd_t *_mzd_addsqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
       mzd_t const *A_last_col = mzd_init_window_const(A,   0, mmm, mmm, m);
       mzd_t const *A_last_row = mzd_init_window_const(A, mmm,   0,   m, mmm);
       mzd_t *C_bulk = mzd_init_window(C, 0, 0, mmm, mmm);
-      mzd_addmul_m4rm(C_bulk, A_last_col, A_last_row, 0);
+      _mzd_mul_m4rm_ws(C_bulk, A_last_col, A_last_row, 0, FALSE, ws);
       mzd_free_window((mzd_t*)A_last_col);
       mzd_free_window((mzd_t*)A_last_row);
       mzd_free_window(C_bulk);
@@ -781,11 +957,32 @@ mzd_t *_mzd_addsqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
   return C;
 }
 
+mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
+  m4ri_workspace_t *ws = m4ri_workspace_init();
+  _mzd_addmul_even_ws(C, A, B, cutoff, ws);
+  m4ri_workspace_free(ws);
+  return C;
+}
+
+mzd_t *_mzd_addsqr_even(mzd_t *C, mzd_t const *A, int cutoff) {
+  m4ri_workspace_t *ws = m4ri_workspace_init();
+  _mzd_addsqr_even_ws(C, A, cutoff, ws);
+  m4ri_workspace_free(ws);
+  return C;
+}
+
 mzd_t *_mzd_addmul(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
   /**
    * Assumes that B and C are aligned in the same manner (as in a Schur complement)
    */
 
+#if __M4RI_HAVE_OPENMP
+  int const depth = _mzd_strassen_task_depth();
+  if (_mzd_mul_use_tasks(A, B, cutoff, depth)) {
+    return _mzd_mul_tasks_run(C, A, B, cutoff, depth, TRUE);
+  }
+#endif
+
   return (A == B) ? _mzd_addsqr_even(C, A, cutoff) : _mzd_addmul_even(C, A, B, cutoff);
 }
 
@@ -797,7 +994,7 @@ mzd_t *mzd_addmul(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff) {
     m4ri_die("mzd_addmul: cutoff must be >= 0.\n");
 
   if(cutoff == 0) {
-    cutoff = __M4RI_STRASSEN_MUL_CUTOFF;
+    cutoff = m4ri_profile.strassen_mul_cutoff;
   }
 
   cutoff = cutoff / m4ri_radix * m4ri_radix;
@@ -87,6 +87,23 @@ mzd_t *mzd_addmul(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff);
 
 mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff);
 
+/**
+ * \brief Matrix multiplication via the Strassen-Winograd matrix
+ * multiplication algorithm, i.e. compute C = AB, with the tables of a
+ * workspace.
+ *
+ * See _mzd_mul_even(), all M4RM base cases of the recursion share the
+ * Gray code tables of ws.
+ *
+ * \param C Preallocated product matrix.
+ * \param A Input matrix A
+ * \param B Input matrix B
+ * \param cutoff Minimal dimension for Strassen recursion.
+ * \param ws Workspace.
+ */
+
+mzd_t *_mzd_mul_even_ws(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff, m4ri_workspace_t *ws);
+
 /**
  * \brief Matrix multiplication and in-place addition via the
  * Strassen-Winograd matrix multiplication algorithm, i.e. compute 
@@ -108,6 +125,23 @@ mzd_t *_mzd_mul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff);
 
 mzd_t *_mzd_addmul_even(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff);
 
+/**
+ * \brief Matrix multiplication and in-place addition via the
+ * Strassen-Winograd matrix multiplication algorithm, i.e. compute
+ * C = C + AB, with the tables of a workspace.
+ *
+ * See _mzd_addmul_even(), all M4RM base cases of the recursion share the
+ * Gray code tables of ws.
+ *
+ * \param C Preallocated product matrix.
+ * \param A Input matrix A
+ * \param B Input matrix B
+ * \param cutoff Minimal dimension for Strassen recursion.
+ * \param ws Workspace.
+ */
+
+mzd_t *_mzd_addmul_even_ws(mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff, m4ri_workspace_t *ws);
+
 /**
  * \brief Matrix multiplication and in-place addition via the
  * Strassen-Winograd matrix multiplication algorithm, i.e. compute 
@@ -134,4 +168,36 @@ mzd_t *_mzd_addmul (mzd_t *C, mzd_t const *A, mzd_t const *B, int cutoff);
 #define __M4RI_STRASSEN_MUL_CUTOFF MIN(((int)sqrt((double)(4 * __M4RI_CPU_L3_CACHE))), 4096)
 #endif
 
+/**
+ * \brief Set the number of Strassen-Winograd recursion levels which
+ * run their seven products as parallel tasks.
+ *
+ * Each such level holds temporaries as large as its operands A, B
+ * and C together, and its seven products run at the same time, so
+ * with d levels the extra memory is up to (1 + 7/4 + ... +
+ * (7/4)^(d-1)) times the size of A, B and C. Levels below run
+ * sequentially. This has no effect without OpenMP
+ * or when mzd_mul() is called from within a parallel region.
+ *
+ * \param depth Number of levels, 0 disables tasks and a negative
+ * value picks a depth based on the number of threads.
+ */
+
+void mzd_set_strassen_task_depth(int depth);
+
+/**
+ * \brief Return the task depth set by mzd_set_strassen_task_depth().
+ */
+
+int mzd_get_strassen_task_depth(void);
+
+/**
+ * The default task depth for Strassen-Winograd multiplication, a
+ * negative value picks it based on the number of threads.
+ */
+
+#ifndef __M4RI_STRASSEN_TASK_DEPTH
+#define __M4RI_STRASSEN_TASK_DEPTH -1
+#endif
+
 #endif // M4RI_STRASSEN_H
@@ -0,0 +1,335 @@
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "tiled.h"
+#include "brilliantrussian.h"
+#include "profile.h"
+
+mzd_tiled_t *mzd_tiled_init(rci_t r, rci_t c, rci_t tile) {
+  if (tile == 0)
+    tile = __M4RI_TILE_SIZE;
+  if (tile <= 0 || tile % m4ri_radix)
+    m4ri_die("mzd_tiled_init: tile size (%d) must be a positive multiple of %d.\n", tile, m4ri_radix);
+
+  mzd_tiled_t *A = (mzd_tiled_t*)m4ri_mm_malloc(sizeof(mzd_tiled_t));
+  A->nrows = r;
+  A->ncols = c;
+  A->tile = tile;
+  A->mtiles = (r + tile - 1) / tile;
+  A->ntiles = (c + tile - 1) / tile;
+  A->tiles = mzd_init(A->mtiles * A->ntiles * tile, tile);
+  return A;
+}
+
+void mzd_tiled_free(mzd_tiled_t *A) {
+  mzd_free(A->tiles);
+  m4ri_mm_free(A);
+}
+
+mzd_tiled_t *mzd_to_tiled(mzd_tiled_t *T, mzd_t const *A) {
+  if (T == NULL) {
+    T = mzd_tiled_init(A->nrows, A->ncols, 0);
+  } else if (T->nrows != A->nrows || T->ncols != A->ncols) {
+    m4ri_die("mzd_to_tiled: T (%d x %d) has wrong dimensions, expected (%d x %d)\n",
+             T->nrows, T->ncols, A->nrows, A->ncols);
+  }
+
+  wi_t const tw = T->tile / m4ri_radix;
+  int const ntiles = T->mtiles * T->ntiles;
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel for schedule(static) num_threads(m4ri_get_num_threads())
+#endif
+  for (int t = 0; t < ntiles; ++t) {
+    rci_t const r0 = (t / T->ntiles) * T->tile;
+    wi_t const w0 = (t % T->ntiles) * tw;
+    rci_t const nr = MIN(T->tile, A->nrows - r0);
+    wi_t const nw = MIN(tw, A->width - w0);
+    int const last = (w0 + nw == A->width);
+
+    for (rci_t r = 0; r < T->tile; ++r) {
+      word *dst = mzd_row(T->tiles, t * T->tile + r);
+      if (r < nr) {
+        memcpy(dst, mzd_row(A, r0 + r) + w0, nw * sizeof(word));
+        if (last)
+          dst[nw - 1] &= A->high_bitmask;
+        memset(dst + nw, 0, (tw - nw) * sizeof(word));
+      } else {
+        memset(dst, 0, tw * sizeof(word));
+      }
+    }
+  }
+
+  __M4RI_DD_MZD(T->tiles);
+  return T;
+}
+
+mzd_t *mzd_from_tiled(mzd_t *A, mzd_tiled_t const *T) {
+  if (A == NULL) {
+    A = mzd_init_uninitialized(T->nrows, T->ncols);
+  } else if (A->nrows != T->nrows || A->ncols != T->ncols) {
+    m4ri_die("mzd_from_tiled: A (%d x %d) has wrong dimensions, expected (%d x %d)\n",
+             A->nrows, A->ncols, T->nrows, T->ncols);
+  }
+
+  wi_t const tw = T->tile / m4ri_radix;
+  int const ntiles = T->mtiles * T->ntiles;
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel for schedule(static) num_threads(m4ri_get_num_threads())
+#endif
+  for (int t = 0; t < ntiles; ++t) {
+    rci_t const r0 = (t / T->ntiles) * T->tile;
+    wi_t const w0 = (t % T->ntiles) * tw;
+    rci_t const nr = MIN(T->tile, A->nrows - r0);
+    wi_t const nw = MIN(tw, A->width - w0);
+    int const last = (w0 + nw == A->width);
+
+    for (rci_t r = 0; r < nr; ++r) {
+      word const *src = mzd_row(T->tiles, t * T->tile + r);
+      word *dst = mzd_row(A, r0 + r) + w0;
+      if (last) {
+        memcpy(dst, src, (nw - 1) * sizeof(word));
+        dst[nw - 1] ^= (dst[nw - 1] ^ src[nw - 1]) & A->high_bitmask;
+      } else {
+        memcpy(dst, src, nw * sizeof(word));
+      }
+    }
+  }
+
+  __M4RI_DD_MZD(A);
+  return A;
+}
+
+/*
+ * A rectangle of m x n tiles of M starting at tile (i,j).
+ */
+
+typedef struct {
+  mzd_tiled_t *M;
+  rci_t i, j;
+  rci_t m, n;
+} mzd_tiled_view_t;
+
+static inline mzd_tiled_view_t _mzd_tiled_view(mzd_tiled_t const *M, rci_t i, rci_t j, rci_t m, rci_t n) {
+  mzd_tiled_view_t v = {(mzd_tiled_t*)M, i, j, m, n};
+  return v;
+}
+
+static inline mzd_tiled_view_t _mzd_tiled_subview(mzd_tiled_view_t v, rci_t i, rci_t j, rci_t m, rci_t n) {
+  return _mzd_tiled_view(v.M, v.i + i, v.j + j, m, n);
+}
+
+static inline mzd_t *_mzd_tiled_view_tile(mzd_tiled_view_t v, rci_t i, rci_t j) {
+  return mzd_tiled_tile(v.M, v.i + i, v.j + j);
+}
+
+/*
+ * Z = X + Y tile by tile, the padding included.
+ */
+
+static void _mzd_tiled_add(mzd_tiled_view_t Z, mzd_tiled_view_t X, mzd_tiled_view_t Y) {
+  int const ntiles = Z.m * Z.n;
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel for schedule(static) num_threads(m4ri_get_num_threads())
+#endif
+  for (int t = 0; t < ntiles; ++t) {
+    rci_t const i = t / Z.n;
+    rci_t const j = t % Z.n;
+    mzd_t *Zij = _mzd_tiled_view_tile(Z, i, j);
+    mzd_t *Xij = _mzd_tiled_view_tile(X, i, j);
+    mzd_t *Yij = _mzd_tiled_view_tile(Y, i, j);
+    _mzd_add(Zij, Xij, Yij);
+    mzd_free_window(Yij);
+    mzd_free_window(Xij);
+    mzd_free_window(Zij);
+  }
+}
+
+/*
+ * C = AB if clear is TRUE and C = C + AB otherwise, where each tile of
+ * C is accumulated from products of tiles with M4RM.
+ */
+
+static void _mzd_tiled_mul_classic(mzd_tiled_view_t C, mzd_tiled_view_t A, mzd_tiled_view_t B, int clear) {
+  int const ntiles = C.m * C.n;
+
+  /* the zero padding of the tiles of A and B keeps the padding of C zero */
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel num_threads(m4ri_get_num_threads())
+#endif
+  {
+    /* all tile products have the same shape, so each thread allocates its tables once */
+    m4ri_workspace_t *ws = m4ri_workspace_init();
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp for schedule(static)
+#endif
+    for (int t = 0; t < ntiles; ++t) {
+      rci_t const i = t / C.n;
+      rci_t const j = t % C.n;
+      mzd_t *Cij = _mzd_tiled_view_tile(C, i, j);
+      if (clear && A.n == 0)
+        mzd_set_ui(Cij, 0);
+      for (rci_t k = 0; k < A.n; ++k) {
+        mzd_t *Aik = _mzd_tiled_view_tile(A, i, k);
+        mzd_t *Bkj = _mzd_tiled_view_tile(B, k, j);
+        _mzd_mul_m4rm_ws(Cij, Aik, Bkj, 0, clear && k == 0, ws);
+        mzd_free_window(Bkj);
+        mzd_free_window(Aik);
+      }
+      mzd_free_window(Cij);
+    }
+
+    m4ri_workspace_free(ws);
+  }
+}
+
+/*
+ * C = AB with Strassen-Winograd on the grid of tiles, down to at most
+ * 2 * cutoff tiles in some dimension, and _mzd_tiled_mul_classic below.
+ * Padded tiles are zero, so the tiles of A, B and C form block
+ * matrices for which the Winograd identities hold exactly, including
+ * the zero padding of C. The seven products run one after the other
+ * and share four temporaries of a quarter of the size.
+ */
+
+static void _mzd_tiled_mul_strassen(mzd_tiled_view_t C, mzd_tiled_view_t A, mzd_tiled_view_t B, rci_t cutoff) {
+  rci_t const m = A.m;
+  rci_t const k = A.n;
+  rci_t const n = B.n;
+
+  if (m < 2 * cutoff || k < 2 * cutoff || n < 2 * cutoff) {
+    _mzd_tiled_mul_classic(C, A, B, TRUE);
+    return;
+  }
+
+  rci_t const mh = m / 2, kh = k / 2, nh = n / 2;
+  rci_t const tile = A.M->tile;
+
+  mzd_tiled_view_t const A11 = _mzd_tiled_subview(A,  0,  0, mh, kh);
+  mzd_tiled_view_t const A12 = _mzd_tiled_subview(A,  0, kh, mh, kh);
+  mzd_tiled_view_t const A21 = _mzd_tiled_subview(A, mh,  0, mh, kh);
+  mzd_tiled_view_t const A22 = _mzd_tiled_subview(A, mh, kh, mh, kh);
+
+  mzd_tiled_view_t const B11 = _mzd_tiled_subview(B,  0,  0, kh, nh);
+  mzd_tiled_view_t const B12 = _mzd_tiled_subview(B,  0, nh, kh, nh);
+  mzd_tiled_view_t const B21 = _mzd_tiled_subview(B, kh,  0, kh, nh);
+  mzd_tiled_view_t const B22 = _mzd_tiled_subview(B, kh, nh, kh, nh);
+
+  mzd_tiled_view_t const C11 = _mzd_tiled_subview(C,  0,  0, mh, nh);
+  mzd_tiled_view_t const C12 = _mzd_tiled_subview(C,  0, nh, mh, nh);
+  mzd_tiled_view_t const C21 = _mzd_tiled_subview(C, mh,  0, mh, nh);
+  mzd_tiled_view_t const C22 = _mzd_tiled_subview(C, mh, nh, mh, nh);
+
+  mzd_tiled_t *Sm = mzd_tiled_init(mh * tile, kh * tile, tile);
+  mzd_tiled_t *Tm = mzd_tiled_init(kh * tile, nh * tile, tile);
+  mzd_tiled_t *Pm = mzd_tiled_init(mh * tile, nh * tile, tile);
+  mzd_tiled_t *Um = mzd_tiled_init(mh * tile, nh * tile, tile);
+  mzd_tiled_view_t const S = _mzd_tiled_view(Sm, 0, 0, mh, kh);
+  mzd_tiled_view_t const T = _mzd_tiled_view(Tm, 0, 0, kh, nh);
+  mzd_tiled_view_t const P = _mzd_tiled_view(Pm, 0, 0, mh, nh);
+  mzd_tiled_view_t const U = _mzd_tiled_view(Um, 0, 0, mh, nh);
+
+  /* P1 = A11 B11 */
+  _mzd_tiled_mul_strassen(P, A11, B11, cutoff);
+  /* C11 = P1 + P2 */
+  _mzd_tiled_mul_strassen(C11, A12, B21, cutoff);
+  _mzd_tiled_add(C11, C11, P);
+
+  /* U2 = P1 + P6, with S2 = A21 + A22 + A11 and T2 = B11 + B12 + B22 */
+  _mzd_tiled_add(S, A21, A22);
+  _mzd_tiled_add(S, S, A11);
+  _mzd_tiled_add(T, B11, B12);
+  _mzd_tiled_add(T, T, B22);
+  _mzd_tiled_mul_strassen(U, S, T, cutoff);
+  _mzd_tiled_add(U, U, P);
+
+  /* C21 = U2 + P7 + P4, with S3 = A11 + A21, T3 = B12 + B22, T4 = T2 + B21 */
+  _mzd_tiled_add(T, T, B21);
+  _mzd_tiled_mul_strassen(C21, A22, T, cutoff);
+  _mzd_tiled_add(S, A11, A21);
+  _mzd_tiled_add(T, B12, B22);
+  _mzd_tiled_mul_strassen(C22, S, T, cutoff);
+  _mzd_tiled_add(C22, C22, U);             /* C22 = U3 = U2 + P7 */
+  _mzd_tiled_add(C21, C21, C22);
+
+  /* C12 = U2 + P5 + P3, C22 = U3 + P5, with S1 = A21 + A22, T1 = B11 + B12 */
+  _mzd_tiled_add(S, A21, A22);
+  _mzd_tiled_add(T, B11, B12);
+  _mzd_tiled_mul_strassen(P, S, T, cutoff);
+  _mzd_tiled_add(C22, C22, P);
+  _mzd_tiled_add(U, U, P);                 /* U = U2 + P5 */
+  _mzd_tiled_add(S, S, A11);
+  _mzd_tiled_add(S, S, A12);               /* S4 = S2 + A12 */
+  _mzd_tiled_mul_strassen(C12, S, B22, cutoff);
+  _mzd_tiled_add(C12, C12, U);
+
+  mzd_tiled_free(Um);
+  mzd_tiled_free(Pm);
+  mzd_tiled_free(Tm);
+  mzd_tiled_free(Sm);
+
+  /* the tiles left over by odd dimensions */
+  if (n > 2 * nh)
+    _mzd_tiled_mul_classic(_mzd_tiled_subview(C, 0, 2 * nh, m, n - 2 * nh), A,
+                           _mzd_tiled_subview(B, 0, 2 * nh, k, n - 2 * nh), TRUE);
+  if (m > 2 * mh)
+    _mzd_tiled_mul_classic(_mzd_tiled_subview(C, 2 * mh, 0, m - 2 * mh, 2 * nh),
+                           _mzd_tiled_subview(A, 2 * mh, 0, m - 2 * mh, k),
+                           _mzd_tiled_subview(B, 0, 0, k, 2 * nh), TRUE);
+  if (k > 2 * kh)
+    _mzd_tiled_mul_classic(_mzd_tiled_subview(C, 0, 0, 2 * mh, 2 * nh),
+                           _mzd_tiled_subview(A, 0, 2 * kh, 2 * mh, k - 2 * kh),
+                           _mzd_tiled_subview(B, 2 * kh, 0, k - 2 * kh, 2 * nh), FALSE);
+}
+
+mzd_tiled_t *mzd_tiled_mul(mzd_tiled_t *C, mzd_tiled_t const *A, mzd_tiled_t const *B, int cutoff) {
+  if (A->ncols != B->nrows)
+    m4ri_die("mzd_tiled_mul: A ncols (%d) need to match B nrows (%d).\n", A->ncols, B->nrows);
+  if (A->tile != B->tile)
+    m4ri_die("mzd_tiled_mul: A and B have different tile sizes (%d, %d).\n", A->tile, B->tile);
+  if (cutoff < 0)
+    m4ri_die("mzd_tiled_mul: cutoff must be >= 0.\n");
+
+  if (C == NULL) {
+    C = mzd_tiled_init(A->nrows, B->ncols, A->tile);
+  } else if (C->nrows != A->nrows || C->ncols != B->ncols || C->tile != A->tile) {
+    m4ri_die("mzd_tiled_mul: C (%d x %d, tile %d) has wrong dimensions, expected (%d x %d, tile %d)\n",
+             C->nrows, C->ncols, C->tile, A->nrows, B->ncols, A->tile);
+  }
+
+  if (cutoff == 0)
+    cutoff = m4ri_profile.strassen_mul_cutoff;
+
+  _mzd_tiled_mul_strassen(_mzd_tiled_view(C, 0, 0, C->mtiles, C->ntiles),
+                          _mzd_tiled_view(A, 0, 0, A->mtiles, A->ntiles),
+                          _mzd_tiled_view(B, 0, 0, B->mtiles, B->ntiles),
+                          MAX(1, cutoff / A->tile));
+
+  __M4RI_DD_MZD(C->tiles);
+  return C;
+}
@@ -0,0 +1,141 @@
+/**
+ * \file tiled.h
+ * \brief Matrices stored as contiguous square tiles.
+ *
+ * An mzd_t is row major, so a square sub-matrix touches as many far
+ * apart rows as it is high. mzd_tiled_t instead stores each tile x
+ * tile sub-matrix in one contiguous run of memory, such that working
+ * on a tile touches few cache lines and pages.
+ *
+ * The tiles are the rows of a tall mzd_t of width tile, with tile
+ * (i,j) starting at row (i * ntiles + j) * tile. Hence, each tile can
+ * be handed to the usual routines through mzd_tiled_tile(). Tiles at
+ * the right and bottom edges are padded with zeros.
+ */
+
+#ifndef M4RI_TILED_H
+#define M4RI_TILED_H
+
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+#include <m4ri/mzd.h>
+
+/**
+ * The default tile size in bits, a multiple of m4ri_radix.
+ *
+ * M4RM rebuilds its tables for every product of two tiles, hence small
+ * tiles pay more for tables than they gain in locality. A 1024 x 1024
+ * tile takes 128KB, which still fits into L2 on most CPUs.
+ */
+
+#ifndef __M4RI_TILE_SIZE
+#define __M4RI_TILE_SIZE 1024
+#endif
+
+/**
+ * \brief Dense matrix over GF(2) stored as square tiles.
+ */
+
+typedef struct {
+  rci_t nrows;  /*!< Number of rows. */
+  rci_t ncols;  /*!< Number of columns. */
+  rci_t tile;   /*!< Number of rows and columns of each tile. */
+  rci_t mtiles; /*!< Number of tile rows. */
+  rci_t ntiles; /*!< Number of tile columns. */
+  mzd_t *tiles; /*!< (mtiles * ntiles * tile) x tile matrix holding the tiles. */
+} mzd_tiled_t;
+
+/**
+ * \brief Create a new zero r x c tiled matrix.
+ *
+ * \param r Number of rows.
+ * \param c Number of columns.
+ * \param tile Tile size, a multiple of m4ri_radix, or 0 for __M4RI_TILE_SIZE.
+ */
+
+mzd_tiled_t *mzd_tiled_init(rci_t r, rci_t c, rci_t tile);
+
+/**
+ * \brief Free a tiled matrix created with mzd_tiled_init().
+ *
+ * \param A Tiled matrix.
+ */
+
+void mzd_tiled_free(mzd_tiled_t *A);
+
+/**
+ * \brief Return a window onto the tile (i,j) of A.
+ *
+ * The window is tile x tile including the zero padding at the edges,
+ * use mzd_free_window() to free it.
+ *
+ * \param A Tiled matrix.
+ * \param i Tile row.
+ * \param j Tile column.
+ */
+
+static inline mzd_t *mzd_tiled_tile(mzd_tiled_t const *A, rci_t i, rci_t j) {
+  rci_t const first = (i * A->ntiles + j) * A->tile;
+  return mzd_init_window(A->tiles, first, 0, first + A->tile, A->tile);
+}
+
+/**
+ * \brief Copy A into tiled layout.
+ *
+ * \param T Preallocated tiled matrix of matching dimension or NULL.
+ * \param A Matrix.
+ *
+ * \return T or a new tiled matrix with tile size __M4RI_TILE_SIZE.
+ */
+
+mzd_tiled_t *mzd_to_tiled(mzd_tiled_t *T, mzd_t const *A);
+
+/**
+ * \brief Copy a tiled matrix back into row major layout.
+ *
+ * \param A Preallocated matrix of matching dimension or NULL.
+ * \param T Tiled matrix.
+ *
+ * \return A or a new matrix.
+ */
+
+mzd_t *mzd_from_tiled(mzd_t *A, mzd_tiled_t const *T);
+
+/**
+ * \brief Compute C = AB on tiled matrices.
+ *
+ * Strassen-Winograd is applied to the grid of tiles as long as each
+ * dimension has at least two times cutoff / tile tiles. Below, each
+ * tile of C is accumulated from products of tiles with M4RM, with the
+ * tiles of C distributed over threads.
+ *
+ * \param C Preallocated product matrix or NULL.
+ * \param A Input matrix A.
+ * \param B Input matrix B, with the tile size of A.
+ * \param cutoff Minimal dimension in bits for Strassen recursion, 0 for
+ * the default of mzd_mul().
+ *
+ * \return C or a new tiled matrix.
+ */
+
+mzd_tiled_t *mzd_tiled_mul(mzd_tiled_t *C, mzd_tiled_t const *A, mzd_tiled_t const *B, int cutoff);
+
+#endif // M4RI_TILED_H
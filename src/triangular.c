@@ -28,6 +28,82 @@
 #include "strassen.h"
 #include "mzd.h"
 #include "parity.h"
+#include "profile.h"
+
+#if __M4RI_HAVE_OPENMP
+#include <omp.h>
+
+/*
+ * The rows of X in X T = B and the columns of X in T X = B only
+ * depend on the same rows resp. columns of B. Hence, we can split B
+ * into slabs and solve for each slab with the sequential solver in
+ * its own thread. Updates below the top level run inside the
+ * parallel region and thus sequentially, if B is too small to be
+ * split the recursion calls mzd_addmul() which spawns Strassen tasks
+ * instead.
+ */
+
+typedef void (*_mzd_trsm_solver_t)(mzd_t const *, mzd_t *, const int);
+
+/*
+ * Solve T X = B for column slabs of B in parallel. Returns FALSE if
+ * B is too narrow to be split.
+ */
+
+static int _mzd_trsm_left_parallel(mzd_t const *T, mzd_t *B, const int cutoff, _mzd_trsm_solver_t solve) {
+  if (omp_in_parallel() || B->nrows <= m4ri_radix)
+    return FALSE;
+  int const nslabs = MIN(m4ri_get_num_threads(), B->width / __M4RI_TRSM_SLAB_WIDTH);
+  if (nslabs < 2)
+    return FALSE;
+
+  wi_t const slab = (B->width + nslabs - 1) / nslabs;
+
+#pragma omp parallel for schedule(static,1) num_threads(m4ri_get_num_threads())
+  for (int s = 0; s < nslabs; ++s) {
+    rci_t const lowc = s * slab * m4ri_radix;
+    rci_t const highc = MIN(lowc + slab * m4ri_radix, B->ncols);
+    if (lowc < highc) {
+      mzd_t *Bs = mzd_init_window(B, 0, lowc, B->nrows, highc);
+      solve(T, Bs, cutoff);
+      mzd_free_window(Bs);
+    }
+  }
+
+  __M4RI_DD_MZD(B);
+  return TRUE;
+}
+
+/*
+ * Solve X T = B for row slabs of B in parallel. Returns FALSE if B
+ * has too few rows to be split.
+ */
+
+static int _mzd_trsm_right_parallel(mzd_t const *T, mzd_t *B, const int cutoff, _mzd_trsm_solver_t solve) {
+  if (omp_in_parallel() || B->ncols <= m4ri_radix)
+    return FALSE;
+  int const nslabs = MIN(m4ri_get_num_threads(), B->nrows / __M4RI_TRSM_SLAB_ROWS);
+  if (nslabs < 2)
+    return FALSE;
+
+  /* multiples of m4ri_radix rows suit the base cases best */
+  rci_t const slab = ((B->nrows + nslabs - 1) / nslabs + m4ri_radix - 1) / m4ri_radix * m4ri_radix;
+
+#pragma omp parallel for schedule(static,1) num_threads(m4ri_get_num_threads())
+  for (int s = 0; s < nslabs; ++s) {
+    rci_t const lowr = s * slab;
+    rci_t const highr = MIN(lowr + slab, B->nrows);
+    if (lowr < highr) {
+      mzd_t *Bs = mzd_init_window(B, lowr, 0, highr, B->ncols);
+      solve(T, Bs, cutoff);
+      mzd_free_window(Bs);
+    }
+  }
+
+  __M4RI_DD_MZD(B);
+  return TRUE;
+}
+#endif // __M4RI_HAVE_OPENMP
 
 
 /*****************
@@ -58,6 +134,10 @@ void _mzd_trsm_upper_right_trtri(mzd_t const *U, mzd_t *B) {
 }
 
 void _mzd_trsm_upper_right(mzd_t const *U, mzd_t *B, const int cutoff) {
+#if __M4RI_HAVE_OPENMP
+  if (_mzd_trsm_right_parallel(U, B, cutoff, _mzd_trsm_upper_right))
+    return;
+#endif
   rci_t const mb = B->nrows;
   rci_t const nb = B->ncols;
 
@@ -65,7 +145,7 @@ void _mzd_trsm_upper_right(mzd_t const *U, mzd_t *B, const int cutoff) {
     /* base case */
     _mzd_trsm_upper_right_base(U, B);
     return;
-  } else if(nb <= __M4RI_MUL_BLOCKSIZE) {
+  } else if(nb <= m4ri_profile.mul_blocksize) {
     _mzd_trsm_upper_right_trtri(U, B);
     return;
   }
@@ -117,7 +197,7 @@ void _mzd_trsm_upper_right_base(mzd_t const *U, mzd_t *B) {
     /* Computes X_i = B_i + X_{0..i-1} U_{0..i-1,i} */
     register word ucol = 0;
     for(rci_t k = 0; k < i; ++k) {
-      if(__M4RI_GET_BIT(U->rows[k][0], i))
+      if(__M4RI_GET_BIT(mzd_row(U, k)[0], i))
 	__M4RI_SET_BIT(ucol, k);
     }
 
@@ -128,9 +208,11 @@ void _mzd_trsm_upper_right_base(mzd_t const *U, mzd_t *B) {
     for(giantstep = 0; giantstep + m4ri_radix < mb; giantstep += m4ri_radix) {
 #if 0
       for(int babystep = 0; babystep < m4ri_radix; ++babystep) 
-           tmp[babystep] = B->rows[giantstep + babystep][0] & ucol;
+           tmp[babystep] = mzd_row(B, giantstep + babystep)[0] & ucol;
 #else
-      word **src = B->rows + giantstep;
+      word *src[64];
+      for(int babystep = 0; babystep < m4ri_radix; ++babystep)
+        src[babystep] = mzd_row(B, giantstep + babystep);
       tmp[ 0] = src[ 0][0] & ucol, tmp[ 1] = src[ 1][0] & ucol, tmp[ 2] = src[ 2][0] & ucol, tmp[ 3] = src[ 3][0] & ucol;
       tmp[ 4] = src[ 4][0] & ucol, tmp[ 5] = src[ 5][0] & ucol, tmp[ 6] = src[ 6][0] & ucol, tmp[ 7] = src[ 7][0] & ucol;
       tmp[ 8] = src[ 8][0] & ucol, tmp[ 9] = src[ 9][0] & ucol, tmp[10] = src[10][0] & ucol, tmp[11] = src[11][0] & ucol;
@@ -152,7 +234,7 @@ void _mzd_trsm_upper_right_base(mzd_t const *U, mzd_t *B) {
 #if 0
       for(int babystep = 0; babystep < m4ri_radix; ++babystep)
          if(__M4RI_GET_BIT(dotprod, babystep)) 
-           __M4RI_FLIP_BIT(B->rows[giantstep + babystep][0], i);
+           __M4RI_FLIP_BIT(mzd_row(B, giantstep + babystep)[0], i);
 #else
       src[ 0][0] ^= ((dotprod>> 0)&m4ri_one)<<i, src[ 1][0] ^= ((dotprod>> 1)&m4ri_one)<<i, src[ 2][0] ^= ((dotprod>> 2)&m4ri_one)<<i, src[ 3][0] ^= ((dotprod>> 3)&m4ri_one)<<i;
       src[ 4][0] ^= ((dotprod>> 4)&m4ri_one)<<i, src[ 5][0] ^= ((dotprod>> 5)&m4ri_one)<<i, src[ 6][0] ^= ((dotprod>> 6)&m4ri_one)<<i, src[ 7][0] ^= ((dotprod>> 7)&m4ri_one)<<i;
@@ -174,14 +256,14 @@ void _mzd_trsm_upper_right_base(mzd_t const *U, mzd_t *B) {
     }
     
     for(int babystep = 0; giantstep + babystep < mb; ++babystep)
-      tmp[babystep] = B->rows[giantstep + babystep][0] & ucol;
+      tmp[babystep] = mzd_row(B, giantstep + babystep)[0] & ucol;
     for(int babystep = mb - giantstep; babystep < 64; ++babystep)
       tmp[babystep] = 0;
 
     word const dotprod = m4ri_parity64(tmp);
     for(int babystep = 0; giantstep + babystep < mb; ++babystep)
       if(__M4RI_GET_BIT(dotprod, babystep))
-	__M4RI_FLIP_BIT(B->rows[giantstep + babystep][0], i);
+	__M4RI_FLIP_BIT(mzd_row(B, giantstep + babystep)[0], i);
   }
 
   __M4RI_DD_MZD(B);
@@ -204,6 +286,10 @@ void mzd_trsm_lower_right(mzd_t const *L, mzd_t *B, const int cutoff) {
 }
 
 void _mzd_trsm_lower_right(mzd_t const *L, mzd_t *B, const int cutoff) {
+#if __M4RI_HAVE_OPENMP
+  if (_mzd_trsm_right_parallel(L, B, cutoff, _mzd_trsm_lower_right))
+    return;
+#endif
   rci_t const mb = B->nrows;
   rci_t const nb = B->ncols;
 
@@ -258,7 +344,7 @@ void _mzd_trsm_lower_right_base(mzd_t const *L, mzd_t *B) {
     /* Computes X_i = B_i + X_{i+1,n} L_{i+1..n,i} */
     register word ucol = 0;
     for(rci_t k = i + 1; k < nb; ++k) {
-      if(__M4RI_GET_BIT(L->rows[k][0], i))
+      if(__M4RI_GET_BIT(mzd_row(L, k)[0], i))
 	__M4RI_SET_BIT(ucol, k);
     }
 
@@ -268,9 +354,11 @@ void _mzd_trsm_lower_right_base(mzd_t const *L, mzd_t *B) {
     for(giantstep = 0; giantstep + m4ri_radix < mb; giantstep += m4ri_radix) {
 #if 0
       for(int babystep = 0; babystep < m4ri_radix; ++babystep)
-           tmp[babystep] = B->rows[giantstep + babystep][0] & ucol;
+           tmp[babystep] = mzd_row(B, giantstep + babystep)[0] & ucol;
 #else
-      word **src = B->rows + giantstep;
+      word *src[64];
+      for(int babystep = 0; babystep < m4ri_radix; ++babystep)
+        src[babystep] = mzd_row(B, giantstep + babystep);
       tmp[ 0] = src[ 0][0] & ucol, tmp[ 1] = src[ 1][0] & ucol, tmp[ 2] = src[ 2][0] & ucol, tmp[ 3] = src[ 3][0] & ucol;
       tmp[ 4] = src[ 4][0] & ucol, tmp[ 5] = src[ 5][0] & ucol, tmp[ 6] = src[ 6][0] & ucol, tmp[ 7] = src[ 7][0] & ucol;
       tmp[ 8] = src[ 8][0] & ucol, tmp[ 9] = src[ 9][0] & ucol, tmp[10] = src[10][0] & ucol, tmp[11] = src[11][0] & ucol;
@@ -294,7 +382,7 @@ void _mzd_trsm_lower_right_base(mzd_t const *L, mzd_t *B) {
 #if 0
       for(int babystep = 0; babystep < m4ri_radix; ++babystep)
            if(__M4RI_GET_BIT(dotprod, babystep))
-             __M4RI_FLIP_BIT(B->rows[giantstep + babystep][0], i);
+             __M4RI_FLIP_BIT(mzd_row(B, giantstep + babystep)[0], i);
 #else
       src[ 0][0] ^= ((dotprod>> 0)&m4ri_one)<<i, src[ 1][0] ^= ((dotprod>> 1)&m4ri_one)<<i, src[ 2][0] ^= ((dotprod>> 2)&m4ri_one)<<i, src[ 3][0] ^= ((dotprod>> 3)&m4ri_one)<<i;
       src[ 4][0] ^= ((dotprod>> 4)&m4ri_one)<<i, src[ 5][0] ^= ((dotprod>> 5)&m4ri_one)<<i, src[ 6][0] ^= ((dotprod>> 6)&m4ri_one)<<i, src[ 7][0] ^= ((dotprod>> 7)&m4ri_one)<<i;
@@ -315,14 +403,14 @@ void _mzd_trsm_lower_right_base(mzd_t const *L, mzd_t *B) {
 #endif
     }
     for(int babystep = 0; giantstep + babystep < mb; ++babystep)
-      tmp[babystep] = B->rows[giantstep + babystep][0] & ucol;
+      tmp[babystep] = mzd_row(B, giantstep + babystep)[0] & ucol;
     for(int babystep = mb - giantstep; babystep < 64; ++babystep)
       tmp[babystep] = 0;
 
     word const dotprod = m4ri_parity64(tmp);
     for(int babystep = 0; giantstep + babystep < mb; ++babystep)
       if(__M4RI_GET_BIT(dotprod, babystep))
-	__M4RI_FLIP_BIT(B->rows[giantstep + babystep][0], i);
+	__M4RI_FLIP_BIT(mzd_row(B, giantstep + babystep)[0], i);
   }
 
   __M4RI_DD_MZD(B);
@@ -343,6 +431,10 @@ void mzd_trsm_lower_left(mzd_t const *L, mzd_t *B, const int cutoff) {
 }
 
  void _mzd_trsm_lower_left(mzd_t const *L, mzd_t *B, const int cutoff) {
+#if __M4RI_HAVE_OPENMP
+  if (_mzd_trsm_left_parallel(L, B, cutoff, _mzd_trsm_lower_left))
+    return;
+#endif
   rci_t const mb = B->nrows;
   rci_t const nb = B->ncols;
   int const nbrest = nb % m4ri_radix;
@@ -352,18 +444,19 @@ void mzd_trsm_lower_left(mzd_t const *L, mzd_t *B, const int cutoff) {
     word const mask_end = __M4RI_LEFT_BITMASK(nbrest);
     for(rci_t i = 1; i < mb; ++i) {
       /* Computes X_i = B_i + L_{i,0..i-1} X_{0..i-1}  */
-      word *Lrow = L->rows[i];
-      word *Brow = B->rows[i];
+      word *Lrow = mzd_row(L, i);
+      word *Brow = mzd_row(B, i);
 
       for (rci_t k = 0; k < i; ++k) {
         if (__M4RI_GET_BIT(Lrow[0], k)) {
+          word const *Bk = mzd_row(B, k);
           for(wi_t j = 0; j < B->width - 1; ++j)
-            Brow[j] ^= B->rows[k][j];
-          Brow[B->width - 1] ^= B->rows[k][B->width - 1] & mask_end;
+            Brow[j] ^= Bk[j];
+          Brow[B->width - 1] ^= Bk[B->width - 1] & mask_end;
         }
       }
     }
-  } else if(mb <= __M4RI_MUL_BLOCKSIZE) {
+  } else if(mb <= m4ri_profile.mul_blocksize) {
     _mzd_trsm_lower_left_russian(L, B, 0);
   } else {
     rci_t const mb1 = (((mb - 1) / m4ri_radix + 1) >> 1) * m4ri_radix;
@@ -404,6 +497,10 @@ void mzd_trsm_upper_left(mzd_t const *U, mzd_t *B, const int cutoff) {
 }
 
 void _mzd_trsm_upper_left(mzd_t const *U, mzd_t *B, const int cutoff) {
+#if __M4RI_HAVE_OPENMP
+  if (_mzd_trsm_left_parallel(U, B, cutoff, _mzd_trsm_upper_left))
+    return;
+#endif
   rci_t const mb = B->nrows;
   rci_t const nb = B->ncols;
 
@@ -416,18 +513,19 @@ void _mzd_trsm_upper_left(mzd_t const *U, mzd_t *B, const int cutoff) {
     for(rci_t i = mb - 2; i >= 0; --i) {
 
       /* Computes X_i = B_i + U_{i,i+1..mb} X_{i+1..mb}  */
-      word *Urow = U->rows[i];
-      word *Brow = B->rows[i];
+      word *Urow = mzd_row(U, i);
+      word *Brow = mzd_row(B, i);
 
       for(rci_t k = i + 1; k < mb; ++k) {
         if(__M4RI_GET_BIT(Urow[0], k)){
+          word const *Bk = mzd_row(B, k);
           for(wi_t j = 0; j < B->width - 1; ++j)
-            Brow[j] ^= B->rows[k][j];
-          Brow[B->width - 1] ^= B->rows[k][B->width - 1] & mask_end;
+            Brow[j] ^= Bk[j];
+          Brow[B->width - 1] ^= Bk[B->width - 1] & mask_end;
         }
       }
     }
-  } else if(mb <= __M4RI_MUL_BLOCKSIZE) {
+  } else if(mb <= m4ri_profile.mul_blocksize) {
     _mzd_trsm_upper_left_russian(U, B, 0);
   } else {
     rci_t const mb1 = (((mb-1) / m4ri_radix + 1) >> 1) * m4ri_radix;
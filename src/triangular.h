@@ -165,4 +165,22 @@ void _mzd_trsm_upper_left (mzd_t const *U, mzd_t *B, const int cutoff);
 
 mzd_t *mzd_trtri_upper(mzd_t *A);
 
+/**
+ * With OpenMP the left variants split B into this many words per
+ * thread at least and solve for each column slab independently.
+ */
+
+#ifndef __M4RI_TRSM_SLAB_WIDTH
+#define __M4RI_TRSM_SLAB_WIDTH 4
+#endif
+
+/**
+ * With OpenMP the right variants split B into this many rows per
+ * thread at least and solve for each row slab independently.
+ */
+
+#ifndef __M4RI_TRSM_SLAB_ROWS
+#define __M4RI_TRSM_SLAB_ROWS 256
+#endif
+
 #endif // M4RI_TRSM_H
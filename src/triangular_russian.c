@@ -15,8 +15,8 @@ void _mzd_trsm_upper_left_submatrix(mzd_t const *U, mzd_t *B, rci_t const start_
   for (rci_t i = 0; i < k; ++i) {
     for (rci_t j = 0; j < i; ++j) {
       if (mzd_read_bit(U, start_row+(k-i-1), start_row+(k-i)+j)) {
-        word *a = B->rows[start_row+(k-i-1)];
-        word *b = B->rows[start_row+(k-i)+j];
+        word *a = mzd_row(B, start_row+(k-i-1));
+        word *b = mzd_row(B, start_row+(k-i)+j);
 
 	wi_t ii;
         for(ii = 0; ii + 8 <= B->width - 1; ii += 8) {
@@ -52,14 +52,8 @@ void _mzd_trsm_upper_left_russian(mzd_t const *U, mzd_t *B, int k) {
   word mask_end = __M4RI_LEFT_BITMASK(B->ncols % m4ri_radix);
 
   if(k == 0) {
-    /* __M4RI_CPU_L2_CACHE == __M4RI_TRSM_NTABLES * 2^k * B->width * 8 */
-    k = (int)log2((__M4RI_CPU_L2_CACHE/8)/(double)B->width/(double)__M4RI_TRSM_NTABLES);
-
-    rci_t const klog = round(0.75 * log2_floor(MIN(B->nrows, B->ncols)));
-
-    if(klog < k) k = klog;
-    if (k<2)     k = 2;
-    else if(k>8) k = 8;
+    /* on average the tables of rows of B are applied to half of the rows of B */
+    k = m4ri_opt_k_tables(B->nrows / 2, B->nrows, B->width, __M4RI_TRSM_NTABLES, m4ri_radix / __M4RI_TRSM_NTABLES);
   }
 
 
@@ -71,7 +65,7 @@ void _mzd_trsm_upper_left_russian(mzd_t const *U, mzd_t *B, int k) {
 
 #ifdef __M4RI_HAVE_SSE2
   mzd_t *Talign[__M4RI_TRSM_NTABLES];
-  int b_align = (__M4RI_ALIGNMENT(B->rows[0], 16) == 8);
+  int b_align = (__M4RI_ALIGNMENT(mzd_row(B, 0), 16) == 8);
 #endif
 
   for(int i=0; i<__M4RI_TRSM_NTABLES; i++) {
@@ -110,20 +104,20 @@ void _mzd_trsm_upper_left_russian(mzd_t const *U, mzd_t *B, int k) {
       const word *t[__M4RI_TRSM_NTABLES];
 
       switch(__M4RI_TRSM_NTABLES) {
-      case 8: x = L[7][ mzd_read_bits_int(U, j, B->nrows - i - 8*k, k) ]; t[7] = T[7]->rows[x];
-      case 7: x = L[6][ mzd_read_bits_int(U, j, B->nrows - i - 7*k, k) ]; t[6] = T[6]->rows[x];
-      case 6: x = L[5][ mzd_read_bits_int(U, j, B->nrows - i - 6*k, k) ]; t[5] = T[5]->rows[x];
-      case 5: x = L[4][ mzd_read_bits_int(U, j, B->nrows - i - 5*k, k) ]; t[4] = T[4]->rows[x];
-      case 4: x = L[3][ mzd_read_bits_int(U, j, B->nrows - i - 4*k, k) ]; t[3] = T[3]->rows[x];
-      case 3: x = L[2][ mzd_read_bits_int(U, j, B->nrows - i - 3*k, k) ]; t[2] = T[2]->rows[x];
-      case 2: x = L[1][ mzd_read_bits_int(U, j, B->nrows - i - 2*k, k) ]; t[1] = T[1]->rows[x];
-      case 1: x = L[0][ mzd_read_bits_int(U, j, B->nrows - i - 1*k, k) ]; t[0] = T[0]->rows[x];
+      case 8: x = L[7][ mzd_read_bits_int(U, j, B->nrows - i - 8*k, k) ]; t[7] = mzd_row(T[7], x);
+      case 7: x = L[6][ mzd_read_bits_int(U, j, B->nrows - i - 7*k, k) ]; t[6] = mzd_row(T[6], x);
+      case 6: x = L[5][ mzd_read_bits_int(U, j, B->nrows - i - 6*k, k) ]; t[5] = mzd_row(T[5], x);
+      case 5: x = L[4][ mzd_read_bits_int(U, j, B->nrows - i - 5*k, k) ]; t[4] = mzd_row(T[4], x);
+      case 4: x = L[3][ mzd_read_bits_int(U, j, B->nrows - i - 4*k, k) ]; t[3] = mzd_row(T[3], x);
+      case 3: x = L[2][ mzd_read_bits_int(U, j, B->nrows - i - 3*k, k) ]; t[2] = mzd_row(T[2], x);
+      case 2: x = L[1][ mzd_read_bits_int(U, j, B->nrows - i - 2*k, k) ]; t[1] = mzd_row(T[1], x);
+      case 1: x = L[0][ mzd_read_bits_int(U, j, B->nrows - i - 1*k, k) ]; t[0] = mzd_row(T[0], x);
         break;
       default:
         m4ri_die("__M4RI_TRSM_NTABLES must be <= 8 but got %d", __M4RI_TRSM_NTABLES);
       }
 
-      word *b = B->rows[j];
+      word *b = mzd_row(B, j);
       switch(__M4RI_TRSM_NTABLES) {
       case 8: _mzd_combine_8(b, t, wide); break;
       case 7: _mzd_combine_7(b, t, wide); break;
@@ -152,8 +146,8 @@ void _mzd_trsm_upper_left_russian(mzd_t const *U, mzd_t *B, int k) {
     for(rci_t j = 0; j < B->nrows - i - k; ++j) {
       rci_t const x0 = L[0][ mzd_read_bits_int(U, j, B->nrows - i - 1*k, k) ];
 
-      word *b = B->rows[j];
-      word *t0 = T[0]->rows[x0];
+      word *b = mzd_row(B, j);
+      word *t0 = mzd_row(T[0], x0);
 
       for (wi_t ii = 0; ii < wide; ++ii)
         b[ii] ^= t0[ii];
@@ -174,8 +168,8 @@ void _mzd_trsm_lower_left_submatrix(mzd_t const *L, mzd_t *B, rci_t const start_
   for (int i = 0; i < k; ++i) {
     for (int j = 0; j < i; ++j) {
       if (mzd_read_bit(L, start_row+i, start_row+j)) {
-        word *a = B->rows[start_row+i];
-        word *b = B->rows[start_row+j];
+        word *a = mzd_row(B, start_row+i);
+        word *b = mzd_row(B, start_row+j);
 
 	wi_t ii;
         for(ii = 0; ii + 8 <= B->width - 1; ii += 8) {
@@ -209,14 +203,8 @@ void _mzd_trsm_lower_left_russian(mzd_t const *L, mzd_t *B, int k) {
   wi_t const wide = B->width;
 
   if(k == 0) {
-    /* __M4RI_CPU_L2_CACHE == __M4RI_TRSM_NTABLES * 2^k * B->width * 8 */
-    k = (int)log2((__M4RI_CPU_L2_CACHE/8)/(double)B->width/(double)__M4RI_TRSM_NTABLES);
-
-    rci_t const klog = round(0.75 * log2_floor(MIN(B->nrows, B->ncols)));
-
-    if(klog < k) k = klog;
-    if (k<2)     k = 2;
-    else if(k>8) k = 8;
+    /* on average the tables of rows of B are applied to half of the rows of B */
+    k = m4ri_opt_k_tables(B->nrows / 2, B->nrows, B->width, __M4RI_TRSM_NTABLES, m4ri_radix / __M4RI_TRSM_NTABLES);
   }
   int kk = __M4RI_TRSM_NTABLES * k;
   assert(kk <= m4ri_radix);
@@ -227,7 +215,7 @@ void _mzd_trsm_lower_left_russian(mzd_t const *L, mzd_t *B, int k) {
 #ifdef __M4RI_HAVE_SSE2
     /* we make sure that T are aligned as B, this is dirty, we need a function for this */
   mzd_t *Talign[__M4RI_TRSM_NTABLES];
-  int b_align = (__M4RI_ALIGNMENT(B->rows[0], 16) == 8);
+  int b_align = (__M4RI_ALIGNMENT(mzd_row(B, 0), 16) == 8);
 #endif
 
   for(int i=0; i<__M4RI_TRSM_NTABLES; i++) {
@@ -267,20 +255,20 @@ void _mzd_trsm_lower_left_russian(mzd_t const *L, mzd_t *B, int k) {
       word tmp = mzd_read_bits(L, j, i, kk);
 
       switch(__M4RI_TRSM_NTABLES) {
-      case 8: t[7] = T[7]->rows[ J[7][ (tmp >> (7*k)) & mask ] ];
-      case 7: t[6] = T[6]->rows[ J[6][ (tmp >> (6*k)) & mask ] ];
-      case 6: t[5] = T[5]->rows[ J[5][ (tmp >> (5*k)) & mask ] ];
-      case 5: t[4] = T[4]->rows[ J[4][ (tmp >> (4*k)) & mask ] ];
-      case 4: t[3] = T[3]->rows[ J[3][ (tmp >> (3*k)) & mask ] ];
-      case 3: t[2] = T[2]->rows[ J[2][ (tmp >> (2*k)) & mask ] ];
-      case 2: t[1] = T[1]->rows[ J[1][ (tmp >> (1*k)) & mask ] ];
-      case 1: t[0] = T[0]->rows[ J[0][ (tmp >> (0*k)) & mask ] ];
+      case 8: t[7] = mzd_row(T[7], J[7][ (tmp >> (7*k)) & mask ]);
+      case 7: t[6] = mzd_row(T[6], J[6][ (tmp >> (6*k)) & mask ]);
+      case 6: t[5] = mzd_row(T[5], J[5][ (tmp >> (5*k)) & mask ]);
+      case 5: t[4] = mzd_row(T[4], J[4][ (tmp >> (4*k)) & mask ]);
+      case 4: t[3] = mzd_row(T[3], J[3][ (tmp >> (3*k)) & mask ]);
+      case 3: t[2] = mzd_row(T[2], J[2][ (tmp >> (2*k)) & mask ]);
+      case 2: t[1] = mzd_row(T[1], J[1][ (tmp >> (1*k)) & mask ]);
+      case 1: t[0] = mzd_row(T[0], J[0][ (tmp >> (0*k)) & mask ]);
         break;
       default:
         m4ri_die("__M4RI_TRSM_NTABLES must be <= 8 but got %d", __M4RI_TRSM_NTABLES);
       }
 
-      word *b = B->rows[j];
+      word *b = mzd_row(B, j);
       switch(__M4RI_TRSM_NTABLES) {
       case 8: _mzd_combine_8(b, t, wide); break;
       case 7: _mzd_combine_7(b, t, wide); break;
@@ -309,8 +297,8 @@ void _mzd_trsm_lower_left_russian(mzd_t const *L, mzd_t *B, int k) {
     for(rci_t j = i+k; j < L->nrows; ++j) {
       rci_t const x0 = J[0][ mzd_read_bits_int(L, j, i, k) ];
 
-      word *b = B->rows[j];
-      word *t0 = T[0]->rows[x0];
+      word *b = mzd_row(B, j);
+      word *t0 = mzd_row(T[0], x0);
 
       for (wi_t ii = 0; ii < wide; ++ii)
         b[ii] ^= t0[ii];
@@ -346,14 +334,14 @@ void mzd_make_table_trtri(mzd_t const *M, rci_t r, rci_t c, int k, ple_table_t *
 
   word *ti, *ti1, *m;
 
-  ti1 = T->rows[0] + blockoffset;
+  ti1 = mzd_row(T, 0) + blockoffset;
   ti = ti1 + T->rowstride;
 
   L[0] = 0;
   for (int i = 1; i < twokay; ++i) {
-    T->rows[i][blockoffset0] = 0; /* we make sure that we can safely add from blockoffset0 */
+    mzd_row(T, i)[blockoffset0] = 0; /* we make sure that we can safely add from blockoffset0 */
     rci_t rowneeded = r + m4ri_codebook[k]->inc[i - 1];
-    m = M->rows[rowneeded] + blockoffset;
+    m = mzd_row(M, rowneeded) + blockoffset;
 
     wi_t n = count;
     switch (entry_point) {
@@ -393,11 +381,7 @@ mzd_t *mzd_trtri_upper_russian(mzd_t *A, int k) {
   assert(A->nrows == A->ncols);
 
   if (k == 0) {
-    k = m4ri_opt_k(A->nrows, A->ncols, 0);
-    if (k >= 7)
-      k = 7;
-    if (0.75 * __M4RI_TWOPOW(k) *A->ncols > __M4RI_CPU_L3_CACHE / 2.0)
-      k -= 1;
+    k = m4ri_opt_k_tables(A->nrows / 2, A->ncols, (A->width + 1) / 2, __M4RI_TRTRI_NTABLES, 7);
   }
 
   const int kk = __M4RI_TRTRI_NTABLES*k;
@@ -0,0 +1,124 @@
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "workspace.h"
+
+m4ri_workspace_t *m4ri_workspace_init(void) {
+  m4ri_workspace_t *ws = (m4ri_workspace_t*)m4ri_mm_malloc(sizeof(m4ri_workspace_t));
+  memset(ws, 0, sizeof(m4ri_workspace_t));
+  for(int z = 0; z < __M4RI_WORKSPACE_NTABLES; ++z)
+    ws->ple_ptr[z] = &ws->ple[z];
+  return ws;
+}
+
+static void _m4ri_workspace_free_windows(m4ri_workspace_t *ws) {
+  if (ws->T[0] == NULL)
+    return;
+  for(int z = 0; z < __M4RI_WORKSPACE_NTABLES; ++z) {
+    mzd_free_window(ws->T[z]);
+    ws->T[z] = NULL;
+  }
+}
+
+static void _m4ri_workspace_free_storage(m4ri_workspace_t *ws) {
+  _m4ri_workspace_free_windows(ws);
+  if (ws->S[0] == NULL)
+    return;
+  for(int z = 0; z < __M4RI_WORKSPACE_NTABLES; ++z) {
+    mzd_free(ws->S[z]);
+    ws->S[z] = NULL;
+  }
+  /* the lookups of all tables share one allocation each */
+  m4ri_mm_free(ws->L[0]);
+  if (ws->E[0] != NULL) {
+    m4ri_mm_free(ws->E[0]);
+    m4ri_mm_free(ws->B[0]);
+    for(int z = 0; z < __M4RI_WORKSPACE_NTABLES; ++z) {
+      ws->E[z] = NULL;
+      ws->B[z] = NULL;
+    }
+  }
+  ws->k = 0;
+  ws->ncols = 0;
+}
+
+void m4ri_workspace_free(m4ri_workspace_t *ws) {
+  if (ws == NULL)
+    return;
+  _m4ri_workspace_free_storage(ws);
+  m4ri_mm_free(ws);
+}
+
+mzd_t **m4ri_workspace_tables(m4ri_workspace_t *ws, int k, rci_t ncols, rci_t offset) {
+  if (k < 0)
+    m4ri_die("m4ri_workspace_tables: k (%d) must not be negative.\n", k);
+  if (offset != 0 && offset != m4ri_radix)
+    m4ri_die("m4ri_workspace_tables: offset (%d) must be 0 or %d.\n", offset, m4ri_radix);
+
+  if (ws->S[0] == NULL || k > ws->k || ncols > ws->ncols) {
+    /* we only grow, such that alternating shapes do not reallocate */
+    int const sk = MAX(k, ws->k);
+    rci_t const sncols = MAX(ncols, ws->ncols);
+    _m4ri_workspace_free_storage(ws);
+    rci_t *L = (rci_t*)m4ri_mm_malloc(__M4RI_WORKSPACE_NTABLES * __M4RI_TWOPOW(sk) * sizeof(rci_t));
+    for(int z = 0; z < __M4RI_WORKSPACE_NTABLES; ++z) {
+      ws->S[z] = mzd_init(__M4RI_TWOPOW(sk), sncols + m4ri_radix);
+      ws->L[z] = L + z * __M4RI_TWOPOW(sk);
+    }
+    ws->k = sk;
+    ws->ncols = sncols;
+  }
+
+  if (ws->T[0] == NULL || ws->T_k != k || ws->T_ncols != ncols || ws->T_offset != offset) {
+    _m4ri_workspace_free_windows(ws);
+    for(int z = 0; z < __M4RI_WORKSPACE_NTABLES; ++z)
+      ws->T[z] = mzd_init_window(ws->S[z], 0, offset, __M4RI_TWOPOW(k), offset + ncols);
+    ws->T_k = k;
+    ws->T_ncols = ncols;
+    ws->T_offset = offset;
+  }
+  return ws->T;
+}
+
+ple_table_t **m4ri_workspace_ple_tables(m4ri_workspace_t *ws, int k, rci_t ncols) {
+  mzd_t **T = m4ri_workspace_tables(ws, k, ncols, 0);
+  if (ws->E[0] == NULL) {
+    /* only PLE needs these, so they are allocated on first use */
+    rci_t *E = (rci_t*)m4ri_mm_malloc(__M4RI_WORKSPACE_NTABLES * __M4RI_TWOPOW(ws->k) * sizeof(rci_t));
+    word  *B = (word*)m4ri_mm_malloc(__M4RI_WORKSPACE_NTABLES * __M4RI_TWOPOW(ws->k) * sizeof(word));
+    for(int z = 0; z < __M4RI_WORKSPACE_NTABLES; ++z) {
+      ws->E[z] = E + z * __M4RI_TWOPOW(ws->k);
+      ws->B[z] = B + z * __M4RI_TWOPOW(ws->k);
+    }
+  }
+  for(int z = 0; z < __M4RI_WORKSPACE_NTABLES; ++z) {
+    ws->ple[z].T = T[z];
+    ws->ple[z].M = ws->L[z];
+    ws->ple[z].E = ws->E[z];
+    ws->ple[z].B = ws->B[z];
+  }
+  return ws->ple_ptr;
+}
@@ -0,0 +1,125 @@
+/**
+ * \file workspace.h
+ * \brief Reusable lookup tables for the Method of the Four Russians.
+ *
+ * M4RM multiplication, M4RI elimination and PLE decomposition all
+ * work with a handful of Gray code tables of 2^k rows. Allocating
+ * these on every call is cheap for large inputs but dominates when
+ * many small problems are solved, e.g. at the leaves of Strassen or
+ * PLE recursion. A workspace holds the tables of one caller and only
+ * grows them, such that repeated calls do not touch the allocator.
+ *
+ * A workspace must not be used by more than one thread at a time.
+ */
+
+#ifndef M4RI_WORKSPACE_H
+#define M4RI_WORKSPACE_H
+
+/*******************************************************************
+*
+*                 M4RI:  Linear Algebra over GF(2)
+*
+*    Copyright (C) 2026 The M4RI contributors
+*
+*  Distributed under the terms of the GNU General Public License (GPL)
+*  version 2 or higher.
+*
+*    This code is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*    General Public License for more details.
+*
+*  The full text of the GPL is available at:
+*
+*                  http://www.gnu.org/licenses/
+*
+********************************************************************/
+
+#include <m4ri/mzd.h>
+
+/**
+ * Maximal number of tables in a workspace.
+ */
+
+#define __M4RI_WORKSPACE_NTABLES 8
+
+/**
+ * \brief PLE Elimination Tables
+ */
+typedef struct {
+  mzd_t *T; /*< the actual table with 2^k entries */
+  rci_t *M; /*< lookup for multiplication */
+  rci_t *E; /*< lookup for elimination */
+  word  *B; /*< cache of first 64 entries in each row */
+} ple_table_t;
+
+/**
+ * \brief Lookup tables shared by consecutive M4RM, M4RI and PLE calls.
+ *
+ * The tables handed out are windows of exactly the requested number
+ * of columns onto storage of at least 2^k rows and ncols + m4ri_radix
+ * columns. Row 0 of the storage is never written and hence stays
+ * zero as the Gray code tables require.
+ */
+
+typedef struct {
+  int k;                                      /*!< log2 of the number of rows of the storage. */
+  rci_t ncols;                                /*!< Number of columns of the storage, excluding the alignment word. */
+  mzd_t *S[__M4RI_WORKSPACE_NTABLES];         /*!< Storage of the tables. */
+  rci_t *L[__M4RI_WORKSPACE_NTABLES];         /*!< Gray code lookups, also the PLE multiplication lookups. */
+  rci_t *E[__M4RI_WORKSPACE_NTABLES];         /*!< PLE elimination lookups or NULL. */
+  word  *B[__M4RI_WORKSPACE_NTABLES];         /*!< PLE caches of the first word of each row or NULL. */
+
+  mzd_t *T[__M4RI_WORKSPACE_NTABLES];         /*!< Windows onto S handed out last. */
+  int    T_k;                                 /*!< log2 of the number of rows of T. */
+  rci_t  T_ncols;                             /*!< Number of columns of T. */
+  rci_t  T_offset;                            /*!< Column of S where T starts. */
+
+  ple_table_t  ple[__M4RI_WORKSPACE_NTABLES]; /*!< PLE tables over T. */
+  ple_table_t *ple_ptr[__M4RI_WORKSPACE_NTABLES]; /*!< Pointers to ple. */
+} m4ri_workspace_t;
+
+/**
+ * \brief Create an empty workspace.
+ *
+ * Tables are allocated on first use.
+ */
+
+m4ri_workspace_t *m4ri_workspace_init(void);
+
+/**
+ * \brief Free a workspace and all its tables.
+ *
+ * \param ws Workspace or NULL.
+ */
+
+void m4ri_workspace_free(m4ri_workspace_t *ws);
+
+/**
+ * \brief Return __M4RI_WORKSPACE_NTABLES tables of 2^k rows and ncols columns.
+ *
+ * The lookups ws->L[z] of 2^k entries belong to the table z. The
+ * tables stay valid until the next call on ws and their contents are
+ * undefined except for row 0, which is zero.
+ *
+ * \param ws Workspace.
+ * \param k log2 of the number of rows.
+ * \param ncols Number of columns.
+ * \param offset Column of the storage the tables start at, 0 or m4ri_radix.
+ */
+
+mzd_t **m4ri_workspace_tables(m4ri_workspace_t *ws, int k, rci_t ncols, rci_t offset);
+
+/**
+ * \brief Return __M4RI_WORKSPACE_NTABLES PLE tables of 2^k rows and ncols columns.
+ *
+ * The tables stay valid until the next call on ws.
+ *
+ * \param ws Workspace.
+ * \param k log2 of the number of rows (0 < k <= 8).
+ * \param ncols Number of columns.
+ */
+
+ple_table_t **m4ri_workspace_ple_tables(m4ri_workspace_t *ws, int k, rci_t ncols);
+
+#endif // M4RI_WORKSPACE_H
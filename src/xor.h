@@ -35,6 +35,10 @@
 #include <emmintrin.h>
 #endif
 
+#if __M4RI_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
 #include <m4ri/misc.h>
 
 
@@ -53,6 +57,15 @@ static inline void _mzd_combine(word *c, word const *t1, wi_t wide_in) {
     wide--;
   }
 
+#if __M4RI_HAVE_AVX2
+#if __M4RI_HAVE_AVX512F
+  for(; wide >= 8; wide -= 8, c += 8, t1 += 8)
+    _mm512_storeu_si512((void*)c, _mm512_xor_si512(_mm512_loadu_si512((void const*)c), _mm512_loadu_si512((void const*)t1)));
+#endif // __M4RI_HAVE_AVX512F
+  for(; wide >= 4; wide -= 4, c += 4, t1 += 4)
+    _mm256_storeu_si256((__m256i*)c, _mm256_xor_si256(_mm256_loadu_si256((__m256i const*)c), _mm256_loadu_si256((__m256i const*)t1)));
+#endif // __M4RI_HAVE_AVX2
+
   __m128i *__c = (__m128i*)c;
   __m128i *__t1 = (__m128i*)t1;
   const __m128i *eof = (__m128i*)((unsigned long)(c + wide) & ~0xFUL);
@@ -1,6 +1,75 @@
 #include <m4ri/m4ri_config.h>
 #include <m4ri/misc.h>
 
+#if __M4RI_HAVE_AVX2
+
+/**
+ * Compute c[i] += sum(t[j][i], 0 <= j < N) for as many leading words
+ * as fit into full 512-bit (AVX-512) or 256-bit (AVX2) registers.
+ *
+ * The pointers t[j] are advanced past the processed words.
+ *
+ * \return the number of words processed, always a multiple of 4.
+ *
+ * \note Only 16-byte alignment is guaranteed by our callers, so we use
+ * unaligned loads and stores.
+ */
+
+static inline wi_t __M4RI_TEMPLATE_NAME(_mzd_combine_wide)(word *m, word const *t[N], wi_t wide) {
+  wi_t i = 0;
+
+#if __M4RI_HAVE_AVX512F
+  __m512i zmm0;
+  for(; i + 8 <= wide; i += 8) {
+    zmm0 = _mm512_loadu_si512((void const*)(m + i));
+    /* vpternlogq with immediate 0x96 computes a ^ b ^ c */
+    switch(N) {  /* we rely on the compiler to optimise this switch away, it reads nicer than #if */
+    case 8: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_loadu_si512((void const*)(t[N-8] + i)), _mm512_loadu_si512((void const*)(t[N-7] + i)), 0x96);
+    case 6: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_loadu_si512((void const*)(t[N-6] + i)), _mm512_loadu_si512((void const*)(t[N-5] + i)), 0x96);
+    case 4: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_loadu_si512((void const*)(t[N-4] + i)), _mm512_loadu_si512((void const*)(t[N-3] + i)), 0x96);
+    case 2: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_loadu_si512((void const*)(t[N-2] + i)), _mm512_loadu_si512((void const*)(t[N-1] + i)), 0x96);
+      break;
+    case 7: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_loadu_si512((void const*)(t[N-7] + i)), _mm512_loadu_si512((void const*)(t[N-6] + i)), 0x96);
+    case 5: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_loadu_si512((void const*)(t[N-5] + i)), _mm512_loadu_si512((void const*)(t[N-4] + i)), 0x96);
+    case 3: zmm0 = _mm512_ternarylogic_epi64(zmm0, _mm512_loadu_si512((void const*)(t[N-3] + i)), _mm512_loadu_si512((void const*)(t[N-2] + i)), 0x96);
+    case 1: zmm0 = _mm512_xor_si512(zmm0, _mm512_loadu_si512((void const*)(t[N-1] + i)));
+    };
+    _mm512_storeu_si512((void*)(m + i), zmm0);
+  }
+#endif // __M4RI_HAVE_AVX512F
+
+  __m256i ymm0, ymm1;
+  for(; i + 4 <= wide; i += 4) {
+    ymm0 = _mm256_xor_si256(_mm256_loadu_si256((__m256i const*)(m + i)), _mm256_loadu_si256((__m256i const*)(t[0] + i)));
+    ymm1 = _mm256_setzero_si256();
+    switch(N) {  /* we rely on the compiler to optimise this switch away, it reads nicer than #if */
+    case 8: ymm1 = _mm256_xor_si256(ymm1, _mm256_loadu_si256((__m256i const*)(t[N-7] + i)));
+    case 7: ymm0 = _mm256_xor_si256(ymm0, _mm256_loadu_si256((__m256i const*)(t[N-6] + i)));
+    case 6: ymm1 = _mm256_xor_si256(ymm1, _mm256_loadu_si256((__m256i const*)(t[N-5] + i)));
+    case 5: ymm0 = _mm256_xor_si256(ymm0, _mm256_loadu_si256((__m256i const*)(t[N-4] + i)));
+    case 4: ymm1 = _mm256_xor_si256(ymm1, _mm256_loadu_si256((__m256i const*)(t[N-3] + i)));
+    case 3: ymm0 = _mm256_xor_si256(ymm0, _mm256_loadu_si256((__m256i const*)(t[N-2] + i)));
+    case 2: ymm1 = _mm256_xor_si256(ymm1, _mm256_loadu_si256((__m256i const*)(t[N-1] + i)));
+    case 1: break;
+    };
+    _mm256_storeu_si256((__m256i*)(m + i), _mm256_xor_si256(ymm0, ymm1));
+  }
+
+  switch(N) {  /* we rely on the compiler to optimise this switch away, it reads nicer than #if */
+  case 8: t[N-8] += i;
+  case 7: t[N-7] += i;
+  case 6: t[N-6] += i;
+  case 5: t[N-5] += i;
+  case 4: t[N-4] += i;
+  case 3: t[N-3] += i;
+  case 2: t[N-2] += i;
+  case 1: t[N-1] += i;
+  };
+  return i;
+}
+
+#endif // __M4RI_HAVE_AVX2
+
 /**
  * Compute c[i] += sum(t[j][i], 0 <= j < N) for 0 <= i < wide
  *
@@ -41,6 +110,14 @@ static inline void __M4RI_TEMPLATE_NAME(_mzd_combine)(word *m, word const *t[N],
     wide--;
   }
 
+#if __M4RI_HAVE_AVX2
+  {
+    wi_t const done = __M4RI_TEMPLATE_NAME(_mzd_combine_wide)(m, t, wide);
+    m += done;
+    wide -= done;
+  }
+#endif // __M4RI_HAVE_AVX2
+
   __m128i *m__ = (__m128i*)m;
   __m128i *t__[N];
 
@@ -182,6 +259,14 @@ static inline void __M4RI_TEMPLATE_NAME(_mzd_combine_u)(word *m, word const *t[N
   };
   wide--;
 
+#if __M4RI_HAVE_AVX2
+  {
+    wi_t const done = __M4RI_TEMPLATE_NAME(_mzd_combine_wide)(m, t, wide);
+    m += done;
+    wide -= done;
+  }
+#endif // __M4RI_HAVE_AVX2
+
   __m128i *m__ = (__m128i*)m;
   __m128i *t__[N];
 
@@ -284,6 +369,14 @@ static inline void __M4RI_TEMPLATE_NAME(_mzd_combine_a)(word *m, word const *t[N
   case 1: assert(__M4RI_ALIGNMENT(m,16) == __M4RI_ALIGNMENT(t[0],16));
   };
 
+#if __M4RI_HAVE_AVX2
+  {
+    wi_t const done = __M4RI_TEMPLATE_NAME(_mzd_combine_wide)(m, t, wide);
+    m += done;
+    wide -= done;
+  }
+#endif // __M4RI_HAVE_AVX2
+
   __m128i *m__ = (__m128i*)m;
   __m128i *t__[N];
 
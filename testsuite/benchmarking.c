@@ -749,8 +749,8 @@ void bench_randomize(mzd_t *A) {
   word const mask_end = __M4RI_LEFT_BITMASK(A->ncols % m4ri_radix);
   for(rci_t i = 0; i < A->nrows; ++i) {
     for(wi_t j = 0; j < width; ++j)
-      A->rows[i][j] = bench_random_word();
-    A->rows[i][width] ^= (A->rows[i][width] ^ bench_random_word()) & mask_end;
+      mzd_row(A, i)[j] = bench_random_word();
+    mzd_row(A, i)[width] ^= (mzd_row(A, i)[width] ^ bench_random_word()) & mask_end;
   }
 }
 
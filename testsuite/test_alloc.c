@@ -0,0 +1,278 @@
+#include <m4ri/config.h>
+#include <stdlib.h>
+#include <m4ri/m4ri.h>
+#include <m4ri/mmc.h>
+
+int test_mmc(void) {
+  int ret = 0;
+  printf("mmc: ");
+
+  for(size_t size = 1; size < (1<<20); size += 1 + size / 7) {
+    size_t const c = m4ri_mmc_size_class(size);
+    ret += (c < size) || (size > 64 && 4 * c > 5 * size + 4 * 64) || (m4ri_mmc_size_class(c) != c);
+  }
+
+  m4ri_mmc_stats_t before, after;
+  m4ri_mmc_get_stats(&before);
+
+  /* nearby sizes share a size class and hence a cached block */
+  void *a = m4ri_mmc_malloc(10000);
+  m4ri_mmc_free(a, 10000);
+  void *b = m4ri_mmc_malloc(10001);
+  ret += (a != b);
+  m4ri_mmc_free(b, 10001);
+
+  /* overflow the thread cache into the depot and back */
+  void *blocks[3 * __M4RI_MMC_NBLOCKS];
+  for(int i = 0; i < 3 * __M4RI_MMC_NBLOCKS; i++)
+    blocks[i] = m4ri_mmc_malloc(4096 * (i + 1));
+  for(int i = 0; i < 3 * __M4RI_MMC_NBLOCKS; i++)
+    m4ri_mmc_free(blocks[i], 4096 * (i + 1));
+  for(int i = 0; i < 3 * __M4RI_MMC_NBLOCKS; i++)
+    blocks[i] = m4ri_mmc_malloc(4096 * (i + 1));
+  for(int i = 0; i < 3 * __M4RI_MMC_NBLOCKS; i++)
+    m4ri_mmc_free(blocks[i], 4096 * (i + 1));
+
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel for schedule(static,1)
+#endif
+  for(int i = 0; i < 64; i++) {
+    mzd_t *A = mzd_init(64 + i, 64 + i);
+    mzd_randomize(A);
+    mzd_free(A);
+  }
+
+  m4ri_mmc_get_stats(&after);
+  ret += (after.hits < before.hits + 1 + 3 * __M4RI_MMC_NBLOCKS);
+  ret += (after.depot_hits <= before.depot_hits);
+  ret += (after.blocks_held == 0 || after.bytes_held == 0);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+#if defined(__M4RI_ENABLE_MMC) && __M4RI_HAVE_THREAD_LOCAL && defined(HAVE_PTHREAD_KEY_CREATE)
+#include <pthread.h>
+
+static void *mmc_thread(void *arg) {
+  size_t const size = *(size_t*)arg;
+  m4ri_mmc_free(m4ri_mmc_malloc(size), size);
+  return NULL;
+}
+
+int test_mmc_threads(void) {
+  int ret = 0;
+  printf("mmc threads: ");
+
+  m4ri_mmc_stats_t before, after;
+  m4ri_mmc_cleanup();
+
+  /* the thread cache holds at most __M4RI_MMC_TCACHE_MAX_BYTES, the rest goes to the depot */
+  size_t const big = 6 * (__M4RI_MMC_TCACHE_MAX_BYTES / 10);
+  void *blocks[3];
+  for(int i = 0; i < 3; i++)
+    blocks[i] = m4ri_mmc_malloc(big);
+  for(int i = 0; i < 3; i++)
+    m4ri_mmc_free(blocks[i], big);
+  m4ri_mmc_get_stats(&before);
+  pthread_t t;
+  size_t size = big;
+  ret += (pthread_create(&t, NULL, mmc_thread, &size) != 0);
+  pthread_join(t, NULL);
+  m4ri_mmc_get_stats(&after);
+  ret += (after.depot_hits < before.depot_hits + 1);
+  m4ri_mmc_cleanup();
+
+  /* the cache of an exited thread is returned to the depot, idle OpenMP threads may still hold blocks */
+  m4ri_mmc_stats_t base;
+  m4ri_mmc_get_stats(&base);
+  size = 777777;
+  ret += (pthread_create(&t, NULL, mmc_thread, &size) != 0);
+  pthread_join(t, NULL);
+  m4ri_mmc_get_stats(&before);
+  ret += (before.blocks_held != base.blocks_held + 1);
+  void *a = m4ri_mmc_malloc(size);
+  m4ri_mmc_get_stats(&after);
+  ret += (after.depot_hits != before.depot_hits + 1);
+  m4ri_mmc_free(a, size);
+  m4ri_mmc_cleanup();
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+#endif
+
+int test_mzd_t_pool(void) {
+  int ret = 0;
+  printf("mzd_t pool: ");
+
+  mzd_t *A = mzd_init(256, 256);
+  mzd_randomize(A);
+
+  /* create and free many more headers than fit into a single cache, from several threads */
+#if __M4RI_HAVE_OPENMP
+#pragma omp parallel for schedule(static,1) reduction(+:ret)
+#endif
+  for(int i = 0; i < 16; i++) {
+    mzd_t *W[200];
+    for(int j = 0; j < 200; j++)
+      W[j] = mzd_init_window(A, j % 64, 0, 64 + j % 64, 128);
+    for(int j = 0; j < 200; j++) {
+      ret += (W[j]->nrows != 64 || W[j]->ncols != 128);
+      ret += (mzd_read_bit(W[j], 0, 5) != mzd_read_bit(A, j % 64, 5));
+    }
+    for(int j = 0; j < 200; j++)
+      mzd_free(W[j]);
+  }
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int test_alloc_policy(int policy) {
+  int ret = 0;
+  printf("alloc policy: %d", policy);
+
+  mzd_t *A = mzd_init_policy(1000, 20000, policy);
+  ret += !mzd_is_zero(A);
+  if (A->flags & mzd_flag_mapped_blocks)
+    ret += ((uintptr_t)A->blocks[0].begin % __M4RI_HUGEPAGE_SIZE) != 0;
+  mzd_randomize(A);
+
+  /* the global policy is picked up by mzd_init */
+  int const old = mzd_get_alloc_policy();
+  mzd_set_alloc_policy(policy);
+  mzd_t *B = mzd_copy(NULL, A);
+  mzd_set_alloc_policy(old);
+  ret += (A->flags & mzd_flag_mapped_blocks) != (B->flags & mzd_flag_mapped_blocks);
+  ret += !mzd_equal(A, B);
+
+  mzd_t *W = mzd_init_window(B, 64, 64, 640, 6400);
+  mzd_set_ui(W, 0);
+  mzd_free(W);
+  ret += mzd_equal(A, B);
+
+  mzd_free(B);
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int test_init_uninitialized(rci_t m, rci_t n) {
+  int ret = 0;
+  printf("init uninitialized: m: %4d, n: %4d", m, n);
+
+  /* hand a dirty block back to the memory manager first */
+  mzd_t *D = mzd_init(m, n);
+  mzd_set_ui(D, 1);
+  mzd_randomize(D);
+  mzd_free(D);
+
+  mzd_t *A = mzd_init_uninitialized(m, n);
+  for(rci_t i = 0; i < m; i++) {
+    ret += (mzd_row(A, i)[A->width - 1] & ~A->high_bitmask) != 0;
+    for(wi_t j = A->width; j < A->rowstride; j++)
+      ret += mzd_row(A, i)[j] != 0;
+  }
+  mzd_randomize(A);
+
+  mzd_t *B = mzd_copy(NULL, A);
+  ret += !mzd_equal(A, B);
+  mzd_t *AT = mzd_transpose(NULL, A);
+  mzd_t *ATT = mzd_transpose(NULL, AT);
+  ret += !mzd_equal(A, ATT);
+
+  mzd_t *C0 = mzd_mul_naive(NULL, A, AT);
+  mzd_t *C1 = mzd_mul_m4rm(NULL, A, AT, 0);
+  ret += !mzd_equal(C0, C1);
+
+  mzd_free(C1);
+  mzd_free(C0);
+  mzd_free(ATT);
+  mzd_free(AT);
+  mzd_free(B);
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int test_mzd_rows(rci_t m, rci_t n) {
+  int ret = 0;
+  printf("mzd_rows: m: %4d, n: %4d", m, n);
+
+  mzd_t *A = mzd_init(m, n);
+  mzd_randomize(A);
+  mzd_t *W = mzd_init_window(A, m / 3, 0, m, n);
+
+  ret += (A->rows != NULL) || (W->rows != NULL);
+  word **rows = mzd_rows(A);
+  ret += (rows != A->rows) || (mzd_rows(A) != rows);
+  for(rci_t i = 0; i < m; i++)
+    ret += rows[i] != mzd_row(A, i);
+  for(rci_t i = 0; i < W->nrows; i++)
+    ret += mzd_rows(W)[i] != rows[m / 3 + i];
+
+  mzd_free(W);
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int main() {
+  int status = 0;
+
+  status += test_mmc();
+#if defined(__M4RI_ENABLE_MMC) && __M4RI_HAVE_THREAD_LOCAL && defined(HAVE_PTHREAD_KEY_CREATE)
+  status += test_mmc_threads();
+#endif
+  status += test_mzd_t_pool();
+
+  status += test_mzd_rows(  1,   1);
+  status += test_mzd_rows(100, 200);
+
+  status += test_init_uninitialized(  1,   1);
+  status += test_init_uninitialized( 64,  65);
+  status += test_init_uninitialized(200, 131);
+  status += test_init_uninitialized(513, 640);
+
+  status += test_alloc_policy(mzd_alloc_default);
+  status += test_alloc_policy(mzd_alloc_hugepages);
+  status += test_alloc_policy(mzd_alloc_numa_firsttouch);
+  status += test_alloc_policy(mzd_alloc_numa_interleave);
+  status += test_alloc_policy(mzd_alloc_hugepages | mzd_alloc_numa_firsttouch | mzd_alloc_numa_interleave);
+
+  if (status == 0) {
+    printf("All tests passed.\n");
+    return 0;
+  } else {
+    return -1;
+  }
+}
@@ -91,6 +91,62 @@ int elim_test_equality(rci_t nr, rci_t nc) {
   return ret;
 }
 
+int elim_test_workspace(rci_t nr, rci_t nc) {
+  int ret = 0;
+
+  printf("elim: workspace m: %4d, n: %4d ", nr, nc);
+
+  m4ri_workspace_t *ws = m4ri_workspace_init();
+
+  /* a wide matrix first, such that the narrower ones reuse larger tables */
+  for (int i = 0; i < 3; ++i) {
+    mzd_t *A = mzd_init(nr, nc / (1 + 2 * i));
+    mzd_randomize(A);
+    mzd_t *B = mzd_copy(NULL, A);
+
+    rci_t const ra = _mzd_echelonize_m4ri_ws(A, 1, 0, 0, 0.0, ws);
+    rci_t const rb = mzd_echelonize_naive(B, 1);
+
+    if (ra != rb || mzd_equal(A, B) != TRUE)
+      ret = -1;
+
+    mzd_free(B);
+    mzd_free(A);
+  }
+
+  m4ri_workspace_free(ws);
+
+  if (ret == 0)
+    printf(" ... passed\n");
+  else
+    printf(" ... FAILED\n");
+
+  return ret;
+}
+
+int elim_test_opt_k(rci_t n) {
+  int ret = 0;
+  printf("elim: opt k: n: %5d", n);
+
+  int last = 1;
+  for(rci_t m = 1; m <= 65536; m *= 4) {
+    int const k = m4ri_opt_k(m, n, 0);
+    ret += (k < 1 || k > m4ri_radix / 6);
+    /* no table covers more columns than there are */
+    ret += (k > n);
+    /* tables applied to more rows may be larger */
+    ret += (n <= m4ri_radix && k < last);
+    last = k;
+  }
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
 int main() {
   int status = 0;
 
@@ -122,6 +178,18 @@ int main() {
   status += elim_test_equality(1290, 1290);
   status += elim_test_equality(1000, 210);
 
+  /* M4RI tables of wide matrices are built in column slices, one per thread */
+  m4ri_set_num_threads(4);
+  status += elim_test_equality(300, 20000);
+  m4ri_set_num_threads(0);
+  status += elim_test_equality(20000, 300);
+
+  status += elim_test_workspace(500, 1300);
+
+  status += elim_test_opt_k(    3);
+  status += elim_test_opt_k(  100);
+  status += elim_test_opt_k(65536);
+
   if (status == 0) {
     printf("All tests passed.\n");
     return 0;
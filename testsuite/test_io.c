@@ -0,0 +1,120 @@
+#include <m4ri/config.h>
+#include <stdlib.h>
+#include <m4ri/m4ri.h>
+
+int test_mmap(rci_t m, rci_t n) {
+  int ret = 0;
+  printf("mmap: m: %4d, n: %4d", m, n);
+
+  const char *fn = "test_io__test_mmap.mzd";
+
+  mzd_t *A = mzd_init_mmap(fn, m, n, mzd_mmap_create);
+  ret += !mzd_is_zero(A);
+  mzd_randomize(A);
+  mzd_t *B = mzd_copy(NULL, A);
+  mzd_free(A);
+
+  /* changes to a private mapping do not reach the file */
+  A = mzd_init_mmap(fn, 0, 0, mzd_mmap_private);
+  ret += (A->nrows != m) || (A->ncols != n) || !mzd_equal(A, B);
+  mzd_set_ui(A, 0);
+  mzd_free(A);
+
+  A = mzd_init_mmap(fn, m, n, mzd_mmap_readwrite);
+  ret += !mzd_equal(A, B);
+  rci_t const r0 = mzd_echelonize(A, 1);
+  mzd_mmap_sync(A);
+  mzd_free(A);
+
+  rci_t const r1 = mzd_echelonize(B, 1);
+  A = mzd_init_mmap(fn, 0, 0, mzd_mmap_private);
+  ret += (r0 != r1) || !mzd_equal(A, B);
+  mzd_free(A);
+  mzd_free(B);
+
+  remove(fn);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int test_bin(rci_t m, rci_t n) {
+  int ret = 0;
+  printf("bin: m: %4d, n: %4d", m, n);
+
+  const char *fn = "test_io__test_bin.mzd";
+
+  mzd_t *A = mzd_init(m, n);
+  mzd_randomize(A);
+
+  for(int checksum = 0; checksum < 2; checksum++) {
+    ret += mzd_write_bin(A, fn, checksum, 0);
+    mzd_t *B = mzd_read_bin(fn, 0);
+    ret += (B == NULL) || !mzd_equal(A, B);
+    if (B)
+      mzd_free(B);
+
+    /* the same file can be mapped in place */
+    B = mzd_init_mmap(fn, m, n, mzd_mmap_private);
+    ret += !mzd_equal(A, B);
+    mzd_free(B);
+  }
+
+  /* windows are written row by row */
+  if (n > m4ri_radix) {
+    mzd_t *W = mzd_init_window(A, m / 2, m4ri_radix, m, n - 1);
+    ret += mzd_write_bin(W, fn, 1, 0);
+    mzd_t *B = mzd_read_bin(fn, 0);
+    ret += (B == NULL) || !mzd_equal(W, B);
+    if (B)
+      mzd_free(B);
+    mzd_free(W);
+  }
+
+  /* flipping a bit is detected by the checksum */
+  ret += mzd_write_bin(A, fn, 1, 0);
+  FILE *fh = fopen(fn, "r+b");
+  fseek(fh, sizeof(mzd_file_header_t), SEEK_SET);
+  int c = fgetc(fh);
+  fseek(fh, sizeof(mzd_file_header_t), SEEK_SET);
+  fputc(c ^ 1, fh);
+  fclose(fh);
+  mzd_t *B = mzd_read_bin(fn, 0);
+  ret += (B != NULL);
+  if (B)
+    mzd_free(B);
+
+  mzd_free(A);
+  remove(fn);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int main() {
+  int status = 0;
+
+  status += test_mmap(  1,   1);
+  status += test_mmap( 65, 129);
+  status += test_mmap(500, 700);
+
+  status += test_bin(  1,   1);
+  status += test_bin( 64,  64);
+  status += test_bin(113, 114);
+  status += test_bin(500, 700);
+
+  if (status == 0) {
+    printf("All tests passed.\n");
+    return 0;
+  } else {
+    return -1;
+  }
+}
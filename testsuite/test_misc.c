@@ -21,6 +21,7 @@
 
 #include <stdarg.h>
 #include <m4ri/m4ri.h>
+#include <m4ri/xor.h>
 
 #define b(n) (m4ri_one<<(n))
 
@@ -48,6 +49,99 @@ int test_spread_and_shrink(const word to, const int length, ...) {
   return 0;
 }
 
+int test_combine(int n, wi_t wide, wi_t offset) {
+  int ret = 0;
+  printf("combine: n: %d, wide: %4d, offset: %d", n, (int)wide, (int)offset);
+
+  mzd_t *A = mzd_init(n + 1, (wide + offset) * m4ri_radix);
+  mzd_randomize(A);
+  mzd_t *B = mzd_copy(NULL, A);
+
+  word const *t[8];
+  for(int j = 0; j < n; j++)
+    t[j] = mzd_row(A, j + 1) + offset;
+  word *m = mzd_row(A, 0) + offset;
+
+  switch(n) {
+  case 1: _mzd_combine(m, t[0], wide); break;
+  case 2: _mzd_combine_2(m, t, wide); break;
+  case 3: _mzd_combine_3(m, t, wide); break;
+  case 4: _mzd_combine_4(m, t, wide); break;
+  case 5: _mzd_combine_5(m, t, wide); break;
+  case 6: _mzd_combine_6(m, t, wide); break;
+  case 7: _mzd_combine_7(m, t, wide); break;
+  case 8: _mzd_combine_8(m, t, wide); break;
+  }
+
+  word *b = mzd_row(B, 0) + offset;
+  for(wi_t i = 0; i < wide; i++)
+    for(int j = 0; j < n; j++)
+      b[i] ^= mzd_row(B, j + 1)[offset + i];
+
+  ret += mzd_cmp(A, B);
+
+  mzd_free(B);
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int test_dispatch(m4ri_simd_t simd) {
+  int ret = 0;
+  simd = m4ri_dispatch_select(simd);
+  printf("dispatch: %-8s", m4ri_simd_name(simd));
+
+  /* combine, source rows are deliberately misaligned against each other */
+  mzd_t *A = mzd_init(9, 40 * m4ri_radix);
+  mzd_randomize(A);
+  mzd_t *B = mzd_copy(NULL, A);
+  for(int n = 1; n <= 8; n++) {
+    for(wi_t wide = 0; wide < 30; wide += 3) {
+      word const *t[8];
+      for(int j = 0; j < n; j++)
+        t[j] = mzd_row(A, j + 1) + (j % 3);
+      m4ri_combine(mzd_row(A, 0) + 1, t, n, wide);
+      word *b = mzd_row(B, 0) + 1;
+      for(wi_t i = 0; i < wide; i++)
+        for(int j = 0; j < n; j++)
+          b[i] ^= mzd_row(B, j + 1)[(j % 3) + i];
+    }
+  }
+  ret += mzd_cmp(A, B);
+
+  /* popcount */
+  uint64_t count = 0;
+  for(rci_t j = 0; j < A->ncols; j++)
+    count += mzd_read_bit(A, 0, j);
+  ret += (m4ri_dispatch.popcount(mzd_row(A, 0), A->width) != count);
+  mzd_free(B);
+  mzd_free(A);
+
+  /* transpose, exercises the 64 x 64 kernel */
+  A = mzd_init(192, 256);
+  mzd_randomize(A);
+  B = mzd_transpose(NULL, A);
+  for(rci_t i = 0; i < A->nrows; i++)
+    for(rci_t j = 0; j < A->ncols; j++)
+      ret += (mzd_read_bit(A, i, j) != mzd_read_bit(B, j, i));
+  mzd_free(B);
+  mzd_free(A);
+
+  m4ri_dispatch_init();
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
 int test_png(rci_t m, rci_t n) {
   int ret = 0;
 #if __M4RI_HAVE_LIBPNG
@@ -61,9 +155,19 @@ int test_png(rci_t m, rci_t n) {
   mzd_t *B = mzd_from_png(fn, 0);
 
   ret += mzd_cmp(A,B);
+  mzd_free(B);
+
+  /* windows are masked to their columns */
+  if (n > m4ri_radix) {
+    mzd_t *W = mzd_init_window(A, 0, m4ri_radix, m, n - 1);
+    mzd_to_png(W, fn, 0, NULL, 0);
+    B = mzd_from_png(fn, 0);
+    ret += mzd_cmp(W, B);
+    mzd_free(B);
+    mzd_free(W);
+  }
 
   remove(fn);
-  mzd_free(B);
   mzd_free(A);
 
   if(ret==0) {
@@ -88,6 +192,17 @@ int main(int argc, char *argv[]) {
   status += test_spread_and_shrink( b(4)|b(3)|b(1), 3, 1,3,4);
   status += test_spread_and_shrink( b(5)|b(3)|b(2), 3, 2,3,5);
 
+  for(int n = 1; n <= 8; n++) {
+    status += test_combine(n,  1, 0);
+    status += test_combine(n,  7, 1);
+    status += test_combine(n, 16, 0);
+    status += test_combine(n, 31, 1);
+    status += test_combine(n, 37, 0);
+  }
+
+  for(m4ri_simd_t simd = m4ri_simd_none; simd <= m4ri_cpu_simd(); simd++)
+    status += test_dispatch(simd);
+
   status += test_png(1,1);
   status += test_png(16,15);
   status += test_png(32,32);
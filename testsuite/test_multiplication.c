@@ -231,6 +231,262 @@ int addsqr_test_equality(rci_t m, int k, int cutoff) {
   return ret;
 }
 
+/**
+ * Check that Strassen with the top levels run as tasks matches M4RM.
+ *
+ * \param depth Number of recursion levels which spawn tasks.
+ */
+int task_test_equality(rci_t m, rci_t l, rci_t n, int depth, int cutoff) {
+  int ret  = 0;
+  mzd_t *A, *B, *C, *D, *E, *F;
+
+  printf("  task: m: %4d, l: %4d, n: %4d, depth: %d, cutoff: %4d", m, l, n, depth, cutoff);
+
+  int const old_depth = mzd_get_strassen_task_depth();
+  mzd_set_strassen_task_depth(depth);
+
+  A = mzd_init(m, l);
+  B = mzd_init(l, n);
+  C = mzd_init(m, n);
+  mzd_randomize(A);
+  mzd_randomize(B);
+  mzd_randomize(C);
+
+  /* D = A*B and F = C + A*B via Strassen */
+  D = mzd_mul(NULL, A, B, cutoff);
+  F = mzd_copy(NULL, C);
+  F = mzd_addmul(F, A, B, cutoff);
+
+  /* E = A*B via M4RM */
+  E = mzd_mul_m4rm(NULL, A, B, 0);
+
+  if (mzd_equal(D, E) != TRUE) {
+    printf(" Strassen != M4RM");
+    ret -= 1;
+  }
+
+  mzd_add(E, E, C);
+  if (mzd_equal(F, E) != TRUE) {
+    printf(" addmul != add,mul");
+    ret -= 1;
+  }
+
+  mzd_set_strassen_task_depth(old_depth);
+
+  mzd_free(A);
+  mzd_free(B);
+  mzd_free(C);
+  mzd_free(D);
+  mzd_free(E);
+  mzd_free(F);
+
+  if (ret==0)
+    printf(" ... passed\n");
+  else
+    printf(" ... FAILED\n");
+
+  return ret;
+}
+
+int batch_test_equality(int count, rci_t maxdim, int k) {
+  int ret  = 0;
+
+  printf(" batch: count: %4d, maxdim: %4d, k: %d", count, maxdim, k);
+
+  mzd_t **A = (mzd_t**)calloc(count, sizeof(mzd_t*));
+  mzd_t **B = (mzd_t**)calloc(count, sizeof(mzd_t*));
+  mzd_t **C = (mzd_t**)calloc(count, sizeof(mzd_t*));
+  mzd_t **P = (mzd_t**)calloc(count, sizeof(mzd_t*));
+
+  for (int i = 0; i < count; ++i) {
+    rci_t const m = 1 + random() % maxdim;
+    rci_t const l = 1 + random() % maxdim;
+    rci_t const n = 1 + random() % maxdim;
+    A[i] = mzd_init(m, l);
+    B[i] = mzd_init(l, n);
+    mzd_randomize(A[i]);
+    mzd_randomize(B[i]);
+    /* every other product writes to a preallocated matrix, every fourth to a window at 8 mod 16 */
+    C[i] = NULL;
+    P[i] = NULL;
+    if (i % 4 == 3) {
+      P[i] = mzd_init(m, n + m4ri_radix);
+      mzd_randomize(P[i]);
+      C[i] = mzd_init_window(P[i], 0, m4ri_radix, m, n + m4ri_radix);
+    } else if (i % 2) {
+      C[i] = mzd_init(m, n);
+      mzd_randomize(C[i]);
+    }
+  }
+
+  mzd_mul_batch(C, (mzd_t const *const *)A, (mzd_t const *const *)B, count, k);
+
+  for (int i = 0; i < count; ++i) {
+    mzd_t *D = mzd_mul_naive(NULL, A[i], B[i]);
+    if (mzd_equal(C[i], D) != TRUE)
+      ret = -1;
+    mzd_free(D);
+    mzd_free(A[i]);
+    mzd_free(B[i]);
+    if (P[i]) {
+      mzd_free_window(C[i]);
+      mzd_free(P[i]);
+    } else {
+      mzd_free(C[i]);
+    }
+  }
+  free(A);
+  free(B);
+  free(C);
+  free(P);
+
+  if (ret==0)
+    printf(" ... passed\n");
+  else
+    printf(" ... FAILED\n");
+
+  return ret;
+}
+
+int tiled_test_equality(rci_t m, rci_t l, rci_t n, rci_t tile, int cutoff) {
+  int ret = 0;
+  printf("tiled: m: %4d, l: %4d, n: %4d, tile: %4d, cutoff: %4d", m, l, n, tile, cutoff);
+
+  mzd_t *A = mzd_init(m, l);
+  mzd_t *B = mzd_init(l, n);
+  mzd_randomize(A);
+  mzd_randomize(B);
+
+  mzd_tiled_t *At = mzd_to_tiled(mzd_tiled_init(m, l, tile), A);
+  mzd_tiled_t *Bt = mzd_to_tiled(mzd_tiled_init(l, n, tile), B);
+
+  mzd_t *A2 = mzd_from_tiled(NULL, At);
+  ret += !mzd_equal(A, A2);
+  mzd_free(A2);
+
+  mzd_tiled_t *Ct = mzd_tiled_mul(NULL, At, Bt, cutoff);
+  mzd_t *C = mzd_from_tiled(NULL, Ct);
+  mzd_t *D = mzd_mul_m4rm(NULL, A, B, 0);
+  ret += !mzd_equal(C, D);
+
+  /* windows are masked to their columns */
+  if (l > m4ri_radix) {
+    mzd_t *W = mzd_init_window(A, m / 2, m4ri_radix, m, l - 1);
+    mzd_tiled_t *Wt = mzd_to_tiled(NULL, W);
+    mzd_t *E = mzd_copy(NULL, A);
+    mzd_t *WE = mzd_init_window(E, m / 2, m4ri_radix, m, l - 1);
+    mzd_set_ui(WE, 0);
+    mzd_from_tiled(WE, Wt);
+    ret += !mzd_equal(A, E);
+    mzd_free_window(WE);
+    mzd_free(E);
+    mzd_tiled_free(Wt);
+    mzd_free_window(W);
+  }
+
+  mzd_free(D);
+  mzd_free(C);
+  mzd_tiled_free(Ct);
+  mzd_tiled_free(Bt);
+  mzd_tiled_free(At);
+  mzd_free(B);
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int workspace_test_equality(int count, rci_t maxdim) {
+  int ret  = 0;
+
+  printf(" workspace: count: %4d, maxdim: %4d", count, maxdim);
+
+  /* one workspace for products of varying shape, with C misaligned every other time */
+  m4ri_workspace_t *ws = m4ri_workspace_init();
+
+  for (int i = 0; i < count; ++i) {
+    rci_t const m = 1 + random() % maxdim;
+    rci_t const l = 1 + random() % maxdim;
+    rci_t const n = 1 + random() % maxdim;
+    int const off = (i % 2) ? m4ri_radix : 0;
+
+    mzd_t *A = mzd_init(m, l);
+    mzd_t *B = mzd_init(l, n);
+    mzd_t *Cbig = mzd_init(m, n + off);
+    mzd_randomize(A);
+    mzd_randomize(B);
+    mzd_randomize(Cbig);
+    mzd_t *C = mzd_init_window(Cbig, 0, off, m, n + off);
+    mzd_t *D = mzd_copy(NULL, C);
+
+    if (i % 3 == 0) {
+      _mzd_mul_m4rm_ws(C, A, B, 0, TRUE, ws);
+      mzd_mul_naive(D, A, B);
+    } else if (i % 3 == 1) {
+      _mzd_mul_m4rm_ws(C, A, B, 0, FALSE, ws);
+      mzd_addmul_naive(D, A, B);
+    } else if (m >= 256 && l >= 256 && n >= 256) {
+      _mzd_mul_even_ws(C, A, B, 128, ws);
+      mzd_mul_naive(D, A, B);
+    } else {
+      _mzd_addmul_even_ws(C, A, B, 128, ws);
+      mzd_addmul_naive(D, A, B);
+    }
+
+    if (mzd_equal(C, D) != TRUE)
+      ret = -1;
+
+    mzd_free(D);
+    mzd_free_window(C);
+    mzd_free(Cbig);
+    mzd_free(B);
+    mzd_free(A);
+  }
+
+  m4ri_workspace_free(ws);
+
+  if (ret==0)
+    printf(" ... passed\n");
+  else
+    printf(" ... FAILED\n");
+
+  return ret;
+}
+
+int mul_test_opt_k(rci_t n, wi_t width) {
+  int ret = 0;
+  printf("opt k: n: %5d, width: %4d", n, width);
+
+  int last = 1;
+  for(rci_t m = 1; m <= 65536; m *= 4) {
+    int const k = m4ri_opt_k_tables(m, n, width, 8, 8);
+    ret += (k < 1 || k > 8);
+    /* no table covers more columns than there are */
+    ret += (k > n);
+    /* tables applied to more rows may be larger */
+    ret += (width == 1 && k < last);
+    last = k;
+    /* wider tables must not be larger */
+    ret += (m4ri_opt_k_tables(m, n, 4 * width, 8, 8) > k);
+    /* fewer tables per pass must not make them smaller */
+    ret += (n > 8 && m4ri_opt_k_tables(m, n, width, 2, 8) < k);
+    /* narrow inputs use only as many tables as they need */
+    ret += (n <= 8 && m4ri_opt_k_tables(m, n, width, n, 8) != k);
+    ret += (m4ri_opt_k(m, n, width * m4ri_radix) != k);
+  }
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
 int main() {
   int status = 0;
   
@@ -250,6 +506,7 @@ int main() {
   status += mul_test_equality(1024, 1025,    1, 0, 1024);
   status += mul_test_equality(1000, 1000, 1000, 0,  256);
   status += mul_test_equality(1000,   10,   20, 0,   64);
+  status += mul_test_equality( 100,  130, 70001, 0, 1024);
   status += mul_test_equality(1710, 1290, 1000, 0,  256);
   status += mul_test_equality(1290, 1710,  200, 0,   64);
   status += mul_test_equality(1290, 1710, 2000, 0,  256);
@@ -309,6 +566,34 @@ int main() {
   status += addsqr_test_equality(2000, 0,   64);
   status += addsqr_test_equality( 210, 0,   64);
 
+  status += task_test_equality(1024, 1024, 1024, 0,  256);
+  status += task_test_equality(1025, 1025, 1025, 1,  256);
+  status += task_test_equality(1710, 1290, 1000, 2,  256);
+  status += task_test_equality(2048, 2048, 2048, 3,   64);
+  status += task_test_equality(1290, 1710, 2000, 2,   64);
+
+  status += batch_test_equality(   0,    1, 0);
+  status += batch_test_equality(   1,   64, 0);
+  status += batch_test_equality( 200,  130, 0);
+  status += batch_test_equality( 100,  512, 0);
+  status += batch_test_equality(  50,  300, 4);
+
+  status += tiled_test_equality(  1,   1,   1,   0,   0);
+  status += tiled_test_equality( 64, 200,  64,  64,   0);
+  status += tiled_test_equality(300, 257, 513,   0,   0);
+  status += tiled_test_equality(700, 600, 900, 128,   0);
+  status += tiled_test_equality(700, 600, 900,  64,  64);
+  status += tiled_test_equality(640, 641, 513,  64, 128);
+
+  status += workspace_test_equality(  60,  200);
+  status += workspace_test_equality(  12, 1100);
+
+  status += mul_test_opt_k(    1,    1);
+  status += mul_test_opt_k(    5,    1);
+  status += mul_test_opt_k( 3000,    1);
+  status += mul_test_opt_k( 1024,   16);
+  status += mul_test_opt_k(65536, 1024);
+
   if (status == 0) {
     printf("All tests passed.\n");
     return 0;
@@ -256,6 +256,52 @@ int test_pluq_random(rci_t m, rci_t n) {
 }
 
 
+int test_ple_workspace(rci_t m, rci_t n) {
+  printf("ple: testing workspace m: %5d, n: %5d", m, n);
+
+  int status = 0;
+  m4ri_workspace_t *ws = m4ri_workspace_init();
+
+  /* shrinking and growing shapes through the same workspace */
+  rci_t const dims[4][2] = { {m, n}, {m / 3 + 1, n / 5 + 1}, {m, n}, {m / 2 + 1, n} };
+  for (int i = 0; i < 4; ++i) {
+    mzd_t *A = mzd_init(dims[i][0], dims[i][1]);
+    mzd_randomize(A);
+    mzd_t *B = mzd_copy(NULL, A);
+    mzp_t *P = mzp_init(A->nrows);
+    mzp_t *Q = mzp_init(A->ncols);
+    mzp_t *P2 = mzp_init(A->nrows);
+    mzp_t *Q2 = mzp_init(A->ncols);
+
+    rci_t const r = _mzd_ple_russian_ws(A, P, Q, 0, ws);
+    rci_t const r2 = _mzd_ple_russian(B, P2, Q2, 0);
+
+    if (r != r2 || !mzd_equal(A, B))
+      status = 1;
+    for (rci_t j = 0; j < A->nrows; ++j)
+      if (P->values[j] != P2->values[j])
+        status = 1;
+    for (rci_t j = 0; j < A->ncols; ++j)
+      if (Q->values[j] != Q2->values[j])
+        status = 1;
+
+    mzp_free(Q2);
+    mzp_free(P2);
+    mzp_free(Q);
+    mzp_free(P);
+    mzd_free(B);
+    mzd_free(A);
+  }
+
+  m4ri_workspace_free(ws);
+
+  if (status)
+    printf(" ... FAILED\n");
+  else
+    printf(" ... passed\n");
+  return status;
+}
+
 int main() {
   int status = 0;
 
@@ -305,6 +351,7 @@ int main() {
   status += test_pluq_half_rank(132, 136);
   status += test_pluq_half_rank(256, 251);
   status += test_pluq_half_rank(1024, 2100);
+  status += test_pluq_half_rank(1500, 4500);
 
   status += test_pluq_random(63, 63);
   status += test_pluq_random(64, 64);
@@ -327,6 +374,10 @@ int main() {
   status += test_pluq_random(256, 251);
   status += test_pluq_random(1024, 1025);
   status += test_pluq_random(1024, 1021);
+  status += test_pluq_random(2100, 4200);
+
+  status += test_ple_workspace(200, 200);
+  status += test_ple_workspace(1000, 1700);
 
   if (!status) {
     printf("All tests passed.\n");
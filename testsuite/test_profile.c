@@ -0,0 +1,104 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <m4ri/config.h>
+#include <stdlib.h>
+#include <m4ri/m4ri.h>
+
+int test_profile(void) {
+  int ret = 0;
+  printf("profile:");
+
+  const char *fn = "test_profile__test_profile.txt";
+  m4ri_profile_t const saved = m4ri_profile;
+
+  /* start from the compiled defaults, not from a profile of the user */
+  setenv(__M4RI_PROFILE_ENV, "", 1);
+  m4ri_profile_init();
+  m4ri_profile_t def;
+  m4ri_profile_defaults(&def);
+
+  m4ri_profile_t p = def;
+  p.strassen_mul_cutoff = 1024;
+  p.mul_blocksize = 512;
+  p.m4rm_k = 5;
+  p.ple_cutoff = 1 << 17;
+  p.echelonform_crossover_density = 0.25;
+  ret += (m4ri_profile_write(&p, fn) != 0);
+
+  m4ri_profile_t q;
+  m4ri_profile_defaults(&q);
+  ret += (m4ri_profile_read(&q, fn) != 0);
+  ret += (q.strassen_mul_cutoff != 1024 || q.mul_blocksize != 512 || q.m4rm_k != 5);
+  ret += (q.ple_cutoff != (1 << 17) || q.echelonform_crossover_density != 0.25);
+
+  /* the environment variable takes precedence, the profile is used by mzd_mul */
+  setenv(__M4RI_PROFILE_ENV, fn, 1);
+  m4ri_profile_init();
+  ret += (m4ri_profile.strassen_mul_cutoff != 1024 || m4ri_profile.m4rm_k != 5);
+
+  mzd_t *A = mzd_init(300, 200);
+  mzd_t *B = mzd_init(200, 400);
+  mzd_randomize(A);
+  mzd_randomize(B);
+  mzd_t *C = mzd_mul_naive(NULL, A, B);
+  mzd_t *D = mzd_mul(NULL, A, B, 0);
+  ret += !mzd_equal(C, D);
+
+  /* comments and unknown keys are ignored, invalid values are not */
+  FILE *fh = fopen(fn, "w");
+  fprintf(fh, "# comment\n\nunknown_key = 3\nmul_blocksize = 256\n");
+  fclose(fh);
+  m4ri_profile_defaults(&q);
+  ret += (m4ri_profile_read(&q, fn) != 0 || q.mul_blocksize != 256);
+
+  fh = fopen(fn, "w");
+  fprintf(fh, "mul_blocksize = 256\nm4rm_k = 100\n");
+  fclose(fh);
+  ret += (m4ri_profile_read(&q, fn) != -1);
+  m4ri_profile_init();
+  ret += (m4ri_profile.mul_blocksize != def.mul_blocksize || m4ri_profile.m4rm_k != def.m4rm_k);
+
+  /* an empty file name disables loading */
+  setenv(__M4RI_PROFILE_ENV, "", 1);
+  m4ri_profile_init();
+  m4ri_profile_defaults(&q);
+  ret += (m4ri_profile.strassen_mul_cutoff != q.strassen_mul_cutoff);
+
+  /* values beyond the range of the fields are rejected */
+  fh = fopen(fn, "w");
+  fprintf(fh, "strassen_mul_cutoff = 1e12\nmul_blocksize = 1e300\nple_cutoff = 1e30\n");
+  fclose(fh);
+  m4ri_profile_defaults(&q);
+  ret += (m4ri_profile_read(&q, fn) != -1);
+  ret += (q.strassen_mul_cutoff != def.strassen_mul_cutoff || q.mul_blocksize != def.mul_blocksize);
+  ret += (q.ple_cutoff != def.ple_cutoff);
+
+  remove(fn);
+  m4ri_profile = saved;
+
+  mzd_free(D);
+  mzd_free(C);
+  mzd_free(B);
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int main() {
+  int status = 0;
+
+  status += test_profile();
+
+  if (status == 0) {
+    printf("All tests passed.\n");
+    return 0;
+  } else {
+    return -1;
+  }
+}
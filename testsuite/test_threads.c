@@ -0,0 +1,124 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <m4ri/config.h>
+#include <stdlib.h>
+#include <m4ri/m4ri.h>
+
+#if defined(HAVE_SCHED_SETAFFINITY)
+#include <sched.h>
+#endif
+
+int test_omp_settings(int chunk, uint64_t threshold) {
+  int ret = 0;
+  printf("omp settings: chunk: %3d, threshold: %6llu", chunk, (unsigned long long)threshold);
+
+  mzd_t *A = mzd_init(300, 200);
+  mzd_t *B = mzd_init(200, 400);
+  mzd_randomize(A);
+  mzd_randomize(B);
+  mzd_t *C = mzd_mul_naive(NULL, A, B);
+  mzd_t *E = mzd_copy(NULL, A);
+
+  m4ri_set_omp_chunk(chunk);
+  m4ri_set_omp_threshold(threshold);
+  ret += (chunk > 0 && m4ri_omp_chunk(300, 7) != chunk);
+  ret += (m4ri_omp_chunk(300, 7) % 8 != 0 && chunk == 0);
+
+  mzd_t *D = mzd_mul_m4rm(NULL, A, B, 0);
+  ret += !mzd_equal(C, D);
+  rci_t const r = mzd_echelonize_m4ri(E, 1, 0);
+  ret += (r != mzd_echelonize_naive(A, 1));
+  ret += !mzd_equal(A, E);
+
+  m4ri_set_omp_chunk(0);
+  m4ri_set_omp_threshold(0);
+
+  mzd_free(E);
+  mzd_free(D);
+  mzd_free(C);
+  mzd_free(B);
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int test_threads(int n, int budget) {
+  int ret = 0;
+  printf("threads: n: %2d, budget: %2d", n, budget);
+
+  mzd_t *A = mzd_init(500, 400);
+  mzd_t *B = mzd_init(400, 600);
+  mzd_randomize(A);
+  mzd_randomize(B);
+  mzd_t *C = mzd_mul_naive(NULL, A, B);
+
+  int const def = m4ri_get_num_threads();
+  m4ri_set_num_threads(n);
+  m4ri_set_thread_budget(budget);
+#if __M4RI_HAVE_OPENMP
+  ret += (m4ri_get_num_threads() != (budget ? budget : (n ? n : def)));
+#else
+  ret += (m4ri_get_num_threads() != 1);
+#endif
+
+  mzd_t *D = mzd_mul(NULL, A, B, 64);
+  ret += !mzd_equal(C, D);
+
+  /* pinning may legitimately fail in a restricted environment */
+#if defined(HAVE_SCHED_SETAFFINITY)
+  cpu_set_t orig, now;
+  sched_getaffinity(0, sizeof(cpu_set_t), &orig);
+#endif
+  int const cpu = 0;
+  if (m4ri_set_affinity(&cpu, 1) == 0) {
+    mzd_mul(D, A, B, 64);
+    ret += !mzd_equal(C, D);
+    ret += (m4ri_set_affinity(NULL, 0) != 0);
+#if defined(HAVE_SCHED_SETAFFINITY)
+    /* restoring gives back the original mask, not every CPU */
+    sched_getaffinity(0, sizeof(cpu_set_t), &now);
+    ret += !CPU_EQUAL(&orig, &now);
+#endif
+  }
+
+  m4ri_set_thread_budget(0);
+  m4ri_set_num_threads(0);
+  ret += (m4ri_get_num_threads() != def);
+
+  mzd_free(D);
+  mzd_free(C);
+  mzd_free(B);
+  mzd_free(A);
+
+  if(ret==0) {
+    printf(" ... passed\n");
+  } else {
+    printf(" ... FAILED\n");
+  }
+  return ret;
+}
+
+int main() {
+  int status = 0;
+
+  status += test_omp_settings(0, 0);
+  status += test_omp_settings(3, 1);
+  status += test_omp_settings(0, 1);
+
+  status += test_threads(0, 0);
+  status += test_threads(3, 0);
+  status += test_threads(3, 2);
+
+  if (status == 0) {
+    printf("All tests passed.\n");
+    return 0;
+  } else {
+    return -1;
+  }
+}
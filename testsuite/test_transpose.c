@@ -72,6 +72,74 @@ int test_transpose(int i)
   return failure;
 }
 
+int test_transpose_large(rci_t m, rci_t n)
+{
+  printf("transpose m: %5d, n: %5d ", m, n);
+  mzd_t* A = mzd_init(m, n);
+  mzd_randomize(A);
+  mzd_t* AT = mzd_transpose(NULL, A);
+  int failure = 0;
+  for (rci_t i = 0; i < m && !failure; ++i)
+    for (rci_t j = 0; j < n; ++j)
+      if (mzd_read_bit(A, i, j) != mzd_read_bit(AT, j, i)) {
+        failure = 1;
+        break;
+      }
+  mzd_t* ATT = mzd_transpose(NULL, AT);
+  if (!mzd_equal(A, ATT))
+    failure = 1;
+  mzd_free(A);
+  mzd_free(AT);
+  mzd_free(ATT);
+  if (failure)
+    printf("FAILED\n");
+  else
+    printf("passed\n");
+  return failure;
+}
+
+int test_transpose_inplace(rci_t n)
+{
+  printf("transpose_inplace n: %5d ", n);
+  int failure = 0;
+
+  mzd_t* A = mzd_init(n, n);
+  mzd_randomize(A);
+  mzd_t* AT = mzd_transpose(NULL, A);
+  mzd_transpose_inplace(A);
+  if (!mzd_equal(A, AT))
+    failure = 1;
+  mzd_free(A);
+  mzd_free(AT);
+
+  /* a window must leave the surrounding columns alone */
+  mzd_t* B = mzd_init(n + 64, n + 64 + 13);
+  mzd_randomize(B);
+  mzd_t* B0 = mzd_copy(NULL, B);
+  mzd_t* W = mzd_init_window(B, 64, 64, 64 + n, 64 + n);
+  mzd_t* W0 = mzd_init_window(B0, 64, 64, 64 + n, 64 + n);
+  mzd_t* WT = mzd_transpose(NULL, W0);
+  mzd_transpose_inplace(W);
+  if (!mzd_equal(W, WT))
+    failure = 1;
+  mzd_t* WTT = mzd_transpose_inplace(mzd_copy(NULL, WT));
+  mzd_copy(W, WTT);
+  if (!mzd_equal(B, B0))
+    failure = 1;
+  mzd_free(WTT);
+  mzd_free(WT);
+  mzd_free_window(W0);
+  mzd_free_window(W);
+  mzd_free(B0);
+  mzd_free(B);
+
+  if (failure)
+    printf("FAILED\n");
+  else
+    printf("passed\n");
+  return failure;
+}
+
 int main()
 {
   int status = 0;
@@ -101,6 +169,18 @@ int main()
   mzd_free(CTT);
 
 
+  status += test_transpose_large(2048, 2048);
+  status += test_transpose_large(2100, 3001);
+  status += test_transpose_large(64, 70000);
+  status += test_transpose_large(70001, 127);
+
+  status += test_transpose_inplace(1);
+  status += test_transpose_inplace(63);
+  status += test_transpose_inplace(64);
+  status += test_transpose_inplace(65);
+  status += test_transpose_inplace(200);
+  status += test_transpose_inplace(2101);
+
   /* for (int i = 0; i < 18; ++i) { */
   /*     status += test_transpose(i); */
   /* } */
@@ -38,7 +38,7 @@ int test_trsm_upper_right (rci_t m, rci_t n, int offset){
 
   for (rci_t i = 0; i < 2048; ++i)
     for (wi_t j = 0; j < 2048 / m4ri_radix; ++j){
-      if (Bbase->rows[i][j] != Bbasecopy->rows[i][j]){
+      if (mzd_row(Bbase, i)[j] != mzd_row(Bbasecopy, i)[j]){
 	status = 1;
       }
     }
@@ -91,7 +91,7 @@ int test_trsm_lower_right (rci_t m, rci_t n, int offset){
 
   for (rci_t i = 0; i < 2048; ++i)
     for (wi_t j = 0; j < 2048 / m4ri_radix; ++j){
-      if (Bbase->rows[i][j] != Bbasecopy->rows[i][j]){
+      if (mzd_row(Bbase, i)[j] != mzd_row(Bbasecopy, i)[j]){
 	status = 1;
       }
     }
@@ -146,7 +146,7 @@ int test_trsm_lower_left (rci_t m, rci_t n, int offsetL, int offsetB){
 
   for (rci_t i = 0; i < 2048; ++i)
     for (wi_t j = 0; j < 2048 / m4ri_radix; ++j){
-      if (Bbase->rows[i][j] != Bbasecopy->rows[i][j]){
+      if (mzd_row(Bbase, i)[j] != mzd_row(Bbasecopy, i)[j]){
 	status = 1;
       }
     }
@@ -201,7 +201,7 @@ int test_trsm_upper_left (rci_t m, rci_t n, int offsetU, int offsetB) {
 
   for (rci_t i = 0; i < 2048; ++i)
     for (wi_t j = 0; j < 2048 / m4ri_radix; ++j){
-      if (Bbase->rows[i][j] != Bbasecopy->rows[i][j]){
+      if (mzd_row(Bbase, i)[j] != mzd_row(Bbasecopy, i)[j]){
 	status = 1;
       }
     }
@@ -307,6 +307,16 @@ int main() {
   status += test_trsm_upper_left(  770, 1600,  64, 128);
   status += test_trsm_upper_left( 1764, 1345, 256,  64);
 
+  printf("\n");
+
+  /* B is split into column slabs for the left and row slabs for the right solvers */
+  m4ri_set_num_threads(4);
+  status += test_trsm_upper_right(1200, 1600,   0);
+  status += test_trsm_lower_right(1200, 1600,  64);
+  status += test_trsm_lower_left( 1200, 1600,   0,  64);
+  status += test_trsm_upper_left( 1200, 1600,  64,   0);
+  m4ri_set_num_threads(0);
+
   if (!status) {
     printf("All tests passed.\n");
     return 0;